@@ -4,9 +4,10 @@
 #extension GL_EXT_multiview : enable
 
 #include "test.inc"
+#include "Vertex.inc"
 
 layout(location = 0) in vec3 inPos;
-layout(location = 1) in vec3 inNormal;
+layout(location = 1) in vec2 inNormal;
 layout(location = 2) in vec4 inColor;
 layout(location = 3) in vec2 inUV;
 
@@ -23,7 +24,7 @@ out gl_PerVertex {
 void main() {
     vec4 fragPos = pc.mWorld * vec4(inPos, 1.0f);
     outFragPos = vec3(fragPos);
-    outNormal = mat3(transpose(inverse(pc.mWorld))) * inNormal;
+    outNormal = mat3(transpose(inverse(pc.mWorld))) * octahedralDecode(inNormal);
     outColor = inColor * 10;
     outUV = inUV;
     gl_Position = sceneData.mViewProj[gl_ViewIndex] * fragPos;
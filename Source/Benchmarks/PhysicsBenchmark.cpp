@@ -0,0 +1,268 @@
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <btBulletDynamicsCommon.h>
+
+#include "PlatformDebug.h"
+#include "Engine/Job.h"
+#include "Engine/Physics.h"
+#include "Engine/PhysicsObject.h"
+#include "Engine/Transform.h"
+
+//steps the physics world for a fixed number of frames without a window or graphics device
+//PhysicsBenchmark [-scene boxes|chain|mesh] [-count N] [-frames N]
+
+//fixed step so every run does the same amount of simulation
+const float cTimeStep = 1.0f / 60.0f;
+const int cDefaultFrames = 600;
+//boxes per column in the box stack scene
+const int cStackHeight = 10;
+//quads per side of the triangle mesh scene
+const int cMeshGridSize = 256;
+
+struct BenchmarkScene {
+	//PhysicsObjects hold pointers to their transforms (and the transforms to them), so these are sized once
+	std::vector<Transform> mTransforms;
+	std::vector<PhysicsObject> mObjects;
+	std::vector<btTypedConstraint*> mConstraints;
+
+	//bullet references the triangle data directly, kept alive until the scene is cleared
+	std::vector<glm::vec3> mMeshPositions;
+	std::vector<int> mMeshIndices;
+	btTriangleIndexVertexArray* mMeshInterface = nullptr;
+	btCollisionShape* mMeshShape = nullptr;
+
+	void Reserve(int aNumObjects) {
+		mTransforms.resize(aNumObjects);
+		mObjects.resize(aNumObjects);
+	}
+
+	PhysicsObject* SetupObject(int aIndex, const glm::vec3& aPosition, const glm::vec3& aScale) {
+		mTransforms[aIndex].SetPosition(aPosition);
+		mTransforms[aIndex].SetScale(aScale);
+		mObjects[aIndex].AttachTransform(&mTransforms[aIndex]);
+		return &mObjects[aIndex];
+	}
+
+	void Clear() {
+		for(int i = 0; i < mConstraints.size(); i++) {
+			gPhysics->RemoveContraintTemp(mConstraints[i]);
+		}
+		mConstraints.clear();
+		for(int i = 0; i < mObjects.size(); i++) {
+			mObjects[i].RemoveAttachmentsTemp();
+			if(mObjects[i].GetRigidBody()) {
+				gPhysics->RemovePhysicsObject(&mObjects[i]);
+			}
+		}
+		delete mMeshShape;
+		mMeshShape = nullptr;
+		delete mMeshInterface;
+		mMeshInterface = nullptr;
+	}
+};
+
+//columns of boxes resting on a ground box
+void SetupBoxStacks(BenchmarkScene& aScene, int aCount) {
+	const int numColumns = (aCount + cStackHeight - 1) / cStackHeight;
+	const int columnsPerRow = (int)std::ceil(std::sqrt((float)numColumns));
+	const float spacing = 2.0f;
+	const float halfWidth = columnsPerRow * spacing * 0.5f;
+
+	aScene.Reserve(aCount + 1);
+
+	//ground uses its scale as half extents
+	PhysicsObject* ground = aScene.SetupObject(aCount, glm::vec3(0, -1, 0), glm::vec3(halfWidth + 10.0f, 1, halfWidth + 10.0f));
+	gPhysics->AddingObjectsTestGround(ground);
+
+	for(int i = 0; i < aCount; i++) {
+		const int column = i / cStackHeight;
+		const int level = i % cStackHeight;
+		const glm::vec3 position((column % columnsPerRow) * spacing - halfWidth, 0.5f + level * 1.01f, (column / columnsPerRow) * spacing - halfWidth);
+		gPhysics->AddingObjectsTestBox(aScene.SetupObject(i, position, glm::vec3(1)));
+	}
+}
+
+//same setup as StateTest's chain, hanging from a kinematic box at the top and falling onto a ground box
+void SetupChain(BenchmarkScene& aScene, int aCount) {
+	aScene.Reserve(aCount + 1);
+
+	PhysicsObject* ground = aScene.SetupObject(aCount, glm::vec3(0, -1, 0), glm::vec3(50, 1, 50));
+	gPhysics->AddingObjectsTestGround(ground);
+
+	float offset = 10.0f;
+	for(int i = 0; i < aCount; i++) {
+		float scale = 0.5f + rand() % 1000 / 2000.0f;
+		if(i == 0 || i == aCount - 1) {
+			scale = 0.1f;
+		}
+		offset += ((rand() % 1000 / 1000.0f) * 1.0f) + scale;
+		const glm::vec3 position((rand() % 1000 / 1000.0f) * 1.0f, offset, (rand() % 1000 / 1000.0f) * 1.0f);
+		gPhysics->AddingObjectsTestBox(aScene.SetupObject(i, position, glm::vec3(scale)));
+		if(i != 0) {
+			aScene.mConstraints.push_back(gPhysics->JoinTwoObject(&aScene.mObjects[i - 1], &aScene.mObjects[i]));
+		}
+	}
+	aScene.mObjects[aCount - 1].SetMass(0.0f);
+	aScene.mObjects[aCount - 1].SetKinematic(true);
+}
+
+//large static bvh triangle mesh with spheres dropped onto it in layers
+void SetupTriangleMesh(BenchmarkScene& aScene, int aCount) {
+	const int numVerts = cMeshGridSize + 1;
+	const float halfSize = cMeshGridSize * 0.5f;
+	aScene.mMeshPositions.resize(numVerts * numVerts);
+	for(int z = 0; z < numVerts; z++) {
+		for(int x = 0; x < numVerts; x++) {
+			const float height = std::sin(x * 0.2f) * std::cos(z * 0.2f) * 2.0f;
+			aScene.mMeshPositions[z * numVerts + x] = glm::vec3(x - halfSize, height, z - halfSize);
+		}
+	}
+	aScene.mMeshIndices.reserve(cMeshGridSize * cMeshGridSize * 6);
+	for(int z = 0; z < cMeshGridSize; z++) {
+		for(int x = 0; x < cMeshGridSize; x++) {
+			const int index = z * numVerts + x;
+			aScene.mMeshIndices.insert(aScene.mMeshIndices.end(), {index, index + numVerts, index + 1});
+			aScene.mMeshIndices.insert(aScene.mMeshIndices.end(), {index + 1, index + numVerts, index + numVerts + 1});
+		}
+	}
+
+	btIndexedMesh part;
+	part.m_vertexBase = (const unsigned char*)aScene.mMeshPositions.data();
+	part.m_vertexStride = sizeof(glm::vec3);
+	part.m_numVertices = aScene.mMeshPositions.size();
+	part.m_vertexType = PHY_FLOAT;
+	part.m_triangleIndexBase = (const unsigned char*)aScene.mMeshIndices.data();
+	part.m_triangleIndexStride = sizeof(int) * 3;
+	part.m_numTriangles = aScene.mMeshIndices.size() / 3;
+	part.m_indexType = PHY_INTEGER;
+
+	aScene.mMeshInterface = new btTriangleIndexVertexArray();
+	aScene.mMeshInterface->addIndexedMesh(part, part.m_indexType);
+	const bool useQuantizedAabbCompression = true;
+	aScene.mMeshShape = new btBvhTriangleMeshShape(aScene.mMeshInterface, useQuantizedAabbCompression);
+
+	aScene.Reserve(aCount + 1);
+
+	PhysicsObject* mesh = aScene.SetupObject(aCount, glm::vec3(0), glm::vec3(1));
+	gPhysics->AddRigidBody(mesh, aScene.mMeshShape, 0.0f);
+
+	//square layers of spheres over the middle of the mesh
+	const int spheresPerSide = std::min((int)std::ceil(std::sqrt((float)aCount)), cMeshGridSize / 2);
+	const int spheresPerLayer = spheresPerSide * spheresPerSide;
+	const float spacing = 1.5f;
+	const float start = -spheresPerSide * spacing * 0.5f;
+	for(int i = 0; i < aCount; i++) {
+		const int layer = i / spheresPerLayer;
+		const int index = i % spheresPerLayer;
+		const glm::vec3 position(start + (index % spheresPerSide) * spacing, 5.0f + layer * spacing, start + (index / spheresPerSide) * spacing);
+		gPhysics->AddingObjectsTestSphere(aScene.SetupObject(i, position, glm::vec3(1)));
+	}
+}
+
+struct BenchmarkType {
+	const char* mName;
+	void (*mSetup)(BenchmarkScene& aScene, int aCount);
+	int mDefaultCount;
+};
+
+const BenchmarkType cBenchmarks[] = {
+	{"boxes", SetupBoxStacks, 4000},
+	{"chain", SetupChain, 100},
+	{"mesh", SetupTriangleMesh, 2000},
+};
+
+void RunBenchmark(const BenchmarkType& aBenchmark, int aCount, int aFrames) {
+	ZoneScoped;
+	Physics physics;
+	physics.Startup();
+
+	//same layout every run
+	srand(0);
+	BenchmarkScene scene;
+	aBenchmark.mSetup(scene, aCount);
+
+	std::vector<double> stepTimes(aFrames);
+	double totalTime = 0;
+	long long totalActive = 0;
+	long long totalContacts = 0;
+	int peakActive = 0;
+	int peakContacts = 0;
+	for(int i = 0; i < aFrames; i++) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		physics.Update(cTimeStep);
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		stepTimes[i] = std::chrono::duration<double, std::milli>(end - start).count();
+		totalTime += stepTimes[i];
+		totalActive += physics.GetNumActiveObjects();
+		totalContacts += physics.GetNumCollisions();
+		peakActive = std::max(peakActive, physics.GetNumActiveObjects());
+		peakContacts = std::max(peakContacts, physics.GetNumCollisions());
+	}
+
+	std::sort(stepTimes.begin(), stepTimes.end());
+	const double median = stepTimes[aFrames / 2];
+	const double p99 = stepTimes[std::min(aFrames - 1, (int)(aFrames * 0.99))];
+
+	LOGGER::Formated("{} ({} objects, {} collision objects, {} frames)\n", aBenchmark.mName, aCount, physics.GetNumCollisionObjects(), aFrames);
+	LOGGER::Formated("\tstep ms: avg {:.3f} median {:.3f} p99 {:.3f} min {:.3f} max {:.3f} total {:.1f}\n",
+					 totalTime / aFrames,
+					 median,
+					 p99,
+					 stepTimes.front(),
+					 stepTimes.back(),
+					 totalTime);
+	LOGGER::Formated("\tactive objects: avg {} peak {} last {}\n", totalActive / aFrames, peakActive, physics.GetNumActiveObjects());
+	LOGGER::Formated("\tcontacts: avg {} peak {} last {}\n", totalContacts / aFrames, peakContacts, physics.GetNumCollisions());
+
+	scene.Clear();
+	physics.Shutdown();
+}
+
+int main(int argc, char** argv) {
+	const char* sceneName = nullptr;
+	int count = 0;
+	int frames = cDefaultFrames;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-scene") == 0 && i + 1 < argc) {
+			sceneName = argv[++i];
+		} else if(strcmp(argv[i], "-count") == 0 && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+			frames = atoi(argv[++i]);
+		} else {
+			LOGGER::Formated("Unknown argument {}\nPhysicsBenchmark [-scene boxes|chain|mesh] [-count N] [-frames N]\n", argv[i]);
+			return 1;
+		}
+	}
+	if(frames <= 0) {
+		LOGGER::Log("-frames needs to be above 0\n");
+		return 1;
+	}
+
+	//SyncTransforms can split work across the job threads
+	WorkManager::Startup();
+
+	bool ranBenchmark = false;
+	for(const BenchmarkType& benchmark: cBenchmarks) {
+		if(sceneName && strcmp(sceneName, benchmark.mName) != 0) {
+			continue;
+		}
+		//chain needs a link to join
+		const int sceneCount = std::max(count > 0 ? count : benchmark.mDefaultCount, 2);
+		RunBenchmark(benchmark, sceneCount, frames);
+		ranBenchmark = true;
+	}
+	if(!ranBenchmark) {
+		LOGGER::Formated("Unknown scene {}\n", sceneName);
+	}
+
+	WorkManager::Shutdown();
+
+	return ranBenchmark ? 0 : 1;
+}
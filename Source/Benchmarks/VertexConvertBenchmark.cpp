@@ -0,0 +1,266 @@
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "PlatformDebug.h"
+#include "Graphics/VertexConvert.h"
+
+//converts a generated sample mesh from the accessor layouts the loaders see into MeshVert sized vertices
+//each layout is timed with the per element memcpy the loaders used to do, the scalar path and the SIMD path
+//VertexConvertBenchmark [-vertices N] [-runs N]
+
+const int cDefaultVertices = 1 << 21;
+const int cDefaultRuns = 10;
+
+//same size and member offsets as MeshVert, without pulling in the graphics headers
+struct BenchmarkVert {
+	glm::vec3 mPos;
+	glm::vec3 mNorm;
+	glm::vec3 mTangent;
+	glm::vec3 mBiTangent;
+	glm::vec4 mColor;
+	glm::vec2 mUV;
+};
+
+struct BenchmarkAttribute {
+	const char* mName;
+	VertexConvert::Format mFormat;
+	uint32_t mComponents;
+	//where it goes in BenchmarkVert and how many floats are written
+	size_t mDestOffset;
+	uint32_t mDestComponents;
+};
+
+//a typical exported layout, and a quantized one (KHR_mesh_quantization/meshopt style)
+const BenchmarkAttribute cFloatLayout[] = {
+	{"position float3", VertexConvert::Format::FLOAT, 3, offsetof(BenchmarkVert, mPos), 3},
+	{"normal float3", VertexConvert::Format::FLOAT, 3, offsetof(BenchmarkVert, mNorm), 3},
+	{"tangent float4", VertexConvert::Format::FLOAT, 4, offsetof(BenchmarkVert, mTangent), 3},
+	{"uv float2", VertexConvert::Format::FLOAT, 2, offsetof(BenchmarkVert, mUV), 2},
+};
+const BenchmarkAttribute cQuantizedLayout[] = {
+	{"position uint16x4", VertexConvert::Format::UINT16, 4, offsetof(BenchmarkVert, mPos), 3},
+	{"normal snorm8x4", VertexConvert::Format::SNORM8, 4, offsetof(BenchmarkVert, mNorm), 3},
+	{"tangent snorm16x4", VertexConvert::Format::SNORM16, 4, offsetof(BenchmarkVert, mTangent), 3},
+	{"color unorm8x4", VertexConvert::Format::UNORM8, 4, offsetof(BenchmarkVert, mColor), 4},
+	{"color unorm16x4", VertexConvert::Format::UNORM16, 4, offsetof(BenchmarkVert, mColor), 4},
+	{"uv half2", VertexConvert::Format::HALF, 2, offsetof(BenchmarkVert, mUV), 2},
+};
+
+struct BenchmarkLayout {
+	const char* mName;
+	const BenchmarkAttribute* mAttributes;
+	int mNumAttributes;
+};
+const BenchmarkLayout cLayouts[] = {
+	{"float", cFloatLayout, sizeof(cFloatLayout) / sizeof(cFloatLayout[0])},
+	{"quantized", cQuantizedLayout, sizeof(cQuantizedLayout) / sizeof(cQuantizedLayout[0])},
+};
+
+//fills one interleaved buffer with every attribute of the layout, 4 byte aligned like a gltf buffer view
+//values are a wavy grid so the data isn't all zeros/denormals
+uint32_t BuildSource(const BenchmarkLayout& aLayout, int aNumVertices, std::vector<uint8_t>& aData, std::vector<uint32_t>& aOffsets) {
+	uint32_t stride = 0;
+	aOffsets.resize(aLayout.mNumAttributes);
+	for(int i = 0; i < aLayout.mNumAttributes; i++) {
+		aOffsets[i] = stride;
+		const BenchmarkAttribute& attribute = aLayout.mAttributes[i];
+		stride += (VertexConvert::GetFormatSize(attribute.mFormat) * attribute.mComponents + 3) & ~3u;
+	}
+	aData.resize((size_t)stride * aNumVertices);
+	const int gridSize = (int)std::sqrt((float)aNumVertices) + 1;
+	for(int v = 0; v < aNumVertices; v++) {
+		const float x = (float)(v % gridSize);
+		const float z = (float)(v / gridSize);
+		const float values[4] = {x, std::sin(x * 0.1f) * std::cos(z * 0.1f), z, 1.0f};
+		for(int i = 0; i < aLayout.mNumAttributes; i++) {
+			const BenchmarkAttribute& attribute = aLayout.mAttributes[i];
+			uint8_t* element = &aData[(size_t)v * stride + aOffsets[i]];
+			for(uint32_t c = 0; c < attribute.mComponents; c++) {
+				const float unit = values[c] / gridSize;
+				switch(attribute.mFormat) {
+					case VertexConvert::Format::FLOAT:
+						memcpy(element + c * 4, &values[c], 4);
+						break;
+					case VertexConvert::Format::HALF: {
+						const uint16_t value = glm::packHalf1x16(unit);
+						memcpy(element + c * 2, &value, 2);
+						break;
+					}
+					case VertexConvert::Format::UNORM8:
+						element[c] = (uint8_t)(std::abs(unit) * 255.0f);
+						break;
+					case VertexConvert::Format::SNORM8:
+						element[c] = (uint8_t)(int8_t)(glm::clamp(unit, -1.0f, 1.0f) * 127.0f);
+						break;
+					case VertexConvert::Format::UNORM16:
+					case VertexConvert::Format::UINT16: {
+						const uint16_t value = (uint16_t)(std::abs(unit) * 65535.0f);
+						memcpy(element + c * 2, &value, 2);
+						break;
+					}
+					case VertexConvert::Format::SNORM16: {
+						const int16_t value = (int16_t)(glm::clamp(unit, -1.0f, 1.0f) * 32767.0f);
+						memcpy(element + c * 2, &value, 2);
+						break;
+					}
+					default:
+						memset(element + c * VertexConvert::GetFormatSize(attribute.mFormat), 0, VertexConvert::GetFormatSize(attribute.mFormat));
+						break;
+				}
+			}
+		}
+	}
+	return stride;
+}
+
+//what the loaders did before, a memcpy of each element into a temporary then a copy into the vertex
+//only meaningful for float sources
+void ConvertMemcpy(const VertexConvert::Stream& aSource, float* aDest, uint32_t aDestStride, uint32_t aDestComponents, size_t aCount) {
+	const size_t elementSize = sizeof(float) * aSource.mComponents;
+	for(size_t i = 0; i < aCount; i++) {
+		glm::vec4 data = glm::vec4(0);
+		memcpy(&data, (const uint8_t*)aSource.mData + aSource.mStride * i, elementSize);
+		memcpy((uint8_t*)aDest + aDestStride * i, &data, aDestComponents * sizeof(float));
+	}
+}
+
+enum class ConvertPath {
+	MEMCPY,
+	SCALAR,
+	SIMD,
+	COUNT
+};
+const char* cPathNames[(int)ConvertPath::COUNT] = {"memcpy", "scalar", "simd"};
+
+//best of aRuns, in ms
+double TimeAttribute(ConvertPath aPath, const VertexConvert::Stream& aSource, const BenchmarkAttribute& aAttribute, std::vector<BenchmarkVert>& aVertices, int aRuns) {
+	float* dest = (float*)((uint8_t*)aVertices.data() + aAttribute.mDestOffset);
+	double best = 0;
+	for(int run = 0; run < aRuns; run++) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		switch(aPath) {
+			case ConvertPath::MEMCPY:
+				ConvertMemcpy(aSource, dest, sizeof(BenchmarkVert), aAttribute.mDestComponents, aVertices.size());
+				break;
+			case ConvertPath::SCALAR:
+				VertexConvert::ConvertToFloatScalar(aSource, dest, sizeof(BenchmarkVert), aAttribute.mDestComponents, aVertices.size());
+				break;
+			default:
+				VertexConvert::ConvertToFloat(aSource, dest, sizeof(BenchmarkVert), aAttribute.mDestComponents, aVertices.size());
+				break;
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+		const double time = std::chrono::duration<double, std::milli>(end - start).count();
+		best = run == 0 ? time : std::min(best, time);
+	}
+	return best;
+}
+
+bool RunLayout(const BenchmarkLayout& aLayout, int aNumVertices, int aRuns) {
+	ZoneScoped;
+	std::vector<uint8_t> source;
+	std::vector<uint32_t> offsets;
+	const uint32_t stride = BuildSource(aLayout, aNumVertices, source, offsets);
+	LOGGER::Formated("{} layout ({} vertices, {} byte stride, {:.1f} MB)\n", aLayout.mName, aNumVertices, stride, source.size() / (1024.0 * 1024.0));
+
+	bool matches = true;
+	std::vector<BenchmarkVert> scalarVertices(aNumVertices);
+	std::vector<BenchmarkVert> simdVertices(aNumVertices);
+	double totals[(int)ConvertPath::COUNT] = {};
+	for(int i = 0; i < aLayout.mNumAttributes; i++) {
+		const BenchmarkAttribute& attribute = aLayout.mAttributes[i];
+		VertexConvert::Stream stream;
+		stream.mData = &source[offsets[i]];
+		stream.mStride = stride;
+		stream.mFormat = attribute.mFormat;
+		stream.mComponents = attribute.mComponents;
+		const size_t sourceBytes = (size_t)VertexConvert::GetFormatSize(attribute.mFormat) * attribute.mComponents * aNumVertices;
+
+		double times[(int)ConvertPath::COUNT] = {};
+		for(int path = 0; path < (int)ConvertPath::COUNT; path++) {
+			if(path == (int)ConvertPath::MEMCPY && attribute.mFormat != VertexConvert::Format::FLOAT) {
+				continue;
+			}
+			std::vector<BenchmarkVert>& vertices = path == (int)ConvertPath::SIMD ? simdVertices : scalarVertices;
+			times[path] = TimeAttribute((ConvertPath)path, stream, attribute, vertices, aRuns);
+			totals[path] += times[path];
+		}
+		//both paths should give the same floats
+		for(int v = 0; v < aNumVertices && matches; v++) {
+			const uint8_t* scalar = (const uint8_t*)&scalarVertices[v] + attribute.mDestOffset;
+			const uint8_t* simd = (const uint8_t*)&simdVertices[v] + attribute.mDestOffset;
+			if(memcmp(scalar, simd, attribute.mDestComponents * sizeof(float)) != 0) {
+				LOGGER::Formated("\t{} mismatch at vertex {}\n", attribute.mName, v);
+				matches = false;
+			}
+		}
+
+		const double simdRate = sourceBytes / (1024.0 * 1024.0) / (times[(int)ConvertPath::SIMD] / 1000.0);
+		if(times[(int)ConvertPath::MEMCPY] > 0) {
+			LOGGER::Formated("\t{:<20} memcpy {:.3f} ms scalar {:.3f} ms simd {:.3f} ms ({:.0f} MB/s, {:.2f}x memcpy)\n",
+							 attribute.mName,
+							 times[(int)ConvertPath::MEMCPY],
+							 times[(int)ConvertPath::SCALAR],
+							 times[(int)ConvertPath::SIMD],
+							 simdRate,
+							 times[(int)ConvertPath::MEMCPY] / times[(int)ConvertPath::SIMD]);
+		} else {
+			LOGGER::Formated("\t{:<20} scalar {:.3f} ms simd {:.3f} ms ({:.0f} MB/s, {:.2f}x scalar)\n",
+							 attribute.mName,
+							 times[(int)ConvertPath::SCALAR],
+							 times[(int)ConvertPath::SIMD],
+							 simdRate,
+							 times[(int)ConvertPath::SCALAR] / times[(int)ConvertPath::SIMD]);
+		}
+	}
+	LOGGER::Formated("\ttotal scalar {:.3f} ms simd {:.3f} ms\n", totals[(int)ConvertPath::SCALAR], totals[(int)ConvertPath::SIMD]);
+
+	//indices, 16 bit is the common case
+	std::vector<uint16_t> indices16(aNumVertices * 3);
+	for(size_t i = 0; i < indices16.size(); i++) {
+		indices16[i] = (uint16_t)(i * 7);
+	}
+	std::vector<uint32_t> indices(indices16.size());
+	double best = 0;
+	for(int run = 0; run < aRuns; run++) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		VertexConvert::ConvertIndices(indices16.data(), sizeof(uint16_t), sizeof(uint16_t), indices.data(), indices.size());
+		const auto end = std::chrono::high_resolution_clock::now();
+		const double time = std::chrono::duration<double, std::milli>(end - start).count();
+		best = run == 0 ? time : std::min(best, time);
+	}
+	LOGGER::Formated("\t{:<20} {:.3f} ms ({} indices)\n", "indices uint16", best, indices.size());
+	return matches;
+}
+
+int main(int argc, char** argv) {
+	int numVertices = cDefaultVertices;
+	int runs = cDefaultRuns;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-vertices") == 0 && i + 1 < argc) {
+			numVertices = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-runs") == 0 && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else {
+			LOGGER::Formated("Unknown argument {}\nVertexConvertBenchmark [-vertices N] [-runs N]\n", argv[i]);
+			return 1;
+		}
+	}
+	if(numVertices <= 0 || runs <= 0) {
+		LOGGER::Log("-vertices and -runs need to be above 0\n");
+		return 1;
+	}
+
+	bool matches = true;
+	for(const BenchmarkLayout& layout: cLayouts) {
+		matches &= RunLayout(layout, numVertices, runs);
+	}
+	return matches ? 0 : 1;
+}
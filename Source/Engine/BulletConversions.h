@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+#include <LinearMath/btTransform.h>
+#include <LinearMath/btVector3.h>
+#include <LinearMath/btQuaternion.h>
+
+#include "Engine/Transform.h"
+
+//split from Graphics/Conversions.h so the physics can build without the assimp or vulkan headers
+
+static glm::vec3 BulletToGlm(const btVector3& aOther) {
+	return glm::vec3(aOther.getX(), aOther.getY(), aOther.getZ());
+}
+
+static glm::vec4 BulletToGlm(const btVector4& aOther) {
+	return glm::vec4(aOther.getX(), aOther.getY(), aOther.getZ(), aOther.getW());
+}
+
+static glm::quat BulletToGlm(const btQuaternion& aOther) {
+	return glm::quat(aOther.getW(), aOther.getX(), aOther.getY(), aOther.getZ());
+}
+
+static SimpleTransform BulletToGlm(const btTransform& aOther) {
+	const glm::vec3 position = BulletToGlm(aOther.getOrigin());
+	const glm::quat rotation = BulletToGlm(aOther.getRotation());
+	return SimpleTransform(position, glm::vec3(1.0f), rotation);
+}
+
+static btVector3 GlmToBullet(const glm::vec3& aOther) {
+	return btVector3(aOther.x, aOther.y, aOther.z);
+}
+
+static btQuaternion GlmToBullet(const glm::quat& aOther) {
+	return btQuaternion(aOther.x, aOther.y, aOther.z, aOther.w);
+}
+
+static btTransform TransformLocalToBullet(const SimpleTransform& aOther) {
+	return btTransform(GlmToBullet(aOther.GetLocalRotation()), GlmToBullet(aOther.GetLocalPosition()));
+}
+
+static btTransform TransformWorldToBullet(Transform& aOther) {
+	return btTransform(GlmToBullet(aOther.GetWorldRotation()), GlmToBullet(aOther.GetWorldPosition()));
+}
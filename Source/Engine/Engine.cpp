@@ -51,7 +51,7 @@ bool Engine::GameLoop() {
 		WorkManager::ProcessMainThreadWork();
 
 		//possibly async?
-		gPhysics->Update();
+		gPhysics->Update(GetDeltaTime());
 
 		mGraphics->StartNewFrame();
 
@@ -5,6 +5,15 @@
 
 #include "PlatformDebug.h"
 
+#if PLATFORM_WINDOWS
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
 namespace FileIO {
 
 	File LoadFile(Path aPath) {
@@ -27,11 +36,104 @@ namespace FileIO {
 		return file;
 	}
 
+	File MapFile(Path aPath) {
+		ZoneScoped;
+		File file;
+#if PLATFORM_WINDOWS
+		HANDLE fileHandle =
+			CreateFileA(aPath.String().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(fileHandle == INVALID_HANDLE_VALUE) {
+			return file;
+		}
+		LARGE_INTEGER size;
+		if(!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+			CloseHandle(fileHandle);
+			return file;
+		}
+		//the view keeps the file open
+		HANDLE mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(fileHandle);
+		if(mapping == nullptr) {
+			return file;
+		}
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if(data == nullptr) {
+			CloseHandle(mapping);
+			return file;
+		}
+		file.mMapHandle = mapping;
+		file.mSize = size.QuadPart;
+#else
+		const int fileHandle = open(aPath.String().c_str(), O_RDONLY);
+		if(fileHandle == -1) {
+			return file;
+		}
+		struct stat info;
+		if(fstat(fileHandle, &info) != 0 || info.st_size == 0) {
+			close(fileHandle);
+			return file;
+		}
+		void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fileHandle, 0);
+		//the mapping keeps the file open
+		close(fileHandle);
+		if(data == MAP_FAILED) {
+			return file;
+		}
+		file.mSize = info.st_size;
+#endif
+		file.mData = (char*)data;
+		file.mMapped = true;
+		return file;
+	}
+
 	void UnloadFile(File& aFile) {
-		if(aFile.mData) {
+		if(aFile.mData == nullptr) {
+			return;
+		}
+		if(aFile.mMapped) {
+#if PLATFORM_WINDOWS
+			UnmapViewOfFile(aFile.mData);
+			CloseHandle(aFile.mMapHandle);
+#else
+			munmap(aFile.mData, aFile.mSize);
+#endif
+			aFile.mMapped = false;
+			aFile.mMapHandle = nullptr;
+		} else {
 			delete[] aFile.mData;
-			aFile.mData = nullptr;
 		}
+		aFile.mData = nullptr;
+	}
+
+	bool SaveFile(Path aPath, const void* aData, size_t aSize) {
+		ZoneScoped;
+		const std::filesystem::path path = aPath.String();
+		std::error_code error;
+		if(path.has_parent_path()) {
+			std::filesystem::create_directories(path.parent_path(), error);
+		}
+
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		{
+			std::ofstream fileStream(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			if(!fileStream.is_open()) {
+				LOGGER::Formated("Failed to open {} for writing\n", tempPath.generic_string());
+				return false;
+			}
+			fileStream.write((const char*)aData, aSize);
+			if(!fileStream.good()) {
+				LOGGER::Formated("Failed to write {}\n", tempPath.generic_string());
+				return false;
+			}
+		}
+		std::filesystem::rename(tempPath, path, error);
+		if(error) {
+			LOGGER::Formated("Failed to move {} to {}: {}\n", tempPath.generic_string(), path.generic_string(), error.message());
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		return true;
 	}
 
 }; // namespace FileIO
\ No newline at end of file
@@ -20,7 +20,7 @@ namespace FileIO {
 		}
 
 	private:
-		const std::filesystem::path mPath;
+		std::filesystem::path mPath;
 	};
 
 	struct File {
@@ -28,7 +28,14 @@ namespace FileIO {
 		Path mPath;
 		char* mData	 = nullptr;
 		size_t mSize = 0;
+		//set by MapFile, mData points into the mapping instead of an allocation
+		bool mMapped = false;
+		void* mMapHandle = nullptr;
 	};
 	File LoadFile(Path aPath);
+	//read only mapping of the whole file, mData is nullptr if the file can't be opened
+	File MapFile(Path aPath);
 	void UnloadFile(File& aFile);
+	//writes to a temp file then renames it over aPath, so readers never see a partial file
+	bool SaveFile(Path aPath, const void* aData, size_t aSize);
 }; // namespace FileIO
\ No newline at end of file
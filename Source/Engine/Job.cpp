@@ -83,8 +83,10 @@ void Job::Work::DoWork(bool aOnlyFinish /*= false*/) {
 		//gManager.mWorkHandles.erase(result);
 		//lock.unlock();
 		if(mHandle != nullptr) {
-			mHandle->mIsDone  = true;
+			//WaitForWork reads mWorkRef under this lock
+			std::unique_lock lock(gManager.mWorkAccesser);
 			mHandle->mWorkRef = nullptr;
+			mHandle->mIsDone  = true;
 		}
 		delete this;
 	}
@@ -175,36 +177,44 @@ bool Job::WaitForWork(const Job::WorkHandle* aHandle) {
 		return true;
 	}
 	//modifying arrays, lock thread
+	//DoWork clears mWorkRef under this lock before deleting the work
 	std::unique_lock lock(gManager.mWorkAccesser);
 	Work* work = aHandle->mWorkRef;
+	if(work == nullptr) { //finished and deleted
+		lock.unlock();
+		return true;
+	}
+	//the work can be deleted once we unlock, copy what we need now
+	const bool finishOnMainThread = work->mFinishOnMainThread;
 	switch(work->mWorkState) {
 		case WorkState::FINISHED: //task already finished, no waiting
 			lock.unlock();
 			return true;
 		case WorkState::QUEUED: //task not started, wait by doing the task in this thread
 		{
-			auto result = std::find(gManager.mWorkMain.begin(), gManager.mWorkMain.end(), work);
-			gManager.mWorkMain.erase(result);
-			lock.unlock();
-			if(Job::IsMainThread() && work->mFinishOnMainThread) {
+			if(Job::IsMainThread() && finishOnMainThread) {
+				lock.unlock();
 				ASSERT(false); //on main thread, needing finish work on main thread?
 				return false;
-			} else {
-				work->DoWork();
 			}
+			auto result = std::find(gManager.mWork.begin(), gManager.mWork.end(), work);
+			ASSERT(result != gManager.mWork.end());
+			gManager.mWork.erase(result);
+			work->mWorkState = WorkState::STARTED;
+			lock.unlock();
+			work->DoWork();
 		}
 			return true;
 		default: //work started, wait for it to finish
 			lock.unlock();
-			if(Job::IsMainThread() && work->mFinishOnMainThread) {
+			if(Job::IsMainThread() && finishOnMainThread) {
 				ASSERT(false); //on main thread, needing finish work on main thread?
 				return false;
 			}
 			//todo revisit Work wait
-			do {
-			} while(!aHandle->mIsDone); //keep checking
-			if(work->mFinishOnMainThread) {
-				ASSERT(false); //todo
+			//work is deleted by the thread that finishes it, only the handle is safe to read
+			while(!aHandle->mIsDone) { //keep checking
+				std::this_thread::yield();
 			}
 			return true;
 	}
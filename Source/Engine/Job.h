@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <atomic>
 
 struct WorkManager {
 	static void Startup();
@@ -44,8 +45,9 @@ struct Job {
 		~WorkHandle(){};
 
 	protected:
-		bool mIsDone		 = false;
-		class Work* mWorkRef = nullptr;
+		//set by the thread that finished the work
+		std::atomic<bool> mIsDone = false;
+		class Work* mWorkRef	  = nullptr;
 
 		friend Work;
 		friend Worker;
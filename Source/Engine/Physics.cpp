@@ -1,31 +1,88 @@
 #include "Physics.h"
 
 #include <vector>
+#include <algorithm>
 
 #include <btBulletDynamicsCommon.h>
 #include <imgui.h>
 
-#include "Engine.h"
+#include "Job.h"
 #include "PlatformDebug.h"
 #include "PhysicsObject.h"
 #include "Transform.h"
-#include "Graphics/Mesh.h"
-#include "Graphics/Conversions.h"
+#include "BulletConversions.h"
 
 extern ContactStartedCallback gContactStartedCallback;
+extern ContactEndedCallback gContactEndedCallback;
 
 Physics* gPhysics = nullptr;
 
-//callback on every collision
-void CollisionCallback(btPersistentManifold* const& manifold) {
-	//LOGGER::Log("Collision\n");
-}
+//bullet syncs each active motion state with a virtual setWorldTransform call at the end of stepSimulation
+//we skip that and let Physics::SyncTransforms gather the poses in one pass instead
+class PhysicsWorld : public btDiscreteDynamicsWorld {
+public:
+	PhysicsWorld(btDispatcher* aDispatcher, btBroadphaseInterface* aPairCache, btConstraintSolver* aConstraintSolver,
+				 btCollisionConfiguration* aCollisionConfiguration) :
+		btDiscreteDynamicsWorld(aDispatcher, aPairCache, aConstraintSolver, aCollisionConfiguration) {};
+
+	void synchronizeMotionStates() override {
+		//done in Physics::SyncTransforms
+	}
+
+	//time left over from the last fixed step, needed to restore a snapshot exactly
+	btScalar GetLocalTime() const {
+		return m_localTime;
+	}
+	void SetLocalTime(btScalar aLocalTime) {
+		m_localTime = aLocalTime;
+	}
+
+	//same interpolation as btDiscreteDynamicsWorld::synchronizeSingleMotionState
+	template<typename Func>
+	void ForEachActivePose(const Func& aFunc) {
+		//the hit fraction only applies without latency interpolation
+		const bool latencyInterpolation = m_latencyMotionStateInterpolation && m_fixedTimeStep;
+		const int numBodies = m_nonStaticRigidBodies.size();
+		for(int i = 0; i < numBodies; i++) {
+			btRigidBody* body = m_nonStaticRigidBodies[i];
+			if(!body->isActive() || body->getMotionState() == nullptr || body->isStaticOrKinematicObject()) {
+				continue;
+			}
+			const btScalar interpolationTime = latencyInterpolation ? m_localTime - m_fixedTimeStep : m_localTime * body->getHitFraction();
+			btTransform interpolatedTransform;
+			btTransformUtil::integrateTransform(body->getInterpolationWorldTransform(),
+												body->getInterpolationLinearVelocity(),
+												body->getInterpolationAngularVelocity(),
+												interpolationTime,
+												interpolatedTransform);
+			aFunc(body, interpolatedTransform);
+		}
+	}
+};
+
+struct SnapshotHeader {
+	uint32_t mNumBodies;
+	float mLocalTime;
+	//solver randomizes constraint order with this
+	uint32_t mSolverSeed;
+};
+
+struct SnapshotBody {
+	glm::vec3 mPosition;
+	glm::quat mRotation;
+	glm::vec3 mLinearVelocity;
+	glm::vec3 mAngularVelocity;
+	int32_t mActivationState;
+	float mDeactivationTime;
+};
 
 void Physics::Startup() {
 	ASSERT(gPhysics == nullptr);
 	gPhysics = this;
 
-	gContactStartedCallback = &CollisionCallback;
+	gContactStartedCallback = &Physics::ContactStarted;
+	gContactEndedCallback = &Physics::ContactEnded;
+	mContactEvents.reserve(mMaxContactEvents);
 
 	mCollisionConfiguration = new btDefaultCollisionConfiguration();
 
@@ -35,13 +92,15 @@ void Physics::Startup() {
 
 	mSolver = new btSequentialImpulseConstraintSolver();
 
-	mDynamicsWorld = new btDiscreteDynamicsWorld(mDispatcher, mOverlappingPairCache, mSolver, mCollisionConfiguration);
+	mDynamicsWorld = new PhysicsWorld(mDispatcher, mOverlappingPairCache, mSolver, mCollisionConfiguration);
 
 	mDynamicsWorld->setGravity(btVector3(0, -10, 0));
 }
 
 void Physics::Shutdown() {
 	ASSERT(gPhysics != nullptr);
+	//pools call back into game code, should be destroyed by whoever made them
+	ASSERT(mPools.empty());
 
 	delete mDynamicsWorld;
 
@@ -54,11 +113,12 @@ void Physics::Shutdown() {
 	delete mCollisionConfiguration;
 
 	gContactStartedCallback = 0;
+	gContactEndedCallback = 0;
 
 	gPhysics = nullptr;
 }
 
-void Physics::Update() {
+void Physics::Update(const float aDeltaTime) {
 	ASSERT(gPhysics != nullptr);
 
 	//for(int j = mDynamicsWorld->getNumCollisionObjects() - 1; j >= 0; j--) {
@@ -72,18 +132,18 @@ void Physics::Update() {
 
 	mActiveObjects = 0;
 
+	mContactEvents.clear();
+	mContactEventsDropped = 0;
+
 	//
-	int output = mDynamicsWorld->stepSimulation(gEngine->GetDeltaTime());
+	mStepping = true;
+	int output = mDynamicsWorld->stepSimulation(aDeltaTime);
+	mStepping = false;
+
+	SyncTransforms();
 
 	mCollisionsLastFrame = mDispatcher->getNumManifolds();
-	for(int j = mCollisionsLastFrame - 1; j >= 0; j--) {
-		const btPersistentManifold* manifold = mDispatcher->getManifoldByIndexInternal(j);
-		if(manifold->getNumContacts() != 0) {
-			const btManifoldPoint& collisionPoint = manifold->getContactPoint(0);
-			const btVector3 position = collisionPoint.getPositionWorldOnB();
-		}
-		//what does a manifold with 0 contacts mean??
-	}
+	ProcessContactEvents();
 
 	for(int j = mDynamicsWorld->getNumCollisionObjects() - 1; j >= 0; j--) {
 		btCollisionObject* colObj = mDynamicsWorld->getCollisionObjectArray()[j];
@@ -98,16 +158,198 @@ void Physics::Update() {
 	}
 }
 
+int Physics::GetNumCollisionObjects() const {
+	return mDynamicsWorld->getNumCollisionObjects();
+}
+
 void Physics::ImGuiWindow() {
 	if(ImGui::Begin("Physics")) {
 		ImGui::Text("Num Collision Objects: %i", mDynamicsWorld->getNumCollisionObjects());
 		ImGui::Text("Num Active Objects: %i", mActiveObjects);
 		ImGui::Text("Num Collisions: %i", mCollisionsLastFrame);
 		ImGui::Text("Num RigidBodies: %i", mDynamicsWorld->getNonStaticRigidBodies().size());
+		ImGui::Text("Bodies Synced: %i (%i jobs)", mBodiesSyncedLastFrame, mSyncJobsLastFrame);
+		ImGui::Text("Contact Events: %i (%i dropped)", (int)mContactEvents.size(), mContactEventsDropped);
+		ImGui::Text("Persisting Contacts: %i", (int)mPersistingManifolds.size());
+		for(int i = 0; i < mPools.size(); i++) {
+			const PhysicsPool* pool = mPools[i];
+			ImGui::Text("Pool %i: %i/%i active, %i created, %i spawns (%i recycled)",
+						i,
+						(int)pool->mActive.size(),
+						pool->mMaxObjects,
+						(int)pool->mObjects.size(),
+						pool->mSpawns,
+						pool->mRecycled);
+		}
+		if(ImGui::Button("Save Snapshot")) {
+			SaveSnapshot(mDebugSnapshot);
+		}
+		ImGui::SameLine();
+		ImGui::BeginDisabled(mDebugSnapshot.mData.empty());
+		if(ImGui::Button("Restore Snapshot")) {
+			RestoreSnapshot(mDebugSnapshot);
+		}
+		ImGui::EndDisabled();
+		ImGui::SameLine();
+		ImGui::Text("%i bytes", (int)mDebugSnapshot.mData.size());
+		ImGui::Checkbox("Parallel Sync", &mParallelSync);
+		ImGui::DragInt("Parallel Sync Threshold", &mParallelSyncThreshold, 16.0f, 64, 65536);
 	}
 	ImGui::End();
 }
 
+//static
+void Physics::ContactStarted(btPersistentManifold* const& aManifold) {
+	const PhysicsObject* objectA = (PhysicsObject*)aManifold->getBody0()->getUserPointer();
+	const PhysicsObject* objectB = (PhysicsObject*)aManifold->getBody1()->getUserPointer();
+	const uint8_t flags = (objectA ? objectA->mContactEvents : 0) | (objectB ? objectB->mContactEvents : 0);
+	if(flags & (PhysicsObject::CONTACT_BEGIN | PhysicsObject::CONTACT_PERSIST)) {
+		//contact point is not in the manifold yet, get it after the step
+		gPhysics->mBegunManifolds.push_back(aManifold);
+	}
+}
+
+//static
+void Physics::ContactEnded(btPersistentManifold* const& aManifold) {
+	//manifold is about to be cleared or released, stop tracking it
+	const auto RemoveManifold = [aManifold](std::vector<const btPersistentManifold*>& aList) {
+		auto result = std::find(aList.begin(), aList.end(), aManifold);
+		if(result != aList.end()) {
+			*result = aList.back();
+			aList.pop_back();
+		}
+	};
+	RemoveManifold(gPhysics->mBegunManifolds);
+	RemoveManifold(gPhysics->mPersistingManifolds);
+
+	const PhysicsObject* objectA = (PhysicsObject*)aManifold->getBody0()->getUserPointer();
+	const PhysicsObject* objectB = (PhysicsObject*)aManifold->getBody1()->getUserPointer();
+	const uint8_t flags = (objectA ? objectA->mContactEvents : 0) | (objectB ? objectB->mContactEvents : 0);
+	if(flags & PhysicsObject::CONTACT_END) {
+		if(gPhysics->mStepping) {
+			gPhysics->AddContactEvent(ContactEventType::END, aManifold);
+		} else {
+			//removed outside the step, the objects might be deleted straight after so this can't wait for the next Update
+			gPhysics->mContactCallback.Call(MakeContactEvent(ContactEventType::END, aManifold));
+		}
+	}
+}
+
+//static
+ContactEvent Physics::MakeContactEvent(ContactEventType aType, const btPersistentManifold* aManifold) {
+	ContactEvent event;
+	event.mType = aType;
+	event.mObjectA = (PhysicsObject*)aManifold->getBody0()->getUserPointer();
+	event.mObjectB = (PhysicsObject*)aManifold->getBody1()->getUserPointer();
+	event.mPosition = glm::vec3(0);
+	event.mNormal = glm::vec3(0);
+	event.mImpulse = 0.0f;
+	if(aType != ContactEventType::END && aManifold->getNumContacts() != 0) {
+		const btManifoldPoint& point = aManifold->getContactPoint(0);
+		event.mPosition = BulletToGlm(point.getPositionWorldOnB());
+		event.mNormal = BulletToGlm(point.m_normalWorldOnB);
+		event.mImpulse = point.getAppliedImpulse();
+	}
+	return event;
+}
+
+void Physics::AddContactEvent(ContactEventType aType, const btPersistentManifold* aManifold) {
+	if(mContactEvents.size() >= mMaxContactEvents) {
+		mContactEventsDropped++;
+		return;
+	}
+	mContactEvents.push_back(MakeContactEvent(aType, aManifold));
+}
+
+void Physics::ForgetContactEvents(const PhysicsObject* aObject) {
+	for(int i = 0; i < mContactEvents.size(); i++) {
+		ContactEvent& event = mContactEvents[i];
+		if(event.mObjectA == aObject) {
+			event.mObjectA = nullptr;
+		}
+		if(event.mObjectB == aObject) {
+			event.mObjectB = nullptr;
+		}
+	}
+}
+
+void Physics::ProcessContactEvents() {
+	ZoneScoped;
+	//only manifolds that someone asked about, instead of every manifold in the dispatcher
+	for(int i = 0; i < mPersistingManifolds.size(); i++) {
+		AddContactEvent(ContactEventType::PERSIST, mPersistingManifolds[i]);
+	}
+	for(int i = 0; i < mBegunManifolds.size(); i++) {
+		const btPersistentManifold* manifold = mBegunManifolds[i];
+		const PhysicsObject* objectA = (PhysicsObject*)manifold->getBody0()->getUserPointer();
+		const PhysicsObject* objectB = (PhysicsObject*)manifold->getBody1()->getUserPointer();
+		const uint8_t flags = (objectA ? objectA->mContactEvents : 0) | (objectB ? objectB->mContactEvents : 0);
+		if(flags & PhysicsObject::CONTACT_BEGIN) {
+			AddContactEvent(ContactEventType::BEGIN, manifold);
+		}
+		if(flags & PhysicsObject::CONTACT_PERSIST) {
+			mPersistingManifolds.push_back(manifold);
+		}
+	}
+	mBegunManifolds.clear();
+
+	for(int i = 0; i < mContactEvents.size(); i++) {
+		mContactCallback.Call(mContactEvents[i]);
+	}
+}
+
+void Physics::SyncTransforms() {
+	ZoneScoped;
+	mPoseSyncs.clear();
+	mDynamicsWorld->ForEachActivePose([&](btRigidBody* aBody, const btTransform& aTransform) {
+		PhysicsObject* object = (PhysicsObject*)aBody->getUserPointer();
+		//something else owns this motion state, let it sync itself
+		if(object == nullptr || object != aBody->getMotionState() || object->GetTransform() == nullptr) {
+			aBody->getMotionState()->setWorldTransform(aTransform);
+			return;
+		}
+		mPoseSyncs.push_back({object, BulletToGlm(aTransform.getOrigin()), BulletToGlm(aTransform.getRotation())});
+	});
+
+	const int numSyncs = mPoseSyncs.size();
+	mBodiesSyncedLastFrame = numSyncs;
+	mSyncJobsLastFrame = 0;
+
+	const auto ApplyPoses = [this](int aStart, int aEnd) {
+		ZoneScopedN("Apply Poses");
+		for(int i = aStart; i < aEnd; i++) {
+			const PoseSync& sync = mPoseSyncs[i];
+			Transform* transform = sync.mObject->mTransformLink;
+			transform->SetPosition(sync.mPosition);
+			transform->SetRotation(sync.mRotation);
+		}
+	};
+
+	if(!mParallelSync || numSyncs < mParallelSyncThreshold) {
+		ApplyPoses(0, numSyncs);
+		return;
+	}
+
+	//each transform is only touched once so the ranges can be written without locking
+	//main thread takes the first range while the workers do the rest
+	const int numRanges = (numSyncs + mParallelSyncThreshold - 1) / mParallelSyncThreshold;
+	std::vector<Job::Work> work(numRanges - 1);
+	for(int i = 0; i < work.size(); i++) {
+		const int start = (i + 1) * mParallelSyncThreshold;
+		const int end = std::min(start + mParallelSyncThreshold, numSyncs);
+		work[i].mWorkPtr = [ApplyPoses, start, end](void*) {
+			ApplyPoses(start, end);
+		};
+	}
+	std::vector<Job::WorkHandle*> handles = Job::QueueWorkHandle(work, Job::WorkPriority::TOP_OF_QUEUE);
+	ApplyPoses(0, std::min(mParallelSyncThreshold, numSyncs));
+	for(int i = 0; i < handles.size(); i++) {
+		Job::WaitForWork(handles[i]);
+		handles[i]->Reset();
+	}
+	mSyncJobsLastFrame = numRanges;
+}
+
 void Physics::AddingObjectsTestGround(PhysicsObject* aObject) {
 	glm::vec3 pos = aObject->GetTransform()->GetLocalPosition();
 	glm::vec3 scale = aObject->GetTransform()->GetLocalScale();
@@ -194,7 +436,7 @@ void Physics::AddingObjectsTestBox(PhysicsObject* aObject) {
 	AddRigidBody(aObject, colShape, 1.0f);
 }
 
-void Physics::AddingObjectsTestMesh(PhysicsObject* aObject, Mesh* aMesh) {
+void Physics::AddingObjectsTestMesh(PhysicsObject* aObject, const std::vector<PhysicsMeshPart>& aParts) {
 	//btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
 	//btIndexedMesh part;
 	//AABB aabb;
@@ -222,22 +464,23 @@ void Physics::AddingObjectsTestMesh(PhysicsObject* aObject, Mesh* aMesh) {
 	//const MeshVert* v = mesh.mVertices.data();
 	//btConvexHullShape* colShape = new btConvexHullShape((const btScalar*)v->mPos.x, mesh.mIndices.size(), sizeof(MeshVert));
 
-	int numObjects = aMesh->GetNumMesh();
+	int numObjects = aParts.size();
 	CompoundShapeHelper* colShape = new CompoundShapeHelper(true, numObjects);
 	for(int i = 0; i < numObjects; i++) {
-		const Mesh::SubMesh& mesh = aMesh->GetMesh(i);
+		const PhysicsMeshPart& mesh = aParts[i];
 
 		btIndexedMesh part;
-		part.m_vertexBase = (const unsigned char*)&aMesh->GetMesh(i).mVertices[0].mPos.x;
-		part.m_vertexStride = sizeof(MeshVert);
-		part.m_numVertices = aMesh->GetMesh(i).mVertices.size();
+		ASSERT(mesh.mNumPositions != 0 && mesh.mNumIndices != 0);
+		part.m_vertexBase = (const unsigned char*)mesh.mPositions;
+		part.m_vertexStride = mesh.mPositionStride;
+		part.m_numVertices = mesh.mNumPositions;
 		part.m_vertexType = PHY_FLOAT;
 
-		part.m_triangleIndexBase = (const unsigned char*)aMesh->GetMesh(i).mIndices.data();
-		part.m_triangleIndexStride = sizeof(MeshIndex) * 3;
-		part.m_numTriangles = aMesh->GetMesh(i).mIndices.size() / 3;
+		part.m_triangleIndexBase = (const unsigned char*)mesh.mIndices;
+		part.m_triangleIndexStride = sizeof(uint32_t) * 3;
+		part.m_numTriangles = mesh.mNumIndices / 3;
 		//part.m_indexType = PHY_INTEGER;
-		//aabb.Expand(aMesh->GetMesh(i).mAABB);
+		//aabb.Expand(mesh.mAABB);
 
 		btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
 		meshInterface->addIndexedMesh(part, part.m_indexType);
@@ -341,156 +584,205 @@ void Physics::RemovePhysicsObject(PhysicsObject* aObject) {
 	mDynamicsWorld->removeRigidBody(rb);
 	aObject->AttachRigidBody(nullptr);
 	delete rb;
+	//the caller usually deletes the object next
+	ForgetContactEvents(aObject);
 }
 
-PhysicsObject* Physics::Raycast(const glm::vec3& aPosition, const glm::vec3& aDirection, const float aLength) const {
-	const btVector3 rayFromWorld = GlmToBullet(aPosition);
-	const btVector3 rayToWorld = rayFromWorld + GlmToBullet(aDirection) * aLength;
-	btCollisionWorld::ClosestRayResultCallback result(rayFromWorld, rayToWorld);
-	result.m_collisionFilterGroup = (PhysicsFlags::Raycastable);
-	//result.m_collisionFilterMask &= ~(PhysicsFlags::Raycastable);
-	mDynamicsWorld->rayTest(rayFromWorld, rayToWorld, result);
-	if(result.hasHit()) {
-		const btRigidBody* body = btRigidBody::upcast(result.m_collisionObject);
-		return (PhysicsObject*)body->getUserPointer();
-	}
-	return nullptr;
+PhysicsPool* Physics::CreatePool(PoolShape aShape,
+								 int aMaxObjects,
+								 float aMass,
+								 std::function<Transform*(PhysicsObject*)> aCreateTransform,
+								 std::function<void(PhysicsObject*)> aDestroyTransform) {
+	ASSERT(aMaxObjects > 0);
+	ASSERT(aCreateTransform);
+	PhysicsPool* pool = new PhysicsPool();
+	pool->mShape = aShape;
+	pool->mMaxObjects = aMaxObjects;
+	pool->mMass = aMass;
+	pool->mCreateTransform = aCreateTransform;
+	pool->mDestroyTransform = aDestroyTransform;
+	pool->mObjects.reserve(aMaxObjects);
+	pool->mFree.reserve(aMaxObjects);
+	mPools.push_back(pool);
+	return pool;
 }
 
-//from the example
-void Physics::Test() {
-	//keep track of the shapes, we release memory at exit.
-	//make sure to re-use collision shapes among rigid bodies whenever possible!
-	btAlignedObjectArray<btCollisionShape*> collisionShapes;
-
-	std::vector<Transform> transforms(2);
-	std::vector<PhysicsObject> phyObjects(2);
-
-	///create a few basic rigid bodies
-
-	//the ground is a cube of side 100 at position y = -56.
-	//the sphere will hit it at y = -6, with center at -5
-	{
-		btCollisionShape* groundShape = new btBoxShape(btVector3(btScalar(50.), btScalar(50.), btScalar(50.)));
-
-		collisionShapes.push_back(groundShape);
-
-		btTransform groundTransform;
-		groundTransform.setIdentity();
-		groundTransform.setOrigin(btVector3(0, -56, 0));
-
-		btScalar mass(0.);
-
-		//rigidbody is dynamic if and only if mass is non zero, otherwise static
-		bool isDynamic = (mass != 0.f);
-
-		btVector3 localInertia(0, 0, 0);
-		if(isDynamic)
-			groundShape->calculateLocalInertia(mass, localInertia);
-
-		//using motionstate is optional, it provides interpolation capabilities, and only synchronizes 'active' objects
-		btDefaultMotionState* myMotionState = new btDefaultMotionState(groundTransform);
-		btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, myMotionState, groundShape, localInertia);
-		btRigidBody* body = new btRigidBody(rbInfo);
-
-		phyObjects[0].AttachTransform(&transforms[0]);
-		phyObjects[0].AttachRigidBody(body);
-
-		//add the body to the dynamics world
-		mDynamicsWorld->addRigidBody(body);
+void Physics::DestroyPool(PhysicsPool* aPool) {
+	for(int i = 0; i < aPool->mObjects.size(); i++) {
+		PhysicsObject* object = aPool->mObjects[i];
+		btRigidBody* body = object->GetRigidBody();
+		if(body->isInWorld()) {
+			mDynamicsWorld->removeRigidBody(body);
+		}
+		object->AttachRigidBody(nullptr);
+		delete body->getCollisionShape();
+		delete body;
+		if(aPool->mDestroyTransform) {
+			aPool->mDestroyTransform(object);
+		}
+		ForgetContactEvents(object);
+		delete object;
 	}
 
-	{
-		//create a dynamic rigidbody
-
-		//btCollisionShape* colShape = new btBoxShape(btVector3(1,1,1));
-		btCollisionShape* colShape = new btSphereShape(btScalar(1.));
-		collisionShapes.push_back(colShape);
-
-		/// Create Dynamic Objects
-		btTransform startTransform;
-		startTransform.setIdentity();
-
-		btScalar mass(1.f);
+	mPools.erase(std::find(mPools.begin(), mPools.end(), aPool));
+	delete aPool;
+}
 
-		//rigidbody is dynamic if and only if mass is non zero, otherwise static
-		bool isDynamic = (mass != 0.f);
+PhysicsObject* Physics::SpawnPooled(PhysicsPool* aPool, const SimpleTransform& aTransform) {
+	ZoneScoped;
+	PhysicsObject* object = nullptr;
+	if(!aPool->mFree.empty()) {
+		object = aPool->mFree.back();
+		aPool->mFree.pop_back();
+	} else if(aPool->mObjects.size() < aPool->mMaxObjects) {
+		//first use of this slot, the shape gets its size from the transform in UpdateToPhysics
+		object = new PhysicsObject();
+		object->AttachTransform(aPool->mCreateTransform(object));
+		object->GetTransform()->CopyTransform(aTransform);
+		btCollisionShape* shape = nullptr;
+		switch(aPool->mShape) {
+			case PoolShape::BOX:
+				shape = new btBoxShape(GlmToBullet(aTransform.GetLocalScale() / 2.0f));
+				break;
+			case PoolShape::SPHERE:
+				shape = new btSphereShape(aTransform.GetLocalScale().x / 2.0f);
+				break;
+		}
+		AddRigidBody(object, shape, aPool->mMass);
+		aPool->mObjects.push_back(object);
+		aPool->mActive.push_back(object);
+		aPool->mSpawns++;
+		return object;
+	} else {
+		//pool is full, take the oldest
+		object = aPool->mActive.front();
+		aPool->mActive.pop_front();
+		if(aPool->mRecycledCallback) {
+			aPool->mRecycledCallback(object);
+		}
+		//removing clears its contact pairs, so it doesn't keep old contacts after teleporting
+		mDynamicsWorld->removeRigidBody(object->GetRigidBody());
+		aPool->mRecycled++;
+	}
 
+	btRigidBody* body = object->GetRigidBody();
+	object->GetTransform()->CopyTransform(aTransform);
+	object->ResetPhysics();
+	//stop the first sync interpolating from where it was despawned
+	body->setInterpolationWorldTransform(body->getWorldTransform());
+	body->setInterpolationLinearVelocity(btVector3(0, 0, 0));
+	body->setInterpolationAngularVelocity(btVector3(0, 0, 0));
+	//scale may have changed the shape
+	if(aPool->mMass != 0.0f) {
 		btVector3 localInertia(0, 0, 0);
-		if(isDynamic)
-			colShape->calculateLocalInertia(mass, localInertia);
-
-		startTransform.setOrigin(btVector3(2, 10, 0));
+		body->getCollisionShape()->calculateLocalInertia(aPool->mMass, localInertia);
+		body->setMassProps(aPool->mMass, localInertia);
+		body->updateInertiaTensor();
+	}
+	mDynamicsWorld->addRigidBody(body);
 
-		//using motionstate is recommended, it provides interpolation capabilities, and only synchronizes 'active' objects
-		btDefaultMotionState* myMotionState = new btDefaultMotionState(startTransform);
-		btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, myMotionState, colShape, localInertia);
-		btRigidBody* body = new btRigidBody(rbInfo);
+	aPool->mActive.push_back(object);
+	aPool->mSpawns++;
+	return object;
+}
 
-		phyObjects[1].AttachTransform(&transforms[1]);
-		phyObjects[1].AttachRigidBody(body);
+void Physics::DespawnPooled(PhysicsPool* aPool, PhysicsObject* aObject) {
+	auto result = std::find(aPool->mActive.begin(), aPool->mActive.end(), aObject);
+	ASSERT(result != aPool->mActive.end());
+	aPool->mActive.erase(result);
+	mDynamicsWorld->removeRigidBody(aObject->GetRigidBody());
+	aPool->mFree.push_back(aObject);
+}
 
-		mDynamicsWorld->addRigidBody(body);
+void Physics::SaveSnapshot(PhysicsSnapshot& aSnapshot) const {
+	ZoneScoped;
+	const int numBodies = mDynamicsWorld->getNumCollisionObjects();
+	aSnapshot.mData.resize(sizeof(SnapshotHeader) + sizeof(SnapshotBody) * numBodies);
+
+	SnapshotHeader* header = (SnapshotHeader*)aSnapshot.mData.data();
+	header->mNumBodies = numBodies;
+	header->mLocalTime = mDynamicsWorld->GetLocalTime();
+	header->mSolverSeed = mSolver->getRandSeed();
+
+	SnapshotBody* bodies = (SnapshotBody*)(header + 1);
+	const btCollisionObjectArray& objects = mDynamicsWorld->getCollisionObjectArray();
+	for(int i = 0; i < numBodies; i++) {
+		const btCollisionObject* object = objects[i];
+		const btRigidBody* body = btRigidBody::upcast(object);
+		SnapshotBody& state = bodies[i];
+		state.mPosition = BulletToGlm(object->getWorldTransform().getOrigin());
+		state.mRotation = BulletToGlm(object->getWorldTransform().getRotation());
+		state.mLinearVelocity = body ? BulletToGlm(body->getLinearVelocity()) : glm::vec3(0);
+		state.mAngularVelocity = body ? BulletToGlm(body->getAngularVelocity()) : glm::vec3(0);
+		state.mActivationState = object->getActivationState();
+		state.mDeactivationTime = object->getDeactivationTime();
 	}
+}
 
-	/// Do some simulation
-
-	///-----stepsimulation_start-----
-	for(int i = 0; i < 150; i++) {
-
-		for(int j = mDynamicsWorld->getNumCollisionObjects() - 1; j >= 0; j--) {
-			btCollisionObject* obj = mDynamicsWorld->getCollisionObjectArray()[j];
-			btRigidBody* body = btRigidBody::upcast(obj);
-			((PhysicsObject*)body->getUserPointer())->UpdateToPhysics();
-		}
+bool Physics::RestoreSnapshot(const PhysicsSnapshot& aSnapshot) {
+	ZoneScoped;
+	if(aSnapshot.mData.size() < sizeof(SnapshotHeader)) {
+		LOGGER::Log("Physics snapshot is empty\n");
+		return false;
+	}
+	const SnapshotHeader* header = (const SnapshotHeader*)aSnapshot.mData.data();
+	const int numBodies = mDynamicsWorld->getNumCollisionObjects();
+	if(header->mNumBodies != (uint32_t)numBodies || aSnapshot.mData.size() != sizeof(SnapshotHeader) + sizeof(SnapshotBody) * numBodies) {
+		LOGGER::Formated("Physics snapshot has {} bodies, world has {}\n", header->mNumBodies, numBodies);
+		return false;
+	}
 
-		mDynamicsWorld->stepSimulation(1.f / 60.f, 10);
-
-		//print positions of all objects
-		for(int j = mDynamicsWorld->getNumCollisionObjects() - 1; j >= 0; j--) {
-			btCollisionObject* obj = mDynamicsWorld->getCollisionObjectArray()[j];
-			btRigidBody* body = btRigidBody::upcast(obj);
-			btTransform trans;
-			if(body && body->getMotionState()) {
-				body->getMotionState()->getWorldTransform(trans);
-			} else {
-				trans = obj->getWorldTransform();
-				ASSERT(false);
+	mDynamicsWorld->SetLocalTime(header->mLocalTime);
+	mSolver->setRandSeed(header->mSolverSeed);
+
+	const SnapshotBody* bodies = (const SnapshotBody*)(header + 1);
+	btCollisionObjectArray& objects = mDynamicsWorld->getCollisionObjectArray();
+	for(int i = 0; i < numBodies; i++) {
+		btCollisionObject* object = objects[i];
+		const SnapshotBody& state = bodies[i];
+
+		btTransform transform;
+		transform.setOrigin(GlmToBullet(state.mPosition));
+		transform.setRotation(GlmToBullet(state.mRotation));
+		object->setWorldTransform(transform);
+		object->setInterpolationWorldTransform(transform);
+		object->forceActivationState(state.mActivationState);
+		object->setDeactivationTime(state.mDeactivationTime);
+
+		btRigidBody* body = btRigidBody::upcast(object);
+		if(body) {
+			body->setLinearVelocity(GlmToBullet(state.mLinearVelocity));
+			body->setAngularVelocity(GlmToBullet(state.mAngularVelocity));
+			body->setInterpolationLinearVelocity(body->getLinearVelocity());
+			body->setInterpolationAngularVelocity(body->getAngularVelocity());
+			body->clearForces();
+
+			//kinematic bodies read their transform back each step, and sleeping bodies won't be synced
+			PhysicsObject* physicsObject = (PhysicsObject*)body->getUserPointer();
+			if(physicsObject && physicsObject == body->getMotionState() && physicsObject->GetTransform()) {
+				physicsObject->GetTransform()->SetPosition(state.mPosition);
+				physicsObject->GetTransform()->SetRotation(state.mRotation);
 			}
-			((PhysicsObject*)body->getUserPointer())->UpdateFromPhysics();
-
-			printf("world pos object %d = %f,%f,%f\n",
-				   j,
-				   float(trans.getOrigin().getX()),
-				   float(trans.getOrigin().getY()),
-				   float(trans.getOrigin().getZ()));
 		}
-	}
-
-	///-----stepsimulation_end-----
-
-	//cleanup in the reverse order of creation/initialization
 
-	///-----cleanup_start-----
-
-	//remove the rigidbodies from the dynamics world and delete them
-	for(int i = mDynamicsWorld->getNumCollisionObjects() - 1; i >= 0; i--) {
-		btCollisionObject* obj = mDynamicsWorld->getCollisionObjectArray()[i];
-		btRigidBody* body = btRigidBody::upcast(obj);
-		if(body && body->getMotionState()) {
-			delete body->getMotionState();
+		//cached contacts would warm start the solver from the current state instead of the snapshot
+		if(object->getBroadphaseHandle()) {
+			mOverlappingPairCache->getOverlappingPairCache()->cleanProxyFromPairs(object->getBroadphaseHandle(), mDispatcher);
 		}
-		mDynamicsWorld->removeCollisionObject(obj);
-		delete obj;
 	}
+	return true;
+}
 
-	//delete collision shapes
-	for(int j = 0; j < collisionShapes.size(); j++) {
-		btCollisionShape* shape = collisionShapes[j];
-		collisionShapes[j] = 0;
-		delete shape;
+PhysicsObject* Physics::Raycast(const glm::vec3& aPosition, const glm::vec3& aDirection, const float aLength) const {
+	const btVector3 rayFromWorld = GlmToBullet(aPosition);
+	const btVector3 rayToWorld = rayFromWorld + GlmToBullet(aDirection) * aLength;
+	btCollisionWorld::ClosestRayResultCallback result(rayFromWorld, rayToWorld);
+	result.m_collisionFilterGroup = (PhysicsFlags::Raycastable);
+	//result.m_collisionFilterMask &= ~(PhysicsFlags::Raycastable);
+	mDynamicsWorld->rayTest(rayFromWorld, rayToWorld, result);
+	if(result.hasHit()) {
+		const btRigidBody* body = btRigidBody::upcast(result.m_collisionObject);
+		return (PhysicsObject*)body->getUserPointer();
 	}
-
-	//next line is optional: it will be cleared by the destructor when the array goes out of scope
-	collisionShapes.clear();
-}
\ No newline at end of file
+	return nullptr;
+}
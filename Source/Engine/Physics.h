@@ -1,21 +1,26 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <functional>
 #include <glm/glm.hpp>
 
 #include "Engine/Transform.h"
+#include "Engine/Callback.h"
+#include "Engine/AABB.h"
 
 class btDefaultCollisionConfiguration;
 class btCollisionDispatcher;
 class btBroadphaseInterface;
 class btSequentialImpulseConstraintSolver;
 class btDiscreteDynamicsWorld;
+class PhysicsWorld;
 class btCollisionShape;
 class btTypedConstraint;
 class btRigidBody;
+class btPersistentManifold;
 
 class PhysicsObject;
-class Mesh;
 
 enum PhysicsFlags
 {
@@ -23,12 +28,86 @@ enum PhysicsFlags
 	Raycastable = (1 << 6),
 };
 
+enum class ContactEventType
+{
+	BEGIN,
+	PERSIST,
+	END
+};
+
+struct ContactEvent {
+	ContactEventType mType;
+	//either can be nullptr if the body has no PhysicsObject
+	PhysicsObject* mObjectA;
+	PhysicsObject* mObjectB;
+	//world position on B and normal pointing from B to A, zero for END events
+	glm::vec3 mPosition;
+	glm::vec3 mNormal;
+	float mImpulse;
+};
+
+enum class PoolShape
+{
+	BOX,
+	SPHERE
+};
+
+//reusable bodies for objects that get spawned and despawned often, eg projectiles
+//objects keep their rigid body, shape and transform between spawns, despawning only takes them out of the world
+//spawning with all mMaxObjects in use despawns the least recently spawned object and calls mRecycledCallback for it
+struct PhysicsPool {
+	PoolShape mShape;
+	int mMaxObjects;
+	float mMass;
+	//called once per pool object to make the transform it's attached to, can AttachOther to link game data
+	std::function<Transform*(PhysicsObject*)> mCreateTransform;
+	//called for each pool object in Physics::DestroyPool
+	std::function<void(PhysicsObject*)> mDestroyTransform;
+	//optional, called when a full pool takes an active object for the next spawn, before it's moved
+	//anything still holding the object should let go of it, SpawnPooled returns it again as the new spawn
+	std::function<void(PhysicsObject*)> mRecycledCallback;
+
+	//spawned objects, least recently spawned first
+	const std::deque<PhysicsObject*>& GetActive() const {
+		return mActive;
+	}
+
+private:
+	friend class Physics;
+	//every object the pool has made, owned by the pool
+	std::vector<PhysicsObject*> mObjects;
+	std::deque<PhysicsObject*> mActive;
+	std::vector<PhysicsObject*> mFree;
+	int mSpawns = 0;
+	int mRecycled = 0;
+};
+
+//one triangle list of a static mesh collider, eg a Mesh::SubMesh
+//the positions and indices are used in place, they have to outlive the body
+struct PhysicsMeshPart {
+	const glm::vec3* mPositions;
+	uint32_t mPositionStride;
+	uint32_t mNumPositions;
+	const uint32_t* mIndices;
+	uint32_t mNumIndices;
+	glm::mat4 mMatrix;
+	AABB mAABB;
+};
+
+//flat copy of the state of every body in the world, eg for rewinding or rerunning a simulation from the same point
+//restoring needs the same bodies in the world in the same order as when it was saved
+struct PhysicsSnapshot {
+	//header followed by one state per collision object
+	std::vector<uint8_t> mData;
+};
+
 class Physics {
 public:
 	void Startup();
 	void Shutdown();
 
-	void Update();
+	//steps the world by aDeltaTime, engine passes the frame delta
+	void Update(const float aDeltaTime);
 
 	void ImGuiWindow();
 
@@ -39,17 +118,45 @@ public:
 	void AddingObjectsTestCompoundBoxs(PhysicsObject* aObject, const std::vector<SimpleTransform>& aObjects);
 	void AddingObjectsTestSphere(PhysicsObject* aObject);
 	void AddingObjectsTestBox(PhysicsObject* aObject);
-	void AddingObjectsTestMesh(PhysicsObject* aObject, Mesh* aMesh);
+	void AddingObjectsTestMesh(PhysicsObject* aObject, const std::vector<PhysicsMeshPart>& aParts);
 	btRigidBody* AddRigidBody(PhysicsObject* aObject, btCollisionShape* aShape, float mass);
 
 	btTypedConstraint* JoinTwoObject(PhysicsObject* aObject1, PhysicsObject* aObject2);
 	void RemoveContraintTemp(btTypedConstraint* aConstraint);
 	void RemovePhysicsObject(PhysicsObject* aObject);
 
+	PhysicsPool* CreatePool(PoolShape aShape,
+							int aMaxObjects,
+							float aMass,
+							std::function<Transform*(PhysicsObject*)> aCreateTransform,
+							std::function<void(PhysicsObject*)> aDestroyTransform);
+	void DestroyPool(PhysicsPool* aPool);
+	//sets the objects transform to aTransform and adds it to the world with no velocity
+	PhysicsObject* SpawnPooled(PhysicsPool* aPool, const SimpleTransform& aTransform);
+	void DespawnPooled(PhysicsPool* aPool, PhysicsObject* aObject);
+
+	void SaveSnapshot(PhysicsSnapshot& aSnapshot) const;
+	//returns false if the world has changed bodies since the snapshot
+	bool RestoreSnapshot(const PhysicsSnapshot& aSnapshot);
+
 	PhysicsObject* Raycast(const glm::vec3& aPosition, const glm::vec3& aDirection, const float aLength) const;
 
-	//testing the physics in a standalone update loop
-	void Test();
+	//events from the last step, only for pairs where one of the objects asked for them with PhysicsObject::SetContactEvents
+	//valid until the next Update, objects removed since then are nulled out
+	const std::vector<ContactEvent>& GetContactEvents() const {
+		return mContactEvents;
+	}
+	//called for each contact event after the step
+	//END events from removing or restoring bodies outside the step are only sent here, straight away while the objects still exist
+	Callback<void(const ContactEvent&)> mContactCallback;
+
+	int GetNumCollisionObjects() const;
+	int GetNumActiveObjects() const {
+		return mActiveObjects;
+	}
+	int GetNumCollisions() const {
+		return mCollisionsLastFrame;
+	}
 
 private:
 	///collision configuration contains default setup for memory, collision setup. Advanced users can create their own configuration.
@@ -64,12 +171,57 @@ private:
 	///the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
 	btSequentialImpulseConstraintSolver* mSolver;
 
-	btDiscreteDynamicsWorld* mDynamicsWorld;
+	//btDiscreteDynamicsWorld that leaves motion state syncing to SyncTransforms
+	PhysicsWorld* mDynamicsWorld;
 
 	//collisionShapes.push_back(groundShape);
 	std::vector<btCollisionShape*> mCollisionShapes;
 
+	std::vector<PhysicsPool*> mPools;
+
+	//for the ImGui save/restore buttons
+	PhysicsSnapshot mDebugSnapshot;
+
+	//bullet manifold callbacks, called during the step
+	static void ContactStarted(btPersistentManifold* const& aManifold);
+	static void ContactEnded(btPersistentManifold* const& aManifold);
+
+	static ContactEvent MakeContactEvent(ContactEventType aType, const btPersistentManifold* aManifold);
+	void AddContactEvent(ContactEventType aType, const btPersistentManifold* aManifold);
+	//nulls aObject out of the events list, before it's deleted
+	void ForgetContactEvents(const PhysicsObject* aObject);
+	//turns this frames new manifolds into BEGIN events and adds PERSIST events for the rest
+	void ProcessContactEvents();
+
+	//preallocated in Startup, events past mMaxContactEvents are dropped
+	std::vector<ContactEvent> mContactEvents;
+	int mMaxContactEvents = 4096;
+	int mContactEventsDropped = 0;
+	//manifolds ending outside of stepSimulation come from removed bodies
+	bool mStepping = false;
+	//manifolds that started touching during the step, waiting for their contact points
+	std::vector<const btPersistentManifold*> mBegunManifolds;
+	//touching manifolds that want PERSIST events
+	std::vector<const btPersistentManifold*> mPersistingManifolds;
+
+	//copies the poses of every active body back to their Transforms
+	//replaces bullet calling setWorldTransform per body
+	void SyncTransforms();
+
+	struct PoseSync {
+		PhysicsObject* mObject;
+		glm::vec3 mPosition;
+		glm::quat mRotation;
+	};
+	//filled by SyncTransforms each frame, kept around to avoid reallocating
+	std::vector<PoseSync> mPoseSyncs;
+	//split the transform writes into jobs once we have more than mParallelSyncThreshold bodies
+	bool mParallelSync = true;
+	int mParallelSyncThreshold = 1024;
+
 	int mActiveObjects = 0;
 	int mCollisionsLastFrame = 0;
+	int mBodiesSyncedLastFrame = 0;
+	int mSyncJobsLastFrame = 0;
 };
 extern Physics* gPhysics;
@@ -3,7 +3,7 @@
 #include <btBulletDynamicsCommon.h>
 
 #include "Transform.h"
-#include "Graphics/Conversions.h"
+#include "BulletConversions.h"
 
 void PhysicsObject::AttachTransform(Transform* aTransform) {
 	ASSERT(mTransformLink == nullptr);
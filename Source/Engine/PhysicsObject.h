@@ -16,6 +16,16 @@ class PhysicsObject : public btMotionState {
 	friend Physics;
 
 public:
+	//which contact events Physics should report for this object
+	enum ContactEvents
+	{
+		CONTACT_NONE = 0,
+		CONTACT_BEGIN = 1 << 0,
+		CONTACT_PERSIST = 1 << 1,
+		CONTACT_END = 1 << 2,
+		CONTACT_ALL = CONTACT_BEGIN | CONTACT_PERSIST | CONTACT_END
+	};
+
 	void AttachTransform(Transform* aTransform);
 	void AttachOther(void* aOther) {
 		mOtherLink = aOther;
@@ -26,6 +36,12 @@ public:
 	void SetKinematic(bool aIsKinematic);
 	void AddCollisionFlags(uint32_t aFlag);
 	void RemoveCollisionFlags(uint32_t aFlag);
+	void SetContactEvents(uint8_t aContactEvents) {
+		mContactEvents = aContactEvents;
+	}
+	uint8_t GetContactEvents() const {
+		return mContactEvents;
+	}
 
 	//quick removing of attachements
 	//we probably want to do some processing on the attachment to remove it from the other attached physics object..
@@ -59,6 +75,7 @@ protected:
 	void getWorldTransform(btTransform& worldTrans) const override;
 
 	//Bullet only calls the update of worldtransform for active objects
+	//Physics::SyncTransforms does this in bulk, so this is only a fallback
 	void setWorldTransform(const btTransform& worldTrans) override;
 #pragma endregion
 
@@ -69,6 +86,7 @@ private:
 	Transform* mTransformLink = nullptr;
 	btRigidBody* mRigidBodyLink = nullptr;
 	void* mOtherLink = nullptr;
+	uint8_t mContactEvents = CONTACT_NONE;
 
 	std::vector<btTypedConstraint*> mAttachments;
 };
@@ -53,6 +53,10 @@ bool Window::ShouldClose() {
 	return glfwWindowShouldClose(mWindow);
 }
 
+void Window::SetShouldClose() {
+	glfwSetWindowShouldClose(mWindow, GLFW_TRUE);
+}
+
 void Window::WaitEvents() {
 	return glfwWaitEvents();
 }
@@ -12,6 +12,8 @@ public:
 	void DestroySurface();
 
 	bool ShouldClose();
+	//ends the game loop as if the window was closed
+	void SetShouldClose();
 	void WaitEvents();
 	void Update();
 
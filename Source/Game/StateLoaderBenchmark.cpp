@@ -0,0 +1,301 @@
+#include "StateLoaderBenchmark.h"
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+
+#if PLATFORM_WINDOWS
+#	include <Windows.h>
+#	include <psapi.h>
+#else
+#	include <cstdio>
+#	include <unistd.h>
+#	include <sys/resource.h>
+#endif
+
+#include "PlatformDebug.h"
+#include "Engine/Engine.h"
+#include "Engine/Window.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Image.h"
+#include "Graphics/Helpers.h"
+
+//an asset that never finishes is skipped after this, loads that fail are noticed when their job finishes
+const double cAssetTimeoutMs = 120.0 * 1000.0;
+
+StateLoaderBenchmark::StateLoaderBenchmark(const std::string& aAssetPath, const std::string& aCsvPath, bool aUseCache)
+	: mAssetPath(aAssetPath), mCsvPath(aCsvPath), mUseCache(aUseCache) {}
+
+void StateLoaderBenchmark::StartUp() {
+	mPreviousUseCache = gMeshUseCache;
+	gMeshUseCache = mUseCache;
+
+	const std::vector<std::string> meshExtensions = {".gltf", ".glb", ".fbx", ".obj"};
+	const std::vector<std::string> imageExtensions = {".png", ".jpg", ".jpeg", ".tga", ".bmp", ".dds", ".ktx2"};
+	const auto HasExtension = [](const std::vector<std::string>& aExtensions, const std::string& aExtension) {
+		return std::find(aExtensions.begin(), aExtensions.end(), aExtension) != aExtensions.end();
+	};
+
+	//meshes first then images, each sorted so runs can be compared line by line
+	std::vector<std::string> meshes;
+	std::vector<std::string> images;
+	std::error_code error;
+	for(const auto& entry: std::filesystem::recursive_directory_iterator(mAssetPath, error)) {
+		if(!entry.is_regular_file()) {
+			continue;
+		}
+		const std::string extension = str_tolower(entry.path().extension().generic_string());
+		if(HasExtension(meshExtensions, extension)) {
+			meshes.push_back(entry.path().generic_string());
+		} else if(HasExtension(imageExtensions, extension)) {
+			images.push_back(entry.path().generic_string());
+		}
+	}
+	if(error) {
+		LOGGER::Formated("Loader benchmark: can't read {}, {}\n", mAssetPath, error.message());
+	}
+	std::sort(meshes.begin(), meshes.end());
+	std::sort(images.begin(), images.end());
+	for(int i = 0; i < meshes.size(); i++) {
+		mResults.push_back({meshes[i], true});
+	}
+	for(int i = 0; i < images.size(); i++) {
+		mResults.push_back({images[i], false});
+	}
+	LOGGER::Formated("Loader benchmark: {} meshes, {} images from {}{}\n", meshes.size(), images.size(), mAssetPath, mUseCache ? " (mesh cache on)" : "");
+
+	StartNext();
+}
+
+void StateLoaderBenchmark::ImGuiRender() {
+	if(ImGui::Begin("Loader Benchmark")) {
+		const int numAssets = mResults.size();
+		const int completed = std::min(mCurrent, numAssets);
+		char buf[32];
+		sprintf(buf, "%d/%d", completed, numAssets);
+		ImGui::ProgressBar(numAssets ? completed / (float)numAssets : 1.0f, ImVec2(-1.f, 0.f), buf);
+		if(mCurrent < numAssets) {
+			ImGui::Text("%s", mResults[mCurrent].mPath.c_str());
+		}
+	}
+	ImGui::End();
+}
+
+void StateLoaderBenchmark::Update() {
+	ZoneScoped;
+	if(mDone) {
+		return;
+	}
+	if(mCurrent >= mResults.size()) {
+		WriteResults();
+		mDone = true;
+		gEngine->GetWindow()->SetShouldClose();
+		return;
+	}
+
+	AssetResult& result = mResults[mCurrent];
+	result.mPeakResidentBytes = std::max(result.mPeakResidentBytes, GetResidentBytes());
+	const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mStartTime).count();
+	if(elapsed > cAssetTimeoutMs) {
+		LOGGER::Formated("Loader benchmark: {} timed out\n", result.mPath);
+		FinishCurrent(true);
+		return;
+	}
+
+	if(mMesh) {
+		if(!mMesh->HasLoadFinished()) {
+			return;
+		}
+		//a failed texture finishes without a view, it doesn't need to wait for the timeout
+		bool failed = mMesh->GetNumMesh() == 0;
+		for(uint32_t i = 0; i < mMesh->GetNumMaterial(); i++) {
+			const Mesh::MeshMaterialData& material = mMesh->GetMaterial(i);
+			const Image* images[] = {material.mImage, material.mNormal, material.mMetallicRoughnessTexture};
+			for(const Image* image: images) {
+				if(image == nullptr) {
+					continue;
+				}
+				if(!image->HasLoadFinished()) {
+					return;
+				}
+				failed |= !image->HasLoaded();
+			}
+		}
+		if(failed) {
+			LOGGER::Formated("Loader benchmark: {} failed to load\n", result.mPath);
+			FinishCurrent(true);
+			return;
+		}
+		if(mLoadedMs < 0.0) {
+			mLoadedMs = elapsed;
+		}
+		//the staged copies are recorded at the start of a frame, so this takes at least one more
+		for(int i = 0; i < mMesh->GetNumMesh(); i++) {
+			if(!mMesh->GetMesh(i).mGeometry.IsUploaded()) {
+				return;
+			}
+		}
+		result.mUploadMs = elapsed - mLoadedMs;
+		FinishCurrent(false);
+	} else if(mImage) {
+		if(!mImage->HasLoaded()) {
+			//finished without a view, the decode failed
+			if(mImage->HasLoadFinished()) {
+				LOGGER::Formated("Loader benchmark: {} failed to load\n", result.mPath);
+				FinishCurrent(true);
+			}
+			return;
+		}
+		FinishCurrent(false);
+	}
+}
+
+void StateLoaderBenchmark::Finish() {
+	if(mMesh) {
+		mMesh->Destroy();
+		delete mMesh;
+		mMesh = nullptr;
+	}
+	if(mImage) {
+		mImage->WaitForLoad();
+		mImage->Destroy();
+		delete mImage;
+		mImage = nullptr;
+	}
+	gMeshUseCache = mPreviousUseCache;
+}
+
+void StateLoaderBenchmark::StartNext() {
+	mCurrent++;
+	if(mCurrent >= mResults.size()) {
+		return;
+	}
+	AssetResult& result = mResults[mCurrent];
+	LOGGER::Formated("Loader benchmark: loading {}\n", result.mPath);
+	mLoadedMs = -1.0;
+	result.mPeakResidentBytes = GetResidentBytes();
+	mStartTime = std::chrono::high_resolution_clock::now();
+	if(result.mIsMesh) {
+		mMesh = new Mesh();
+		//textures are next to the model in every bundled asset
+		mMesh->LoadMesh(result.mPath, std::filesystem::path(result.mPath).parent_path().generic_string() + "/");
+	} else {
+		mImage = new Image();
+		mImage->LoadImage(result.mPath, VK_FORMAT_UNDEFINED);
+	}
+}
+
+void StateLoaderBenchmark::FinishCurrent(bool aFailed) {
+	AssetResult& result = mResults[mCurrent];
+	result.mFailed = aFailed;
+	result.mTotalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mStartTime).count();
+	result.mPeakResidentBytes = std::max(result.mPeakResidentBytes, GetResidentBytes());
+	//a timed out load is still running and a failed one has nothing to measure, only the time is kept
+	if(mMesh && !aFailed) {
+		const LoadTimings& timings = mMesh->GetLoadTimings();
+		result.mParseMs = timings.mParseMs;
+		result.mConvertMs = timings.mFinishMs;
+		const Mesh::MemoryStats memory = mMesh->GetMemoryStats();
+		result.mCPUBytes = memory.mCPUBytes;
+		result.mGPUBytes = memory.mGPUBytes;
+		for(int i = 0; i < mMesh->GetNumMesh(); i++) {
+			const Mesh::SubMesh& subMesh = mMesh->GetMesh(i);
+			if(!subMesh.mLODs.empty()) {
+				result.mTriangles += subMesh.mLODs[0].mIndexCount / 3;
+			}
+		}
+	}
+	if(mMesh) {
+		//waits for the load if it timed out
+		mMesh->Destroy();
+		delete mMesh;
+		mMesh = nullptr;
+	}
+	if(mImage) {
+		mImage->WaitForLoad();
+		const LoadTimings& timings = mImage->GetLoadTimings();
+		result.mParseMs = timings.mParseMs;
+		result.mConvertMs = timings.mFinishMs;
+		result.mGPUBytes = mImage->GetMemorySize();
+		mImage->Destroy();
+		delete mImage;
+		mImage = nullptr;
+	}
+	StartNext();
+}
+
+void StateLoaderBenchmark::WriteResults() const {
+	LOGGER::Formated("Loader benchmark results, peak resident {} MB\n", GetPeakResidentBytes() / (1024 * 1024));
+	LOGGER::Log("  parse ms | convert ms | upload ms |  total ms |  peak MB | asset\n");
+	double totalMs = 0.0;
+	for(int i = 0; i < mResults.size(); i++) {
+		const AssetResult& result = mResults[i];
+		char line[128];
+		snprintf(line,
+				 sizeof(line),
+				 "%10.2f | %10.2f | %9.2f | %9.2f | %8.1f | ",
+				 result.mParseMs,
+				 result.mConvertMs,
+				 result.mUploadMs,
+				 result.mTotalMs,
+				 result.mPeakResidentBytes / (1024.0 * 1024.0));
+		LOGGER::Formated("{}{}{}\n", line, result.mPath, result.mFailed ? " (failed)" : "");
+		totalMs += result.mTotalMs;
+	}
+	LOGGER::Formated("{} assets in {} ms\n", mResults.size(), totalMs);
+
+	if(mCsvPath.empty()) {
+		return;
+	}
+	std::ofstream csv(mCsvPath);
+	if(!csv) {
+		LOGGER::Formated("Loader benchmark: can't write {}\n", mCsvPath);
+		return;
+	}
+	csv << "asset,type,failed,parse_ms,convert_ms,upload_ms,total_ms,cpu_bytes,gpu_bytes,triangles,peak_resident_bytes\n";
+	for(int i = 0; i < mResults.size(); i++) {
+		const AssetResult& result = mResults[i];
+		csv << '"' << result.mPath << "\"," << (result.mIsMesh ? "mesh" : "image") << ',' << result.mFailed << ',' << result.mParseMs << ','
+			<< result.mConvertMs << ',' << result.mUploadMs << ',' << result.mTotalMs << ',' << result.mCPUBytes << ',' << result.mGPUBytes << ','
+			<< result.mTriangles << ',' << result.mPeakResidentBytes << '\n';
+	}
+	LOGGER::Formated("Loader benchmark: wrote {}\n", mCsvPath);
+}
+
+//static
+size_t StateLoaderBenchmark::GetResidentBytes() {
+#if PLATFORM_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	//second value is the resident pages
+	FILE* file = fopen("/proc/self/statm", "r");
+	if(file == nullptr) {
+		return 0;
+	}
+	long pages = 0;
+	long resident = 0;
+	const int read = fscanf(file, "%ld %ld", &pages, &resident);
+	fclose(file);
+	return read == 2 ? (size_t)resident * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+//static
+size_t StateLoaderBenchmark::GetPeakResidentBytes() {
+#if PLATFORM_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	//kilobytes on linux
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Engine/StateBase.h"
+
+class Mesh;
+class Image;
+
+//loads every mesh and image under an asset folder one at a time, then writes the timings to a csv and closes
+//meshes go through Mesh::LoadMesh (without the mesh cache unless asked) and images through Image::LoadImage
+//so this measures the same path the game uses, including the gpu uploads on whatever vulkan driver is active
+//GraphicsPlayground -benchmark-loaders [-assets folder] [-csv file] [-cache]
+
+class StateLoaderBenchmark : public StateBase {
+public:
+	StateLoaderBenchmark(const std::string& aAssetPath, const std::string& aCsvPath, bool aUseCache);
+
+	void StartUp() override;
+	void ImGuiRender() override;
+	void Update() override;
+	void Finish() override;
+
+private:
+	struct AssetResult {
+		std::string mPath;
+		bool mIsMesh;
+		bool mFailed = false;
+		//loading thread
+		double mParseMs = 0.0;
+		//finish, converting/optimizing meshes and creating images
+		double mConvertMs = 0.0;
+		//from the mesh finishing until its geometry is on the gpu
+		double mUploadMs = 0.0;
+		//from the load starting until everything is ready, including a mesh's textures
+		double mTotalMs = 0.0;
+		size_t mCPUBytes = 0;
+		size_t mGPUBytes = 0;
+		uint64_t mTriangles = 0;
+		//highest resident memory seen while it loaded, sampled once a frame
+		size_t mPeakResidentBytes = 0;
+	};
+
+	void StartNext();
+	void FinishCurrent(bool aFailed);
+	void WriteResults() const;
+
+	static size_t GetResidentBytes();
+	static size_t GetPeakResidentBytes();
+
+	const std::string mAssetPath;
+	const std::string mCsvPath;
+	const bool mUseCache;
+	bool mPreviousUseCache;
+
+	std::vector<AssetResult> mResults;
+	int mCurrent = -1;
+	Mesh* mMesh = nullptr;
+	Image* mImage = nullptr;
+	std::chrono::high_resolution_clock::time_point mStartTime;
+	//when mMesh reported it had loaded, the upload time is measured from here
+	double mLoadedMs = -1.0;
+	bool mDone = false;
+};
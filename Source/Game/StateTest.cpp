@@ -22,6 +22,7 @@
 #include "Graphics/Model.h"
 #include "Graphics/Pipeline.h"
 #include "Graphics/MaterialManager.h"
+#include "Graphics/StreamingManager.h"
 
 #include <glm/ext.hpp>
 
@@ -74,6 +75,8 @@ void StateTest::Initalize() {
 	mScreenspaceBlit = new Screenspace();
 
 	mSceneMesh = new Mesh();
+	//used for the scene collision
+	mSceneMesh->SetRetention(MeshRetention::POSITIONS);
 	mControllerMesh = new Mesh();
 	mWorldReferenceMesh = new Mesh();
 	mPhysicsObjectMesh = new Mesh();
@@ -194,11 +197,13 @@ void StateTest::StartUp() {
 	SetupSSImages();
 	gGraphics->mResizeMessage.AddCallback(SetupSSImages);
 
-	mControllerMesh->LoadMesh(std::string(WORK_DIR_REL) + "/Assets/handModel2.fbx");
+	//loaded once they're drawn, biggest on screen first
+	StreamingManager* streaming = gGraphics->GetStreamingManager();
+	streaming->Register(mControllerMesh, std::string(WORK_DIR_REL) + "/Assets/handModel2.fbx");
 
-	mWorldReferenceMesh->LoadMesh(std::string(WORK_DIR_REL) + "/Assets/5m reference.fbx");
+	streaming->Register(mWorldReferenceMesh, std::string(WORK_DIR_REL) + "/Assets/5m reference.fbx", "", 5.0f);
 
-	mPhysicsObjectMesh->LoadMesh(std::string(WORK_DIR_REL) + "/Assets/box.gltf");
+	streaming->Register(mPhysicsObjectMesh, std::string(WORK_DIR_REL) + "/Assets/box.gltf");
 
 	//inital load
 	ChangeMesh(mSceneSelectedMeshIndex);
@@ -209,22 +214,8 @@ void StateTest::StartUp() {
 	mSelectMeshPipeline->AddShader(std::string(WORK_DIR_REL) + "/Shaders/MeshTest.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	{
-		mMeshPipeline->vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		mMeshPipeline->vertexBinding.stride = sizeof(MeshVert);
-		mMeshPipeline->vertexAttribute = std::vector<VkVertexInputAttributeDescription>(4);
-		mMeshPipeline->vertexAttribute[0].location = 0;
-		mMeshPipeline->vertexAttribute[0].format = VK_FORMAT_R32G32B32_SFLOAT; //3
-		mMeshPipeline->vertexAttribute[0].offset = offsetof(MeshVert, mPos);
-		mMeshPipeline->vertexAttribute[1].location = 1;
-		mMeshPipeline->vertexAttribute[1].format = VK_FORMAT_R32G32B32_SFLOAT; //6
-		mMeshPipeline->vertexAttribute[1].offset = offsetof(MeshVert, mNorm);
-		mMeshPipeline->vertexAttribute[2].location = 2;
-		mMeshPipeline->vertexAttribute[2].format = VK_FORMAT_R32G32B32A32_SFLOAT; //10
-		mMeshPipeline->vertexAttribute[2].offset = offsetof(MeshVert, mColors[0]);
-		mMeshPipeline->vertexAttribute[3].location = 3;
-		mMeshPipeline->vertexAttribute[3].format = VK_FORMAT_R32G32_SFLOAT; //12
-		mMeshPipeline->vertexAttribute[3].offset = offsetof(MeshVert, mUVs[0]);
-		mSelectMeshPipeline->vertexBinding = mMeshPipeline->vertexBinding;
+		Mesh::GetVertexInput(mMeshPipeline->vertexBindings, mMeshPipeline->vertexAttribute);
+		mSelectMeshPipeline->vertexBindings = mMeshPipeline->vertexBindings;
 		mSelectMeshPipeline->vertexAttribute = mMeshPipeline->vertexAttribute;
 	}
 
@@ -275,6 +266,23 @@ void StateTest::StartUp() {
 	mChainModels[cNumChainObjects - 1]->mColorOverride = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
 	SetupPhysicsObjects();
 
+	mPhyBallPool = gPhysics->CreatePool(
+		PoolShape::BOX,
+		cMaxPhyBalls,
+		1.0f,
+		[this](PhysicsObject* aObject) {
+			Model* model = new Model();
+			model->SetMesh(mPhysicsObjectMesh);
+			model->mOverrideColor = true;
+			aObject->AttachOther(model);
+			return &model->mLocation;
+		},
+		[](PhysicsObject* aObject) {
+			Model* model = (Model*)aObject->GetOther();
+			model->Destroy();
+			delete model;
+		});
+
 	mSceneModel->SetMesh(mSceneMesh);
 
 	gEngine->SetMainCamera(&mFlyCamera);
@@ -368,6 +376,12 @@ void StateTest::ImGuiRender() {
 		bool loaded = mSceneMesh->HasLoaded();
 		ImGui::Checkbox("Has Loaded", &loaded);
 		ImGui::EndDisabled();
+		if(loaded) {
+			const Mesh::MemoryStats memory = mSceneMesh->GetMemoryStats();
+			ImGui::Text("Memory: cpu %.2f MB, gpu %.2f MB", memory.mCPUBytes / (1024.0f * 1024.0f), memory.mGPUBytes / (1024.0f * 1024.0f));
+		}
+		ImGui::DragFloat("LOD Pixel Error", &gModelLODPixelError, 0.1f, 0.0f, 64.0f);
+		ImGui::SliderInt("Scene LOD", &mSceneModel->mForceLOD, -1, Mesh::cMaxLODs - 1);
 		if(ImGui::Button("Reset Physics Objects")) {
 			SetupPhysicsObjects();
 		}
@@ -512,7 +526,13 @@ void StateTest::Update() {
 
 			//mSceneModel->SetMesh(mPhysicsObjectMesh);
 			//gPhysics->AddingObjectsTestMesh(&mScenePhysicsObject, mPhysicsObjectMesh);
-			gPhysics->AddingObjectsTestMesh(&mScenePhysicsObject, mSceneMesh);
+			//needs MeshRetention::POSITIONS or ALL
+			std::vector<PhysicsMeshPart> parts(mSceneMesh->GetNumMesh());
+			for(int i = 0; i < parts.size(); i++) {
+				const Mesh::SubMesh& mesh = mSceneMesh->GetMesh(i);
+				parts[i] = {mesh.GetPositions(), mesh.GetPositionStride(), mesh.GetNumPositions(), mesh.mIndices.data(), (uint32_t)mesh.mIndices.size(), mesh.mMatrix, mesh.mAABB};
+			}
+			gPhysics->AddingObjectsTestMesh(&mScenePhysicsObject, parts);
 		}
 	} else {
 		if(mScenePhysicsObject.GetRigidBody() != nullptr) {
@@ -522,26 +542,34 @@ void StateTest::Update() {
 	}
 
 	if(gInput->WasKeyPressed(GLFW_KEY_SPACE) || gInput->WasMouseButtonPressed(GLFW_MOUSE_BUTTON_1)) {
-		mPhyBalls.push_back(new PhyBall());
-		PhyBall& pyobj = *mPhyBalls.back();
-		pyobj.model = new Model();
-		pyobj.model->SetMesh(mPhysicsObjectMesh);
-		pyobj.model->mLocation.CopyTransform(mFlyCamera.mTransform, Transform::POSITION);
-		pyobj.model->mLocation.SetScale(0.2f);
-		pyobj.pyObj.AttachTransform(&pyobj.model->mLocation);
-		pyobj.pyObj.AttachOther(pyobj.model);
-		gPhysics->AddingObjectsTestBox(&pyobj.pyObj);
+		SimpleTransform spawn;
+		spawn.CopyTransform(mFlyCamera.mTransform, Transform::POSITION);
+		spawn.SetScale(0.2f);
+		PhysicsObject* ball = gPhysics->SpawnPooled(mPhyBallPool, spawn);
 		const float speed = 5.0f;
 		if(gInput->WasMouseButtonPressed(GLFW_MOUSE_BUTTON_1)) {
 			int width, height;
 			gEngine->GetWindow()->GetSize(&width, &height);
 			const glm::vec3 dir = mFlyCamera.GetWorldDirFromScreen(gInput->GetMousePos(), glm::vec2(width, height));
-			pyobj.pyObj.SetVelocity(dir * speed);
+			ball->SetVelocity(dir * speed);
 		} else {
-			pyobj.pyObj.SetVelocity(mFlyCamera.mTransform.GetForward() * -speed);
+			ball->SetVelocity(mFlyCamera.mTransform.GetForward() * -speed);
+		}
+		((Model*)ball->GetOther())->mColorOverride = glm::vec4(1.0f, 0, 0, 1);
+		ball->SetContactEvents(PhysicsObject::CONTACT_BEGIN);
+	}
+
+	//balls turn yellow once they hit something
+	for(const ContactEvent& event: gPhysics->GetContactEvents()) {
+		if(event.mType != ContactEventType::BEGIN) {
+			continue;
+		}
+		PhysicsObject* objects[2] = {event.mObjectA, event.mObjectB};
+		for(int i = 0; i < 2; i++) {
+			if(objects[i] && objects[i]->GetContactEvents() & PhysicsObject::CONTACT_BEGIN) {
+				((Model*)objects[i]->GetOther())->mColorOverride = glm::vec4(1.0f, 1.0f, 0, 1);
+			}
 		}
-		pyobj.model->mOverrideColor = true;
-		pyobj.model->mColorOverride = glm::vec4(1.0f, 0, 0, 1);
 	}
 
 	{
@@ -604,8 +632,8 @@ void StateTest::Render() {
 	for(int i = 0; i < cNumChainObjects; i++) {
 		mChainModels[i]->Render(buffer, mMeshPipeline->GetLayout());
 	}
-	for(int i = 0; i < mPhyBalls.size(); i++) {
-		mPhyBalls[i]->model->Render(buffer, mMeshPipeline->GetLayout());
+	for(PhysicsObject* ball: mPhyBallPool->GetActive()) {
+		((Model*)ball->GetOther())->Render(buffer, mMeshPipeline->GetLayout());
 	}
 	mSceneModel->Render(buffer, mMeshPipeline->GetLayout());
 	mMeshPipeline->End(buffer);
@@ -683,15 +711,17 @@ void StateTest::Finish() {
 		mChainModels[i]->Destroy();
 		delete mChainModels[i];
 	}
-	for(int i = 0; i < mPhyBalls.size(); i++) {
-		mPhyBalls[i]->model->Destroy();
-		mPhyBalls[i]->model = nullptr;
-	}
-	mPhyBalls.clear();
+	gPhysics->DestroyPool(mPhyBallPool);
+	mPhyBallPool = nullptr;
 
 	mMeshPipeline->Destroy();
 	delete mMeshPipeline;
 
+	StreamingManager* streaming = gGraphics->GetStreamingManager();
+	streaming->Unregister(mPhysicsObjectMesh);
+	streaming->Unregister(mWorldReferenceMesh);
+	streaming->Unregister(mControllerMesh);
+	streaming->Unregister(mSceneMesh);
 	mPhysicsObjectMesh->Destroy();
 	delete mPhysicsObjectMesh;
 	mWorldReferenceMesh->Destroy();
@@ -735,9 +765,16 @@ void StateTest::Finish() {
 
 void StateTest::ChangeMesh(int aIndex) {
 	mSceneSelectedMeshIndex = aIndex;
+	StreamingManager* streaming = gGraphics->GetStreamingManager();
+	streaming->Unregister(mSceneMesh);
 	mSceneMesh->Destroy();
-	mSceneMesh->LoadMesh(std::string(WORK_DIR_REL) + sceneMeshs[mSceneSelectedMeshIndex].mFilePath,
-						 std::string(WORK_DIR_REL) + sceneMeshs[mSceneSelectedMeshIndex].mTexturePath);
+	if(sceneMeshs[mSceneSelectedMeshIndex].mFilePath.empty()) {
+		return;
+	}
+	streaming->Register(mSceneMesh,
+						std::string(WORK_DIR_REL) + sceneMeshs[mSceneSelectedMeshIndex].mFilePath,
+						std::string(WORK_DIR_REL) + sceneMeshs[mSceneSelectedMeshIndex].mTexturePath,
+						50.0f);
 }
 
 void StateTest::SetupPhysicsObjects() {
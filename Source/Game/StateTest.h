@@ -18,6 +18,7 @@ class Pipeline;
 class Model;
 class PhysicsObject;
 class Screenspace;
+struct PhysicsPool;
 
 class StateTest : public StateBase {
 public:
@@ -79,11 +80,9 @@ private:
 
 	Transform mRootTransform;
 	FlyCamera mFlyCamera;
-	struct PhyBall {
-		PhysicsObject pyObj;
-		Model* model;
-	};
-	std::vector<PhyBall*> mPhyBalls;
+	//spawned with space/click, oldest is reused past cMaxPhyBalls
+	static const int cMaxPhyBalls = 256;
+	PhysicsPool* mPhyBallPool = nullptr;
 
 #if defined(ENABLE_XR)
 	Transform mVrCharacter;
@@ -1,8 +1,43 @@
 #include "Buffer.h"
 
+#include <mutex>
+#include <algorithm>
+
 #include "Graphics.h"
 #include "PlatformDebug.h"
 
+//staged uploads for device local buffers
+//data is copied into large persistently mapped staging buffers when UpdateData is called
+//then all the copies are recorded together at the start of the next frame
+namespace {
+	struct PendingUpload {
+		VkBuffer mDestination;
+		VkDeviceSize mDestinationOffset;
+		int mStaging;
+		VkDeviceSize mStagingOffset;
+		VkDeviceSize mSize;
+	};
+	struct StagingBuffer {
+		Buffer mBuffer;
+		char* mData = nullptr;
+		VkDeviceSize mSize = 0;
+		VkDeviceSize mUsed = 0;
+	};
+	const VkDeviceSize cStagingSize = 32 * 1024 * 1024;
+
+	std::mutex gUploadLock;
+	//staging buffers being filled for the next RecordUploads
+	std::vector<StagingBuffer*> gStaging;
+	//recorded in the last frame, the frame waits for the queue to idle so these are free by the next RecordUploads
+	std::vector<StagingBuffer*> gStagingInFlight;
+	//emptied standard size buffers ready for reuse
+	std::vector<StagingBuffer*> gStagingFree;
+	std::vector<PendingUpload> gPendingUploads;
+	uint64_t gNextUploadID = 1;
+	uint64_t gRecordedUploadID = 0;
+	Buffer::UploadStats gLastUploadStats;
+}
+
 VkBufferUsageFlags GetUsageFromType(const BufferType aType) {
 	switch(aType) {
 		case BufferType::IMAGE:
@@ -20,13 +55,28 @@ VkBufferUsageFlags GetUsageFromType(const BufferType aType) {
 		case BufferType::UNIFORM:
 			return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
 			break;
+		case BufferType::DYNAMIC_VERTEX:
+			return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+			break;
+		case BufferType::DYNAMIC_INDEX:
+			return VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+			break;
 		default:
 			ASSERT(false);
 	}
 	return 0;
 }
 
+//static
+bool Buffer::IsDeviceLocal(const BufferType aType) {
+	return aType == BufferType::VERTEX || aType == BufferType::INDEX;
+}
+
 void Buffer::Destroy() {
+	if(mBuffer && IsDeviceLocal(mType)) {
+		//drop anything that hasn't been copied yet
+		DropUploads(0, VK_WHOLE_SIZE);
+	}
 	if(mAllocation && mBuffer) {
 		vmaDestroyBuffer(gGraphics->GetAllocator(), mBuffer, mAllocation);
 		mAllocation = VK_NULL_HANDLE;
@@ -50,11 +100,16 @@ void Buffer::Create(const BufferType aType, const VkDeviceSize aSize, const char
 
 	VmaAllocationCreateInfo allocationInfo = {};
 
-	//customize...
-	//allocationInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-	allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	allocationInfo.flags		 = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT /*| VMA_ALLOCATION_CREATE_MAPPED_BIT*/;
-	allocationInfo.usage		 = VMA_MEMORY_USAGE_AUTO;
+	if(IsDeviceLocal(aType)) {
+		bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		allocationInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+	} else {
+		//customize...
+		//allocationInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+		allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		allocationInfo.flags		 = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT /*| VMA_ALLOCATION_CREATE_MAPPED_BIT*/;
+		allocationInfo.usage		 = VMA_MEMORY_USAGE_AUTO;
+	}
 
 	vmaCreateBuffer(gGraphics->GetAllocator(), &bufferInfo, &allocationInfo, &mBuffer, &mAllocation, &mAllocationInfo);
 
@@ -64,10 +119,16 @@ void Buffer::Create(const BufferType aType, const VkDeviceSize aSize, const char
 void Buffer::CreateFromData(const BufferType aType, const VkDeviceSize aSize, const void* aData, const char* aName /* = 0*/) {
 	Create(aType, aSize, aName);
 
+	if(IsDeviceLocal(aType)) {
+		UpdateData(0, aSize, aData);
+		return;
+	}
+
 	void* data = Map();
 
 	//comes premapped due to VMA_ALLOCATION_CREATE_MAPPED_BIT?
-	memcpy(data, aData, mAllocationInfo.size);
+	//allocation can be bigger than aData, only copy what was given
+	memcpy(data, aData, aSize);
 
 	UnMap();
 }
@@ -79,16 +140,67 @@ void Buffer::Resize(const VkDeviceSize aSize, const bool aKeepData, const char*
 	Create(mType, aSize, aName);
 }
 
-void Buffer::UpdateData(const VkDeviceSize aOffset, const VkDeviceSize aSize, const void* aData) {
+uint64_t Buffer::UpdateData(const VkDeviceSize aOffset, const VkDeviceSize aSize, const void* aData) {
+	const VkDeviceSize size = aSize == VK_WHOLE_SIZE ? mAllocationInfo.size : aSize;
+	if(IsDeviceLocal(mType)) {
+		if(size == 0) {
+			return 0;
+		}
+		ZoneScoped;
+		//the copy is done under the lock too, so RecordUploads never picks up a half written upload
+		std::unique_lock<std::mutex> lock(gUploadLock);
+		PendingUpload upload;
+		{
+			StagingBuffer* staging = gStaging.empty() ? nullptr : gStaging.back();
+			if(staging == nullptr || staging->mSize - staging->mUsed < size) {
+				if(size <= cStagingSize && !gStagingFree.empty()) {
+					staging = gStagingFree.back();
+					gStagingFree.pop_back();
+				} else {
+					staging = new StagingBuffer();
+					staging->mSize = std::max(size, cStagingSize);
+					staging->mBuffer.Create(BufferType::STAGING, staging->mSize, "Upload Staging Buffer");
+					staging->mData = (char*)staging->mBuffer.Map();
+				}
+				gStaging.push_back(staging);
+			}
+			upload.mDestination = mBuffer;
+			upload.mDestinationOffset = aOffset;
+			upload.mStaging = gStaging.size() - 1;
+			upload.mStagingOffset = staging->mUsed;
+			upload.mSize = size;
+			staging->mUsed = (staging->mUsed + size + 15) & ~15ull;
+			memcpy(staging->mData + upload.mStagingOffset, aData, size);
+			gPendingUploads.push_back(upload);
+		}
+		return gNextUploadID++;
+	}
+
 	char* data = (char*)Map() + aOffset;
 
 	//comes premapped due to VMA_ALLOCATION_CREATE_MAPPED_BIT?
-	memcpy(data, aData, aSize == VK_WHOLE_SIZE ? mAllocationInfo.size : aSize);
+	memcpy(data, aData, size);
 
 	UnMap();
+	return 0;
+}
+
+void Buffer::DropUploads(const VkDeviceSize aOffset, const VkDeviceSize aSize) {
+	ASSERT(IsDeviceLocal(mType));
+	const VkDeviceSize end = aSize == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : aOffset + aSize;
+	std::unique_lock<std::mutex> lock(gUploadLock);
+	gPendingUploads.erase(std::remove_if(gPendingUploads.begin(),
+										 gPendingUploads.end(),
+										 [this, aOffset, end](const PendingUpload& aUpload) {
+											 return aUpload.mDestination == mBuffer && aUpload.mDestinationOffset < end &&
+												 aUpload.mDestinationOffset + aUpload.mSize > aOffset;
+										 }),
+						  gPendingUploads.end());
 }
 
 void* Buffer::Map() {
+	//device local buffers go through UpdateData
+	ASSERT(!IsDeviceLocal(mType));
 	ASSERT(mMappedData == nullptr);
 	vmaMapMemory(gGraphics->GetAllocator(), mAllocation, &mMappedData);
 	return mMappedData;
@@ -102,7 +214,110 @@ void Buffer::Flush() {
 	vmaFlushAllocation(gGraphics->GetAllocator(), mAllocation, 0, VK_WHOLE_SIZE);
 }
 
+bool Buffer::IsHostCached() const {
+	VkMemoryPropertyFlags flags = 0;
+	vmaGetAllocationMemoryProperties(gGraphics->GetAllocator(), mAllocation, &flags);
+	return (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+}
+
 void Buffer::Flush(Buffer& aBuffers, uint8_t aCount) {
 	ASSERT(false);
 	vmaFlushAllocations(gGraphics->GetAllocator(), 0, 0, 0, 0);
-}
\ No newline at end of file
+}
+
+//static
+void Buffer::RecordUploads(VkCommandBuffer aBuffer) {
+	ZoneScoped;
+	std::unique_lock<std::mutex> lock(gUploadLock);
+
+	//the previous frame has finished with these
+	for(StagingBuffer* staging: gStagingInFlight) {
+		if(staging->mSize == cStagingSize) {
+			staging->mUsed = 0;
+			gStagingFree.push_back(staging);
+		} else {
+			staging->mBuffer.UnMap();
+			staging->mBuffer.Destroy();
+			delete staging;
+		}
+	}
+	gStagingInFlight.clear();
+
+	gLastUploadStats = UploadStats();
+	if(!gPendingUploads.empty()) {
+		//group the regions so each staging/destination pair is one copy
+		//stable so writes to the same range are still copied in the order they were made
+		std::stable_sort(gPendingUploads.begin(), gPendingUploads.end(), [](const PendingUpload& aLeft, const PendingUpload& aRight) {
+			if(aLeft.mStaging != aRight.mStaging) {
+				return aLeft.mStaging < aRight.mStaging;
+			}
+			return aLeft.mDestination < aRight.mDestination;
+		});
+		std::vector<VkBufferCopy> regions;
+		for(int i = 0; i < gPendingUploads.size(); i++) {
+			const PendingUpload& upload = gPendingUploads[i];
+			//regions in one copy can't overlap, a later write to the same range goes in the next copy
+			const auto Overlaps = [&upload](const VkBufferCopy& aRegion) {
+				return aRegion.dstOffset < upload.mDestinationOffset + upload.mSize && upload.mDestinationOffset < aRegion.dstOffset + aRegion.size;
+			};
+			if(std::any_of(regions.begin(), regions.end(), Overlaps)) {
+				vkCmdCopyBuffer(aBuffer, gStaging[upload.mStaging]->mBuffer.GetBuffer(), upload.mDestination, regions.size(), regions.data());
+				gLastUploadStats.mCopies++;
+				regions.clear();
+			}
+			VkBufferCopy region;
+			region.srcOffset = upload.mStagingOffset;
+			region.dstOffset = upload.mDestinationOffset;
+			region.size = upload.mSize;
+			regions.push_back(region);
+			gLastUploadStats.mBytes += upload.mSize;
+
+			const bool lastInGroup = i + 1 == gPendingUploads.size() || gPendingUploads[i + 1].mStaging != upload.mStaging ||
+				gPendingUploads[i + 1].mDestination != upload.mDestination;
+			if(lastInGroup) {
+				vkCmdCopyBuffer(aBuffer, gStaging[upload.mStaging]->mBuffer.GetBuffer(), upload.mDestination, regions.size(), regions.data());
+				gLastUploadStats.mCopies++;
+				regions.clear();
+			}
+		}
+		gLastUploadStats.mUploads = gPendingUploads.size();
+		gPendingUploads.clear();
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(aBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	//staging that was reserved but had its uploads dropped still gets recycled here
+	gStagingInFlight.swap(gStaging);
+	gRecordedUploadID = gNextUploadID - 1;
+
+	TracyPlot("Bytes Uploaded", (int64_t)gLastUploadStats.mBytes);
+}
+
+//static
+bool Buffer::HasUploaded(uint64_t aUploadID) {
+	std::unique_lock<std::mutex> lock(gUploadLock);
+	return aUploadID <= gRecordedUploadID;
+}
+
+//static
+void Buffer::DestroyStaging() {
+	std::unique_lock<std::mutex> lock(gUploadLock);
+	gPendingUploads.clear();
+	for(std::vector<StagingBuffer*>* list: {&gStaging, &gStagingInFlight, &gStagingFree}) {
+		for(StagingBuffer* staging: *list) {
+			staging->mBuffer.UnMap();
+			staging->mBuffer.Destroy();
+			delete staging;
+		}
+		list->clear();
+	}
+}
+
+//static
+Buffer::UploadStats Buffer::GetLastUploadStats() {
+	std::unique_lock<std::mutex> lock(gUploadLock);
+	return gLastUploadStats;
+}
@@ -7,9 +7,13 @@ enum class BufferType
 {
 	IMAGE,
 	STAGING,
+	//device local, filled with CreateFromData/UpdateData through a staged upload
 	VERTEX,
 	INDEX,
-	UNIFORM
+	UNIFORM,
+	//host visible, for data that is rewritten each frame with Map
+	DYNAMIC_VERTEX,
+	DYNAMIC_INDEX
 };
 
 class Buffer {
@@ -21,7 +25,12 @@ public:
 
 	void Resize(const VkDeviceSize aSize, const bool aKeepData, const char* aName = 0);
 
-	void UpdateData(const VkDeviceSize aOffset, const VkDeviceSize aSize, const void* aData);
+	//device local buffers copy aData into staging memory and return an id for HasUploaded, otherwise 0
+	//safe to call from multiple threads on device local buffers, as long as the ranges don't overlap
+	uint64_t UpdateData(const VkDeviceSize aOffset, const VkDeviceSize aSize, const void* aData);
+	//device local only, forgets the staged uploads into this range that haven't been recorded yet
+	//for ranges that are freed and may be handed out again before the next RecordUploads
+	void DropUploads(const VkDeviceSize aOffset, const VkDeviceSize aSize);
 
 	VkBuffer GetBuffer() const {
 		return mBuffer;
@@ -32,6 +41,7 @@ public:
 	const BufferType GetType() const {
 		return mType;
 	}
+	static bool IsDeviceLocal(const BufferType aType);
 
 	void* Map();
 	void UnMap();
@@ -39,6 +49,24 @@ public:
 	void Flush();
 	static void Flush(Buffer& aBuffers, uint8_t aCount);
 
+	//host visible memory that is also cached, reading back from it isn't slow like write combined memory
+	bool IsHostCached() const;
+
+	//records every staged upload since the last call into aBuffer, followed by a barrier for vertex/index reads
+	//called once per frame before anything is rendered
+	static void RecordUploads(VkCommandBuffer aBuffer);
+	//true once the upload has been recorded into a frame, anything drawn after that will see the data
+	static bool HasUploaded(uint64_t aUploadID);
+	static void DestroyStaging();
+
+	struct UploadStats {
+		uint64_t mBytes = 0;
+		uint32_t mUploads = 0;
+		uint32_t mCopies = 0;
+	};
+	//what the last RecordUploads copied
+	static UploadStats GetLastUploadStats();
+
 private:
 	VkBuffer mBuffer = VK_NULL_HANDLE;
 	BufferType mType;
@@ -0,0 +1,273 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+
+#include <imgui/imgui.h>
+
+#include "PlatformDebug.h"
+#include "Mesh.h"
+
+void GeometryArena::Initalize() {
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	Mesh::GetVertexInput(bindings, attributes);
+	mStreamStrides.resize(bindings.size());
+	for(int i = 0; i < bindings.size(); i++) {
+		mStreamStrides[bindings[i].binding] = bindings[i].stride;
+	}
+}
+
+void GeometryArena::Destroy() {
+	std::unique_lock<std::mutex> lock(mLock);
+	for(int i = 0; i < mBlocks.size(); i++) {
+		//meshes should have been destroyed before this
+		ASSERT(mBlocks[i]->mNumAllocations == 0);
+		DestroyBlock(*mBlocks[i]);
+		delete mBlocks[i];
+	}
+	mBlocks.clear();
+}
+
+void GeometryArena::ImGuiDraw() {
+	if(ImGui::Begin("Geometry Arena")) {
+		const Buffer::UploadStats uploadStats = Buffer::GetLastUploadStats();
+		ImGui::Text("Uploaded last frame: %.2f KB, %u uploads in %u copies", uploadStats.mBytes / 1024.0f, uploadStats.mUploads, uploadStats.mCopies);
+		std::unique_lock<std::mutex> lock(mLock);
+		for(int i = 0; i < mBlocks.size(); i++) {
+			const Block& block = *mBlocks[i];
+			if(block.mMaxVertices == 0) {
+				continue;
+			}
+			ImGui::Text("Block %i: %u allocations%s", i, block.mNumAllocations, block.mDedicated ? " (dedicated)" : "");
+			char buf[64];
+			sprintf(buf, "%u/%u vertices", block.mUsedVertices, block.mMaxVertices);
+			ImGui::ProgressBar(block.mUsedVertices / (float)block.mMaxVertices, ImVec2(-1.f, 0.f), buf);
+			const char* poolNames[2] = {"16 bit", "32 bit"};
+			for(int q = 0; q < 2; q++) {
+				const IndexPool& pool = block.mIndexPools[q];
+				if(pool.mMaxIndices == 0) {
+					continue;
+				}
+				sprintf(buf, "%u/%u %s indices", pool.mUsedIndices, pool.mMaxIndices, poolNames[q]);
+				ImGui::ProgressBar(pool.mUsedIndices / (float)pool.mMaxIndices, ImVec2(-1.f, 0.f), buf);
+			}
+		}
+	}
+	ImGui::End();
+}
+
+GeometryArena::Allocation GeometryArena::Allocate(uint32_t aNumVertices, uint32_t aNumIndices, VkIndexType aIndexType) {
+	ZoneScoped;
+	ASSERT(!mStreamStrides.empty());
+	ASSERT(aIndexType == VK_INDEX_TYPE_UINT16 || aIndexType == VK_INDEX_TYPE_UINT32);
+	Allocation allocation;
+	allocation.mNumVertices = aNumVertices;
+	allocation.mNumIndices = aNumIndices;
+	allocation.mIndexType = aIndexType;
+	const int poolIndex = GetPoolIndex(aIndexType);
+	const bool dedicated = aNumVertices > cBlockVertices || aNumIndices > cBlockIndices;
+
+	std::unique_lock<std::mutex> lock(mLock);
+	for(int i = 0; i < mBlocks.size() && !allocation.IsValid() && !dedicated; i++) {
+		Block& block = *mBlocks[i];
+		//released or someone else's
+		if(block.mMaxVertices == 0 || block.mDedicated) {
+			continue;
+		}
+		IndexPool& pool = block.mIndexPools[poolIndex];
+		if(block.mMaxVertices - block.mUsedVertices < aNumVertices) {
+			continue;
+		}
+		if(pool.mMaxIndices == 0) {
+			CreateIndexPool(pool, aIndexType, cBlockIndices);
+		}
+		if(pool.mMaxIndices - pool.mUsedIndices < aNumIndices) {
+			continue;
+		}
+		if(!AllocateRange(block.mFreeVertices, aNumVertices, allocation.mFirstVertex)) {
+			continue;
+		}
+		if(!AllocateRange(pool.mFreeIndices, aNumIndices, allocation.mFirstIndex)) {
+			FreeRange(block.mFreeVertices, allocation.mFirstVertex, aNumVertices);
+			continue;
+		}
+		allocation.mBlock = i;
+	}
+	if(!allocation.IsValid()) {
+		//reuse an empty slot if a block was released
+		int blockIndex = mBlocks.size();
+		for(int i = 0; i < mBlocks.size(); i++) {
+			if(mBlocks[i]->mMaxVertices == 0) {
+				blockIndex = i;
+				break;
+			}
+		}
+		if(blockIndex == mBlocks.size()) {
+			mBlocks.push_back(new Block());
+		}
+		Block& block = *mBlocks[blockIndex];
+		CreateBlock(block, std::max(aNumVertices, cBlockVertices));
+		block.mDedicated = dedicated;
+		IndexPool& pool = block.mIndexPools[poolIndex];
+		CreateIndexPool(pool, aIndexType, std::max(aNumIndices, cBlockIndices));
+		AllocateRange(block.mFreeVertices, aNumVertices, allocation.mFirstVertex);
+		AllocateRange(pool.mFreeIndices, aNumIndices, allocation.mFirstIndex);
+		allocation.mBlock = blockIndex;
+	}
+
+	Block& block = *mBlocks[allocation.mBlock];
+	block.mUsedVertices += aNumVertices;
+	block.mIndexPools[poolIndex].mUsedIndices += aNumIndices;
+	block.mNumAllocations++;
+	return allocation;
+}
+
+void GeometryArena::Free(Allocation& aAllocation) {
+	if(!aAllocation.IsValid()) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mLock);
+	Block& block = *mBlocks[aAllocation.mBlock];
+	IndexPool& pool = block.mIndexPools[GetPoolIndex(aAllocation.mIndexType)];
+	//unrecorded writes could otherwise land after the next allocation's writes to the same range
+	for(int i = 0; i < block.mVertexBuffers.size(); i++) {
+		const VkDeviceSize stride = mStreamStrides[i];
+		block.mVertexBuffers[i].DropUploads(aAllocation.mFirstVertex * stride, aAllocation.mNumVertices * stride);
+	}
+	const VkDeviceSize indexSize = GetIndexSize(aAllocation.mIndexType);
+	pool.mBuffer.DropUploads(indexSize * aAllocation.mFirstIndex, indexSize * aAllocation.mNumIndices);
+	FreeRange(block.mFreeVertices, aAllocation.mFirstVertex, aAllocation.mNumVertices);
+	FreeRange(pool.mFreeIndices, aAllocation.mFirstIndex, aAllocation.mNumIndices);
+	block.mUsedVertices -= aAllocation.mNumVertices;
+	pool.mUsedIndices -= aAllocation.mNumIndices;
+	block.mNumAllocations--;
+	//dedicated blocks for big meshes are released straight away, the normal sized ones are kept for the next mesh
+	if(block.mNumAllocations == 0 && block.mDedicated) {
+		DestroyBlock(block);
+	}
+	aAllocation = Allocation();
+}
+
+void GeometryArena::WriteVertices(Allocation& aAllocation, uint32_t aStream, const void* aData) {
+	ASSERT(aAllocation.IsValid() && aStream < mStreamStrides.size());
+	Block* block;
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		block = mBlocks[aAllocation.mBlock];
+	}
+	const VkDeviceSize stride = mStreamStrides[aStream];
+	const uint64_t uploadID = block->mVertexBuffers[aStream].UpdateData(aAllocation.mFirstVertex * stride, aAllocation.mNumVertices * stride, aData);
+	aAllocation.mUploadID = std::max(aAllocation.mUploadID, uploadID);
+}
+
+void GeometryArena::WriteIndices(Allocation& aAllocation, const void* aData) {
+	ASSERT(aAllocation.IsValid());
+	Block* block;
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		block = mBlocks[aAllocation.mBlock];
+	}
+	const VkDeviceSize indexSize = GetIndexSize(aAllocation.mIndexType);
+	Buffer& indexBuffer = block->mIndexPools[GetPoolIndex(aAllocation.mIndexType)].mBuffer;
+	const uint64_t uploadID = indexBuffer.UpdateData(indexSize * aAllocation.mFirstIndex, indexSize * aAllocation.mNumIndices, aData);
+	aAllocation.mUploadID = std::max(aAllocation.mUploadID, uploadID);
+}
+
+void GeometryArena::Bind(VkCommandBuffer aBuffer, const Allocation& aAllocation, BindState* aState) const {
+	BindState bound;
+	if(aState) {
+		bound = *aState;
+	}
+	if(bound.mBlock == aAllocation.mBlock && bound.mIndexType == aAllocation.mIndexType) {
+		return;
+	}
+	//loading threads can add blocks while rendering
+	std::unique_lock<std::mutex> lock(mLock);
+	const Block& block = *mBlocks[aAllocation.mBlock];
+	if(bound.mBlock != aAllocation.mBlock) {
+		VkBuffer buffers[4];
+		VkDeviceSize offsets[4] = {};
+		ASSERT(block.mVertexBuffers.size() <= 4);
+		for(int i = 0; i < block.mVertexBuffers.size(); i++) {
+			buffers[i] = block.mVertexBuffers[i].GetBuffer();
+		}
+		vkCmdBindVertexBuffers(aBuffer, 0, block.mVertexBuffers.size(), buffers, offsets);
+	}
+	const IndexPool& pool = block.mIndexPools[GetPoolIndex(aAllocation.mIndexType)];
+	vkCmdBindIndexBuffer(aBuffer, pool.mBuffer.GetBuffer(), 0, aAllocation.mIndexType);
+
+	if(aState) {
+		aState->mBlock = aAllocation.mBlock;
+		aState->mIndexType = aAllocation.mIndexType;
+	}
+}
+
+//static
+bool GeometryArena::AllocateRange(std::vector<Range>& aFreeRanges, uint32_t aSize, uint32_t& aOffset) {
+	if(aSize == 0) {
+		aOffset = 0;
+		return true;
+	}
+	for(int i = 0; i < aFreeRanges.size(); i++) {
+		Range& range = aFreeRanges[i];
+		if(range.mSize < aSize) {
+			continue;
+		}
+		aOffset = range.mOffset;
+		range.mOffset += aSize;
+		range.mSize -= aSize;
+		if(range.mSize == 0) {
+			aFreeRanges.erase(aFreeRanges.begin() + i);
+		}
+		return true;
+	}
+	return false;
+}
+
+//static
+void GeometryArena::FreeRange(std::vector<Range>& aFreeRanges, uint32_t aOffset, uint32_t aSize) {
+	if(aSize == 0) {
+		return;
+	}
+	int index = 0;
+	while(index < aFreeRanges.size() && aFreeRanges[index].mOffset < aOffset) {
+		index++;
+	}
+	aFreeRanges.insert(aFreeRanges.begin() + index, {aOffset, aSize});
+	//merge with the next range, then the previous
+	if(index + 1 < aFreeRanges.size() && aFreeRanges[index].mOffset + aFreeRanges[index].mSize == aFreeRanges[index + 1].mOffset) {
+		aFreeRanges[index].mSize += aFreeRanges[index + 1].mSize;
+		aFreeRanges.erase(aFreeRanges.begin() + index + 1);
+	}
+	if(index > 0 && aFreeRanges[index - 1].mOffset + aFreeRanges[index - 1].mSize == aFreeRanges[index].mOffset) {
+		aFreeRanges[index - 1].mSize += aFreeRanges[index].mSize;
+		aFreeRanges.erase(aFreeRanges.begin() + index);
+	}
+}
+
+void GeometryArena::CreateBlock(Block& aBlock, uint32_t aMaxVertices) {
+	ZoneScoped;
+	aBlock.mMaxVertices = aMaxVertices;
+	aBlock.mVertexBuffers.resize(mStreamStrides.size());
+	for(int i = 0; i < mStreamStrides.size(); i++) {
+		aBlock.mVertexBuffers[i].Create(BufferType::VERTEX, (VkDeviceSize)mStreamStrides[i] * aMaxVertices, "Geometry Arena Vertex Data");
+	}
+	aBlock.mFreeVertices = {{0, aMaxVertices}};
+}
+
+void GeometryArena::CreateIndexPool(IndexPool& aPool, VkIndexType aIndexType, uint32_t aMaxIndices) {
+	ZoneScoped;
+	aPool.mMaxIndices = aMaxIndices;
+	aPool.mBuffer.Create(BufferType::INDEX, GetIndexSize(aIndexType) * (VkDeviceSize)aMaxIndices, "Geometry Arena Index Data");
+	aPool.mFreeIndices = {{0, aMaxIndices}};
+}
+
+void GeometryArena::DestroyBlock(Block& aBlock) {
+	for(int i = 0; i < aBlock.mVertexBuffers.size(); i++) {
+		aBlock.mVertexBuffers[i].Destroy();
+	}
+	for(int i = 0; i < 2; i++) {
+		aBlock.mIndexPools[i].mBuffer.Destroy();
+	}
+	aBlock = Block();
+}
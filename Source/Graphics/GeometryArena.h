@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+#include "Buffer.h"
+
+//shared vertex/index storage for every Mesh
+//submeshes get a range of vertices and indices out of a large block instead of their own buffers
+//so consecutive draws from the same block only bind once, and draw with a base vertex/first index
+//blocks are device local and written through Buffer's staged uploads, allocating is locked but writing into an allocation is not
+
+class GeometryArena {
+public:
+	struct Allocation {
+		int mBlock = -1;
+		uint32_t mFirstVertex = 0;
+		uint32_t mNumVertices = 0;
+		uint32_t mFirstIndex = 0;
+		uint32_t mNumIndices = 0;
+		//VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32, each has its own index buffer in the block
+		VkIndexType mIndexType = VK_INDEX_TYPE_UINT32;
+		//latest write, see Buffer::HasUploaded
+		uint64_t mUploadID = 0;
+
+		bool IsValid() const {
+			return mBlock != -1;
+		}
+		bool IsUploaded() const {
+			return Buffer::HasUploaded(mUploadID);
+		}
+	};
+
+	//takes the vertex streams from Mesh::GetVertexInput, so gMeshVertexStreams needs to be set before this
+	void Initalize();
+	void Destroy();
+
+	void ImGuiDraw();
+
+	//what was last bound in a command buffer, to skip rebinding between draws
+	struct BindState {
+		int mBlock = -1;
+		VkIndexType mIndexType = VK_INDEX_TYPE_MAX_ENUM;
+	};
+
+	//thread safe
+	Allocation Allocate(uint32_t aNumVertices, uint32_t aNumIndices, VkIndexType aIndexType);
+	void Free(Allocation& aAllocation);
+
+	//copies aAllocation.mNumVertices elements of the stream's stride
+	void WriteVertices(Allocation& aAllocation, uint32_t aStream, const void* aData);
+	//aData is uint16_t or uint32_t depending on the allocation's mIndexType
+	void WriteIndices(Allocation& aAllocation, const void* aData);
+
+	//binds the vertex streams and index buffer aAllocation uses, anything already bound in aState is skipped
+	void Bind(VkCommandBuffer aBuffer, const Allocation& aAllocation, BindState* aState = nullptr) const;
+
+	static uint32_t GetIndexSize(VkIndexType aIndexType) {
+		return aIndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+private:
+	struct Range {
+		uint32_t mOffset;
+		uint32_t mSize;
+	};
+	//first fit, ranges are kept sorted by offset
+	static bool AllocateRange(std::vector<Range>& aFreeRanges, uint32_t aSize, uint32_t& aOffset);
+	static void FreeRange(std::vector<Range>& aFreeRanges, uint32_t aOffset, uint32_t aSize);
+
+	struct IndexPool {
+		Buffer mBuffer;
+		uint32_t mMaxIndices = 0;
+		uint32_t mUsedIndices = 0;
+		std::vector<Range> mFreeIndices;
+	};
+	//IndexPool for each index type
+	static int GetPoolIndex(VkIndexType aIndexType) {
+		return aIndexType == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+	}
+	struct Block {
+		std::vector<Buffer> mVertexBuffers;
+		//uint16 then uint32, made when first needed
+		IndexPool mIndexPools[2];
+
+		uint32_t mMaxVertices = 0;
+		uint32_t mUsedVertices = 0;
+		uint32_t mNumAllocations = 0;
+		std::vector<Range> mFreeVertices;
+		//sized for one big submesh, released once it's freed
+		bool mDedicated = false;
+	};
+	void CreateBlock(Block& aBlock, uint32_t aMaxVertices);
+	void CreateIndexPool(IndexPool& aPool, VkIndexType aIndexType, uint32_t aMaxIndices);
+	void DestroyBlock(Block& aBlock);
+
+	//block size, bigger submeshes get a block to themselves
+	static const uint32_t cBlockVertices = 1 << 20;
+	static const uint32_t cBlockIndices = 1 << 22;
+
+	std::vector<uint32_t> mStreamStrides;
+	//pointers so writes can use a block without holding the lock while others are added
+	std::vector<Block*> mBlocks;
+	mutable std::mutex mLock;
+};
@@ -14,6 +14,8 @@
 #include "Engine/Window.h"
 #include "Image.h"
 #include "MaterialManager.h"
+#include "GeometryArena.h"
+#include "StreamingManager.h"
 
 #if defined(ENABLE_IMGUI)
 #	include "ImGuiGraphics.h"
@@ -269,6 +271,14 @@ bool VulkanGraphics::Initalize() {
 	mMaterialManager = new MaterialManager();
 	mMaterialManager->Initalize();
 
+	ASSERT(!mGeometryArena);
+	mGeometryArena = new GeometryArena();
+	mGeometryArena->Initalize();
+
+	ASSERT(!mStreamingManager);
+	mStreamingManager = new StreamingManager();
+	mStreamingManager->Initalize();
+
 	{
 		VkSamplerCreateInfo samplerInfo = {};
 		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -286,7 +296,8 @@ bool VulkanGraphics::Initalize() {
 		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerInfo.mipLodBias = 0.0f;
 		samplerInfo.minLod = 0.0f;
-		samplerInfo.maxLod = 0.0f;
+		//every mip the image has
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 		vkCreateSampler(GetVkDevice(), &samplerInfo, GetAllocationCallback(), &mSampler);
 		SetVkName(VK_OBJECT_TYPE_SAMPLER, mSampler, "Default Repeat Sampler");
 	}
@@ -335,11 +346,21 @@ bool VulkanGraphics::Destroy() {
 	}
 
 	vkDestroySampler(GetVkDevice(), mSampler, GetAllocationCallback());
+	if(mStreamingManager) {
+		mStreamingManager->Destroy();
+		delete mStreamingManager;
+		mStreamingManager = nullptr;
+	}
 	if(mMaterialManager) {
 		mMaterialManager->Destroy();
 		delete mMaterialManager;
 		mMaterialManager = nullptr;
 	}
+	if(mGeometryArena) {
+		mGeometryArena->Destroy();
+		delete mGeometryArena;
+		mGeometryArena = nullptr;
+	}
 	// vkFreeDescriptorSets(GetVkDevice(), gDescriptorPool, 1, &gImGuiFontSet);
 	vkDestroyDescriptorPool(GetVkDevice(), mDescriptorPool, GetAllocationCallback());
 	mSampler = VK_NULL_HANDLE;
@@ -378,6 +399,7 @@ bool VulkanGraphics::Destroy() {
 		CONSTANTS::IMAGE::gChecker = nullptr;
 	}
 
+	Buffer::DestroyStaging();
 	vmaDestroyAllocator(mAllocator);
 	mAllocator = VK_NULL_HANDLE;
 
@@ -422,10 +444,15 @@ void VulkanGraphics::StartNewFrame() {
 
 	mFrameCounter++;
 
+	//uses what was drawn last frame
+	mStreamingManager->Update();
+
 #if defined(ENABLE_IMGUI)
 	gImGuiGraphics->StartNewFrame();
 
 	mMaterialManager->ImGuiDraw();
+	mGeometryArena->ImGuiDraw();
+	mStreamingManager->ImGuiDraw();
 #endif
 }
 AQUIRES_LOCK(mCommandPoolMutex) void VulkanGraphics::StartGraphicsFrame() {
@@ -441,6 +468,9 @@ AQUIRES_LOCK(mCommandPoolMutex) void VulkanGraphics::StartGraphicsFrame() {
 	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	vkBeginCommandBuffer(graphics, &info);
 
+	//geometry uploaded since the last frame
+	Buffer::RecordUploads(graphics);
+
 	if(mMaterialManager) {
 		mMaterialManager->NewFrame();
 	}
@@ -26,6 +26,8 @@ class Devices;
 class Swapchain;
 
 class MaterialManager;
+class GeometryArena;
+class StreamingManager;
 class VRGraphics;
 
 #pragma region Vulkan Helpers
@@ -154,6 +156,12 @@ public:
 	MaterialManager* GetMaterialManager() const {
 		return mMaterialManager;
 	}
+	GeometryArena* GetGeometryArena() const {
+		return mGeometryArena;
+	}
+	StreamingManager* GetStreamingManager() const {
+		return mStreamingManager;
+	}
 
 	Callback<void()> mResizeMessage;
 
@@ -186,6 +194,8 @@ private:
 	VkSampler mSampler = VK_NULL_HANDLE;
 
 	MaterialManager* mMaterialManager = nullptr;
+	GeometryArena* mGeometryArena = nullptr;
+	StreamingManager* mStreamingManager = nullptr;
 
 	uint32_t mFrameCounter = 0;
 
@@ -83,8 +83,9 @@ void ImGuiGraphics::Create(GLFWwindow* aWindow, const RenderPass& aRenderPass) {
 
 	//temp
 	{
-		gImGuiPipeline.vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		gImGuiPipeline.vertexBinding.stride = sizeof(ImDrawVert);
+		gImGuiPipeline.vertexBindings = std::vector<VkVertexInputBindingDescription>(1);
+		gImGuiPipeline.vertexBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		gImGuiPipeline.vertexBindings[0].stride = sizeof(ImDrawVert);
 
 		gImGuiPipeline.vertexAttribute = std::vector<VkVertexInputAttributeDescription>(3);
 		gImGuiPipeline.vertexAttribute[0].format = VK_FORMAT_R32G32_SFLOAT;
@@ -99,8 +100,8 @@ void ImGuiGraphics::Create(GLFWwindow* aWindow, const RenderPass& aRenderPass) {
 
 	gImGuiPipeline.Create(aRenderPass.GetRenderPass(), "ImGui Pipeline");
 
-	gImGuiVertBuffer.Create(BufferType::VERTEX, 0, "ImGui Vertex Buffer");
-	gImGuiIndexBuffer.Create(BufferType::INDEX, 0, "ImGui Index Buffer");
+	gImGuiVertBuffer.Create(BufferType::DYNAMIC_VERTEX, 0, "ImGui Vertex Buffer");
+	gImGuiIndexBuffer.Create(BufferType::DYNAMIC_INDEX, 0, "ImGui Index Buffer");
 
 	{
 		gImGuiFontMaterial.Create(&gImGuiFontMaterialBase, "ImGui Font Material");
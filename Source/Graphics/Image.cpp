@@ -1,5 +1,7 @@
 #include "Image.h"
 
+#include <vector>
+
 #include "PlatformDebug.h"
 #include "Graphics.h"
 #include "Buffer.h"
@@ -7,6 +9,8 @@
 
 #include "Loaders/StbImageLoader.h"
 #include "Loaders/DDSLoader.h"
+#include "Loaders/KTX2Loader.h"
+#include "TextureCompress.h"
 
 namespace CONSTANTS {
 	namespace IMAGE {
@@ -16,18 +20,113 @@ namespace CONSTANTS {
 	}; // namespace IMAGE
 }; // namespace CONSTANTS
 
+bool gImageUseCompressedCache = true;
+
+//texel block size of every core color format, in ranges of formats that share it
+//depth/stencil formats are left out, they can't be uploaded through the color aspect
 //https://www.khronos.org/registry/vulkan/specs/1.3-extensions/html/vkspec.html#formats-compatibility-classes
-uint32_t ConvertImageSizeToByteSize(ImageSize aSize, VkFormat aFormat) {
-	switch(aFormat) {
-		case VK_FORMAT_BC7_UNORM_BLOCK:
-		case VK_FORMAT_BC5_UNORM_BLOCK:
-			return ((aSize.mWidth / 4) * (aSize.mHeight / 4)) * 16;
-		case VK_FORMAT_R8G8B8A8_SRGB:
-			return aSize.mWidth * aSize.mHeight * sizeof(char) * 4;
-		default:
-			ASSERT(false);
-			return 0;
+struct FormatBlockRange {
+	VkFormat mFirst;
+	VkFormat mLast;
+	uint32_t mBytes;
+	uint32_t mBlockWidth;
+	uint32_t mBlockHeight;
+};
+static const FormatBlockRange cFormatBlockRanges[] = {
+	{VK_FORMAT_R4G4_UNORM_PACK8, VK_FORMAT_R4G4_UNORM_PACK8, 1, 1, 1},
+	{VK_FORMAT_R4G4B4A4_UNORM_PACK16, VK_FORMAT_A1R5G5B5_UNORM_PACK16, 2, 1, 1},
+	{VK_FORMAT_R8_UNORM, VK_FORMAT_R8_SRGB, 1, 1, 1},
+	{VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_SRGB, 2, 1, 1},
+	{VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_B8G8R8_SRGB, 3, 1, 1},
+	{VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_A2B10G10R10_SINT_PACK32, 4, 1, 1},
+	{VK_FORMAT_R16_UNORM, VK_FORMAT_R16_SFLOAT, 2, 1, 1},
+	{VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16_SFLOAT, 4, 1, 1},
+	{VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16_SFLOAT, 6, 1, 1},
+	{VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT, 8, 1, 1},
+	{VK_FORMAT_R32_UINT, VK_FORMAT_R32_SFLOAT, 4, 1, 1},
+	{VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_SFLOAT, 8, 1, 1},
+	{VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_SFLOAT, 12, 1, 1},
+	{VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_SFLOAT, 16, 1, 1},
+	{VK_FORMAT_R64_UINT, VK_FORMAT_R64_SFLOAT, 8, 1, 1},
+	{VK_FORMAT_R64G64_UINT, VK_FORMAT_R64G64_SFLOAT, 16, 1, 1},
+	{VK_FORMAT_R64G64B64_UINT, VK_FORMAT_R64G64B64_SFLOAT, 24, 1, 1},
+	{VK_FORMAT_R64G64B64A64_UINT, VK_FORMAT_R64G64B64A64_SFLOAT, 32, 1, 1},
+	{VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, 4, 1, 1},
+	//bc1 and bc4 are 8 bytes a block, the rest 16
+	{VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 8, 4, 4},
+	{VK_FORMAT_BC2_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK, 16, 4, 4},
+	{VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_SNORM_BLOCK, 8, 4, 4},
+	{VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, 16, 4, 4},
+	{VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK, 8, 4, 4},
+	{VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, 16, 4, 4},
+	{VK_FORMAT_EAC_R11_UNORM_BLOCK, VK_FORMAT_EAC_R11_SNORM_BLOCK, 8, 4, 4},
+	{VK_FORMAT_EAC_R11G11_UNORM_BLOCK, VK_FORMAT_EAC_R11G11_SNORM_BLOCK, 16, 4, 4},
+	//astc is always 16 bytes, only the footprint changes
+	{VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 16, 4, 4},
+	{VK_FORMAT_ASTC_5x4_UNORM_BLOCK, VK_FORMAT_ASTC_5x4_SRGB_BLOCK, 16, 5, 4},
+	{VK_FORMAT_ASTC_5x5_UNORM_BLOCK, VK_FORMAT_ASTC_5x5_SRGB_BLOCK, 16, 5, 5},
+	{VK_FORMAT_ASTC_6x5_UNORM_BLOCK, VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 16, 6, 5},
+	{VK_FORMAT_ASTC_6x6_UNORM_BLOCK, VK_FORMAT_ASTC_6x6_SRGB_BLOCK, 16, 6, 6},
+	{VK_FORMAT_ASTC_8x5_UNORM_BLOCK, VK_FORMAT_ASTC_8x5_SRGB_BLOCK, 16, 8, 5},
+	{VK_FORMAT_ASTC_8x6_UNORM_BLOCK, VK_FORMAT_ASTC_8x6_SRGB_BLOCK, 16, 8, 6},
+	{VK_FORMAT_ASTC_8x8_UNORM_BLOCK, VK_FORMAT_ASTC_8x8_SRGB_BLOCK, 16, 8, 8},
+	{VK_FORMAT_ASTC_10x5_UNORM_BLOCK, VK_FORMAT_ASTC_10x5_SRGB_BLOCK, 16, 10, 5},
+	{VK_FORMAT_ASTC_10x6_UNORM_BLOCK, VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 16, 10, 6},
+	{VK_FORMAT_ASTC_10x8_UNORM_BLOCK, VK_FORMAT_ASTC_10x8_SRGB_BLOCK, 16, 10, 8},
+	{VK_FORMAT_ASTC_10x10_UNORM_BLOCK, VK_FORMAT_ASTC_10x10_SRGB_BLOCK, 16, 10, 10},
+	{VK_FORMAT_ASTC_12x10_UNORM_BLOCK, VK_FORMAT_ASTC_12x10_SRGB_BLOCK, 16, 12, 10},
+	{VK_FORMAT_ASTC_12x12_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 16, 12, 12},
+};
+
+static const FormatBlockRange* FindFormatBlock(VkFormat aFormat) {
+	for(const FormatBlockRange& range: cFormatBlockRanges) {
+		if(aFormat >= range.mFirst && aFormat <= range.mLast) {
+			return &range;
+		}
+	}
+	return nullptr;
+}
+
+//one level of one layer, partial blocks at the edges of small mips still take a whole block
+VkDeviceSize ConvertImageSizeToByteSize(ImageSize aSize, VkFormat aFormat) {
+	const FormatBlockRange* block = FindFormatBlock(aFormat);
+	if(block == nullptr) {
+		ASSERT(false);
+		return 0;
+	}
+	const VkDeviceSize blocksWide = (aSize.mWidth + block->mBlockWidth - 1) / block->mBlockWidth;
+	const VkDeviceSize blocksHigh = (aSize.mHeight + block->mBlockHeight - 1) / block->mBlockHeight;
+	return blocksWide * blocksHigh * block->mBytes;
+}
+
+//static
+bool Image::IsUploadableFormat(const VkFormat aFormat) {
+	return FindFormatBlock(aFormat) != nullptr;
+}
+
+//static
+ImageSize Image::GetMipSize(const ImageSize aSize, const uint8_t aMip) {
+	return ImageSize(std::max(aSize.mWidth >> aMip, 1u), std::max(aSize.mHeight >> aMip, 1u));
+}
+
+//static
+uint8_t Image::GetFullMipLevels(const ImageSize aSize) {
+	uint8_t levels = 1;
+	uint32_t largest = std::max(aSize.mWidth, aSize.mHeight);
+	while(largest > 1) {
+		largest >>= 1;
+		levels++;
 	}
+	return levels;
+}
+
+//static
+VkDeviceSize Image::GetByteSize(const ImageSize aSize, const VkFormat aFormat, const uint8_t aMipLevels /*= 1*/, const uint8_t aArrayLayers /*= 1*/) {
+	VkDeviceSize size = 0;
+	for(uint8_t i = 0; i < aMipLevels; i++) {
+		size += ConvertImageSizeToByteSize(GetMipSize(aSize, i), aFormat);
+	}
+	return size * aArrayLayers;
 }
 
 void Image::CreateVkImage(const VkFormat aFormat, const ImageSize aSize, const bool aAttachment, const char* aName /* = 0*/) {
@@ -43,7 +142,7 @@ void Image::CreateVkImage(const VkFormat aFormat, const ImageSize aSize, const b
 	createInfo.format = format;
 	createInfo.extent = aSize;
 	createInfo.arrayLayers = mArrayLayers;
-	createInfo.mipLevels = 1;
+	createInfo.mipLevels = mMipLevels;
 	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	createInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -51,6 +150,11 @@ void Image::CreateVkImage(const VkFormat aFormat, const ImageSize aSize, const b
 	createInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
+	if(mMipLevels > 1) {
+		//levels can be blitted from the one above
+		createInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
 	if(aAttachment) {
 		if(Graphics::IsFormatDepth(format)) {
 			createInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
@@ -81,29 +185,96 @@ void Image::CreateVkImage(const VkFormat aFormat, const ImageSize aSize, const b
 	SetVkName(VK_OBJECT_TYPE_IMAGE, mImage, aName ? aName : "Unnamed Image");
 }
 
-void Image::CreateFromBuffer(Buffer& aBuffer, const bool aDestroyBuffer, const VkFormat aFormat, const ImageSize aSize, const char* aName /* = 0*/) {
+void Image::CreateFromBuffer(Buffer& aBuffer, const bool aDestroyBuffer, const VkFormat aFormat, const ImageSize aSize, const char* aName /* = 0*/, const bool aGenerateMips /* = false*/) {
 	ZoneScoped;
 	ASSERT(aBuffer.GetType() == BufferType::STAGING)
+	if(aGenerateMips && mMipLevels > 1) {
+		const VkFormat format = aFormat == VK_FORMAT_UNDEFINED ? Graphics::GetDeafultColorFormat() : aFormat;
+		VkFormatProperties props = {};
+		vkGetPhysicalDeviceFormatProperties(gGraphics->GetVkPhysicalDevice(), format, &props);
+		const VkFormatFeatureFlags blitFeatures =
+			VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		if((props.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+			LOGGER::Formated("Can't blit mips for {}, format {}\n", aName ? aName : "Unnamed Image", (int)format);
+			mMipLevels = 1;
+		}
+	}
 	CreateVkImage(aFormat, aSize, false, aName);
 
+	//layer by layer, each with its levels largest first
+	const uint8_t uploadedLevels = aGenerateMips ? 1 : mMipLevels;
+	std::vector<VkBufferImageCopy> imageCopies;
+	VkDeviceSize offset = 0;
+	for(uint8_t layer = 0; layer < mArrayLayers; layer++) {
+		for(uint8_t level = 0; level < uploadedLevels; level++) {
+			const ImageSize mipSize = GetMipSize(mSize, level);
+			VkBufferImageCopy imageCopy = {};
+			imageCopy.bufferOffset = offset;
+			imageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			imageCopy.imageSubresource.mipLevel = level;
+			imageCopy.imageSubresource.baseArrayLayer = layer;
+			imageCopy.imageSubresource.layerCount = 1;
+			imageCopy.imageExtent = mipSize;
+			imageCopies.push_back(imageCopy);
+			offset += ConvertImageSizeToByteSize(mipSize, mFormat);
+		}
+	}
+
 	OneTimeCommandBuffer cmBuffer = gGraphics->AllocateGraphicsCommandBuffer();
 	{
 		ZoneScopedN("Has Lock");
 		SetImageLayout(
 			cmBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-		VkBufferImageCopy imageCopy = {};
-		imageCopy.imageSubresource.layerCount = mArrayLayers;
-		imageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		imageCopy.imageExtent = mSize;
-
-		vkCmdCopyBufferToImage(cmBuffer, aBuffer.GetBuffer(), mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
-
-		SetImageLayout(cmBuffer,
-					   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-					   VK_PIPELINE_STAGE_TRANSFER_BIT,
-					   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		vkCmdCopyBufferToImage(cmBuffer, aBuffer.GetBuffer(), mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageCopies.size(), imageCopies.data());
+
+		if(uploadedLevels < mMipLevels) {
+			//each level is filtered down from the one above, which is then done with
+			for(uint8_t level = 1; level < mMipLevels; level++) {
+				SetImageLayout(cmBuffer,
+							   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+							   VK_PIPELINE_STAGE_TRANSFER_BIT,
+							   VK_PIPELINE_STAGE_TRANSFER_BIT,
+							   level - 1,
+							   1);
+
+				const ImageSize srcSize = GetMipSize(mSize, level - 1);
+				const ImageSize dstSize = GetMipSize(mSize, level);
+				VkImageBlit blit = {};
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = level - 1;
+				blit.srcSubresource.layerCount = mArrayLayers;
+				blit.srcOffsets[1] = {(int32_t)srcSize.mWidth, (int32_t)srcSize.mHeight, 1};
+				blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.dstSubresource.mipLevel = level;
+				blit.dstSubresource.layerCount = mArrayLayers;
+				blit.dstOffsets[1] = {(int32_t)dstSize.mWidth, (int32_t)dstSize.mHeight, 1};
+				vkCmdBlitImage(
+					cmBuffer, mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+				SetImageLayout(cmBuffer,
+							   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+							   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+							   VK_PIPELINE_STAGE_TRANSFER_BIT,
+							   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+							   level - 1,
+							   1);
+			}
+			SetImageLayout(cmBuffer,
+						   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						   VK_PIPELINE_STAGE_TRANSFER_BIT,
+						   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+						   mMipLevels - 1,
+						   1);
+		} else {
+			SetImageLayout(cmBuffer,
+						   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						   VK_PIPELINE_STAGE_TRANSFER_BIT,
+						   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		}
 
 		if(aDestroyBuffer) {
 			cmBuffer.mDataBuffer = aBuffer;
@@ -131,7 +302,7 @@ void Image::CreateFromVkImage(const VkImage aImage, const VkFormat aFormat, cons
 void Image::CreateFromData(const void* aData, const VkFormat aFormat, const ImageSize aSize, const char* aName /* = 0*/) {
 	ZoneScoped;
 	Buffer dataBuffer;
-	dataBuffer.CreateFromData(BufferType::STAGING, ConvertImageSizeToByteSize(aSize, aFormat), aData, aName);
+	dataBuffer.CreateFromData(BufferType::STAGING, GetByteSize(aSize, aFormat, mMipLevels, mArrayLayers), aData, aName);
 
 	CreateFromBuffer(dataBuffer, true, aFormat, aSize, aName);
 
@@ -146,6 +317,19 @@ void Image::LoadImage(const FileIO::Path aFilePath, const VkFormat aFormat) {
 	Job::Work work = GetLoadImageWork(aFilePath, aFormat);
 	mLoadedHandle = Job::QueueWorkHandle(work);
 }
+void Image::LoadImage(const FileIO::Path aName, std::vector<uint8_t> aEncoded, const VkFormat aFormat) {
+	//there's no file to have a compressed copy of, always decoded
+	StbImageLoader* loader = new StbImageLoader();
+	loader->SetEncodedData(std::move(aEncoded));
+	mLoadingBase = loader;
+	mLoadingBase->SetUp(this);
+	mFormat = aFormat;
+	mFilePath = aName.String();
+	mFromMemory = true;
+	Job::Work work = mLoadingBase->GetWork(aName);
+	LoaderBase::AddTimings(work, &mLoadTimings);
+	mLoadedHandle = Job::QueueWorkHandle(work);
+}
 
 Job::Work Image::GetLoadImageWork(const FileIO::Path aFilePath, const VkFormat aFormat) {
 	const std::string ext = str_tolower(aFilePath.Extension());
@@ -155,7 +339,7 @@ Job::Work Image::GetLoadImageWork(const FileIO::Path aFilePath, const VkFormat a
 	};
 	ImageLoaders selectedLoader = ImageLoaders::COUNT;
 
-	const LoaderMap loaderMap[(int)ImageLoaders::COUNT] = {{ImageLoaders::DDS, {".dds"}}, {}};
+	const LoaderMap loaderMap[(int)ImageLoaders::COUNT] = {{ImageLoaders::DDS, {".dds"}}, {ImageLoaders::KTX2, {".ktx2"}}, {}};
 	for(int i = 0; i < (int)ImageLoaders::COUNT && selectedLoader == ImageLoaders::COUNT; i++) {
 		const LoaderMap& map = loaderMap[i];
 		for(int q = 0; q < map.extensions.size(); q++) {
@@ -166,12 +350,23 @@ Job::Work Image::GetLoadImageWork(const FileIO::Path aFilePath, const VkFormat a
 		}
 	}
 
+	//an up to date block compressed copy is loaded instead of decoding the source
+	FileIO::Path loadPath = aFilePath;
+	if(selectedLoader == ImageLoaders::COUNT && gImageUseCompressedCache && TextureCompress::CanCompress(aFilePath.String()) &&
+	   TextureCompress::IsCacheValid(aFilePath.String())) {
+		selectedLoader = ImageLoaders::DDS;
+		loadPath = TextureCompress::GetCachePath(aFilePath.String());
+	}
+
 	mLoadingBase = nullptr;
 
 	switch(selectedLoader) {
 		case ImageLoaders::DDS:
 			mLoadingBase = new DDSLoader();
 			break;
+		case ImageLoaders::KTX2:
+			mLoadingBase = new KTX2Loader();
+			break;
 		case ImageLoaders::STB:
 		case ImageLoaders::COUNT: //fallback
 			mLoadingBase = new StbImageLoader();
@@ -186,7 +381,17 @@ Job::Work Image::GetLoadImageWork(const FileIO::Path aFilePath, const VkFormat a
 
 	mLoadingBase->SetUp(this);
 	mFormat = aFormat;
-	return mLoadingBase->GetWork(aFilePath);
+	mFilePath = aFilePath.String();
+	mFromMemory = false;
+	Job::Work work = mLoadingBase->GetWork(loadPath);
+	LoaderBase::AddTimings(work, &mLoadTimings);
+	return work;
+}
+
+void Image::WaitForLoad() {
+	if(mLoadedHandle) {
+		Job::WaitForWork(mLoadedHandle);
+	}
 }
 
 void Image::Destroy() {
@@ -204,7 +409,7 @@ void Image::Destroy() {
 }
 
 void Image::SetImageLayout(const VkCommandBuffer aBuffer, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkPipelineStageFlags aSrcStageMask,
-						   VkPipelineStageFlags aDstStageMask) const {
+						   VkPipelineStageFlags aDstStageMask, uint8_t aBaseMip, uint8_t aMipCount) const {
 	VkImageMemoryBarrier memoryBarrier = {};
 	memoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	memoryBarrier.oldLayout = aOldLayout;
@@ -216,9 +421,9 @@ void Image::SetImageLayout(const VkCommandBuffer aBuffer, VkImageLayout aOldLayo
 		memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	}
 	memoryBarrier.subresourceRange.baseArrayLayer = 0;
-	memoryBarrier.subresourceRange.baseMipLevel = 0;
+	memoryBarrier.subresourceRange.baseMipLevel = aBaseMip;
 	memoryBarrier.subresourceRange.layerCount = mArrayLayers;
-	memoryBarrier.subresourceRange.levelCount = 1;
+	memoryBarrier.subresourceRange.levelCount = aMipCount == 0 ? mMipLevels - aBaseMip : aMipCount;
 
 	switch(aOldLayout) {
 		case VK_IMAGE_LAYOUT_UNDEFINED:
@@ -227,6 +432,9 @@ void Image::SetImageLayout(const VkCommandBuffer aBuffer, VkImageLayout aOldLayo
 		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
 			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 			break;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			break;
 		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
 			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
 			break;
@@ -244,6 +452,9 @@ void Image::SetImageLayout(const VkCommandBuffer aBuffer, VkImageLayout aOldLayo
 		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
 			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 			break;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			break;
 		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
 			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 			break;
@@ -281,7 +492,7 @@ void Image::CreateVkImageView(const VkFormat aFormat, const char* aName /* = 0*/
 	createInfo.subresourceRange.baseArrayLayer = 0;
 	createInfo.subresourceRange.baseMipLevel = 0;
 	createInfo.subresourceRange.layerCount = mArrayLayers;
-	createInfo.subresourceRange.levelCount = 1;
+	createInfo.subresourceRange.levelCount = mMipLevels;
 
 	if(Graphics::IsFormatDepth(aFormat)) {
 		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 #include "Helpers.h"
@@ -7,6 +9,7 @@
 
 //for file loading
 #include "Engine/Job.h"
+#include "Loaders/LoaderBase.h"
 
 class Buffer;
 class LoaderBase;
@@ -28,21 +31,39 @@ public:
 	void SetArrayLayers(uint8_t aNumLayers) {
 		mArrayLayers = aNumLayers;
 	}
+	//levels made by the next CreateVkImage
+	void SetMipLevels(uint8_t aNumLevels) {
+		mMipLevels = aNumLevels;
+	}
+	//levels in a chain down to 1x1
+	static uint8_t GetFullMipLevels(const ImageSize aSize);
+	static ImageSize GetMipSize(const ImageSize aSize, const uint8_t aMip);
+	//a color format with a known block size, so its levels can be laid out in a buffer
+	static bool IsUploadableFormat(const VkFormat aFormat);
+	//every level of every layer, tightly packed
+	static VkDeviceSize GetByteSize(const ImageSize aSize, const VkFormat aFormat, const uint8_t aMipLevels = 1, const uint8_t aArrayLayers = 1);
 
 	void CreateVkImage(const VkFormat aFormat, const ImageSize aSize, const bool aAttachment, const char* aName /*= 0*/);
-	void CreateFromBuffer(Buffer& aBuffer, const bool aDestroyBuffer, const VkFormat aFormat, const ImageSize aSize, const char* aName = 0);
+	//aBuffer has every mip level for each layer in turn, or only the first level when aGenerateMips
+	//generated levels are blitted down from the first, if the format can't be blitted the image only gets one level
+	void CreateFromBuffer(Buffer& aBuffer, const bool aDestroyBuffer, const VkFormat aFormat, const ImageSize aSize, const char* aName = 0, const bool aGenerateMips = false);
 	void CreateFromVkImage(const VkImage aImage, const VkFormat aFormat, const ImageSize aSize, const char* aName = 0);
-	//always 4bit
+	//aData is laid out the same as CreateFromBuffer's buffer, with every mip level
 	void CreateFromData(const void* aData, const VkFormat aFormat, const ImageSize aSize, const char* aName = 0);
 
 	void LoadImageSync(const FileIO::Path aFilePath, const VkFormat aFormat);
 	void LoadImage(const FileIO::Path aFilePath, const VkFormat aFormat);
+	//aEncoded is a whole png/jpg file already in memory, aName is only used to name the image
+	void LoadImage(const FileIO::Path aName, std::vector<uint8_t> aEncoded, const VkFormat aFormat);
 
+	//blocks until a LoadImage job has finished, does nothing for images that weren't loaded async
+	void WaitForLoad();
 	void Destroy();
 
+	//aMipCount of 0 is every level from aBaseMip
 	void SetImageLayout(const VkCommandBuffer aBuffer, VkImageLayout aOldLayout, VkImageLayout aNewLayout,
 						VkPipelineStageFlags aSrcStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-						VkPipelineStageFlags aDstStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT) const;
+						VkPipelineStageFlags aDstStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, uint8_t aBaseMip = 0, uint8_t aMipCount = 0) const;
 
 	const VkImage GetImage() const {
 		return mImage;
@@ -53,6 +74,13 @@ public:
 	const ImageSize GetImageSize() const {
 		return mSize;
 	}
+	const uint8_t GetMipLevels() const {
+		return mMipLevels;
+	}
+	//device memory backing the image, 0 until it's created
+	const VkDeviceSize GetMemorySize() const {
+		return mAllocationInfo.size;
+	}
 
 	const bool HasLoaded() const {
 		if(mLoadedHandle == nullptr) {
@@ -67,11 +95,28 @@ public:
 		//}
 		//return mLoadedHandle == nullptr;
 	}
+	//the LoadImage job is done, HasLoaded stays false after this if it failed
+	const bool HasLoadFinished() const {
+		return Job::IsDone(mLoadedHandle);
+	}
 
 	const int GetGlobalIndex() const {
 		return mGlobalTextureIndex;
 	}
 
+	const LoadTimings& GetLoadTimings() const {
+		return mLoadTimings;
+	}
+
+	//path or name given to LoadImage, empty for images created from data
+	const std::string& GetFilePath() const {
+		return mFilePath;
+	}
+	//decoded from a file already in memory, GetFilePath is only a name for it
+	const bool IsFromMemory() const {
+		return mFromMemory;
+	}
+
 private:
 	void CreateVkImageView(const VkFormat aFormat, const char* aName = 0);
 
@@ -86,14 +131,21 @@ private:
 	VkFormat mFormat;
 
 	uint8_t mArrayLayers = 1;
+	uint8_t mMipLevels = 1;
 
 	VmaAllocation mAllocation = VK_NULL_HANDLE;
 	VmaAllocationInfo mAllocationInfo = {};
 
 	Job::WorkHandle* mLoadedHandle = nullptr;
 	LoaderBase* mLoadingBase;
+	LoadTimings mLoadTimings;
+	std::string mFilePath;
+	bool mFromMemory = false;
 };
 
+//png/jpg loads use the BC7/BC5 dds written by TextureCompress next to them when it's up to date
+extern bool gImageUseCompressedCache;
+
 namespace CONSTANTS {
 	namespace IMAGE {
 		extern Image* gWhite;
@@ -6,11 +6,14 @@
 
 #include "LoaderBase.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/VertexConvert.h"
 
 #include "PlatformDebug.h"
 #include "Graphics/Conversions.h"
 
 #include "Graphics/Image.h"
+#include "Graphics/Graphics.h"
+#include "Graphics/MaterialManager.h"
 #include "Engine/Transform.h"
 
 static_assert(NUM_UVS <= AI_MAX_NUMBER_OF_TEXTURECOORDS);
@@ -24,24 +27,40 @@ private:
 	};
 
 public:
+	static constexpr unsigned int cDefaultPostProcessFlags = aiProcess_CalcTangentSpace | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+															 aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph |
+															 aiProcess_GenBoundingBoxes;
+	//submeshes are built as triangle lists and culled with assimp's bounds, added to gMeshAssimpPostProcessFlags
+	static constexpr unsigned int cRequiredPostProcessFlags = aiProcess_Triangulate | aiProcess_GenBoundingBoxes;
+	static unsigned int GetPostProcessFlags() {
+		return gMeshAssimpPostProcessFlags | cRequiredPostProcessFlags;
+	}
+
 	virtual Job::Work GetWork(FileIO::Path aPath) override;
 
 private:
-	bool ProcessNode(const aiScene* aScene, const aiNode* aNode);
-	bool ProcessMesh(const aiScene* aScene, const aiMesh* aMesh);
+	struct MeshInstance {
+		const aiMesh* mMesh;
+		glm::mat4 mMatrix;
+	};
+
+	void ProcessScene(const aiScene* aScene);
+	void ProcessMaterials(const aiScene* aScene);
+	void ProcessNode(const aiScene* aScene, const aiNode* aNode, std::vector<MeshInstance>& aMeshes);
+	//thread safe, only writes to aSubMesh and aStats
+	void ProcessMesh(const aiMesh* aMesh, Mesh::SubMesh& aSubMesh, Mesh::OptimizeStats& aStats) const;
 };
 
 Job::Work AssimpLoader::GetWork(FileIO::Path aPath) {
 	Job::Work asyncWork;
 	asyncWork.mUserData = new AsyncLoadData();
-	asyncWork.mWorkPtr = [aPath](void* aData) {
+	//read here so a change while this is queued doesn't mismatch the cache key
+	const unsigned int postProcessFlags = GetPostProcessFlags();
+	asyncWork.mWorkPtr = [aPath, postProcessFlags](void* aData) {
 		ZoneScoped;
 		ZoneText(aPath.String().c_str(), aPath.String().size());
 		AsyncLoadData* data = (AsyncLoadData*)aData;
-		const aiScene* scene = data->importer.ReadFile(aPath.String().c_str(),
-													   aiProcess_CalcTangentSpace | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
-														   aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_OptimizeMeshes |
-														   aiProcess_OptimizeGraph | aiProcess_GenBoundingBoxes);
+		const aiScene* scene = data->importer.ReadFile(aPath.String().c_str(), postProcessFlags);
 
 		if(scene == nullptr) {
 			LOGGER::Formated("Failed to load Model {}\n", aPath.String());
@@ -56,8 +75,7 @@ Job::Work AssimpLoader::GetWork(FileIO::Path aPath) {
 		ZoneScoped;
 		AsyncLoadData* data = (AsyncLoadData*)aData;
 		if(data->mScene) {
-			mMesh->mMaterials.resize(data->mScene->mNumMaterials);
-			ProcessNode(data->mScene, data->mScene->mRootNode);
+			ProcessScene(data->mScene);
 			data->importer.FreeScene();
 		}
 		//we create this for the work, lets delete it now
@@ -66,7 +84,95 @@ Job::Work AssimpLoader::GetWork(FileIO::Path aPath) {
 	return asyncWork;
 };
 
-bool AssimpLoader::ProcessNode(const aiScene* aScene, const aiNode* aNode) {
+void AssimpLoader::ProcessScene(const aiScene* aScene) {
+	ZoneScoped;
+	//materials first so their image loads are queued before the mesh jobs
+	ProcessMaterials(aScene);
+
+	std::vector<MeshInstance> meshes;
+	ProcessNode(aScene, aScene->mRootNode, meshes);
+
+	//each aiMesh converts into its own submesh slot, so the jobs don't need to lock anything
+	const size_t numMeshes = meshes.size();
+	mMesh->mMesh.resize(numMeshes);
+	std::vector<Mesh::OptimizeStats> stats(numMeshes);
+	auto ProcessInstance = [this, &meshes, &stats](size_t aIndex) {
+		Mesh::SubMesh& subMesh = mMesh->mMesh[aIndex];
+		subMesh.mMatrix = meshes[aIndex].mMatrix;
+		ProcessMesh(meshes[aIndex].mMesh, subMesh, stats[aIndex]);
+	};
+
+	//this thread takes the first mesh, and any still queued when it waits on them
+	std::vector<Job::Work> work(numMeshes > 0 ? numMeshes - 1 : 0);
+	for(size_t i = 0; i < work.size(); i++) {
+		work[i].mWorkPtr = [ProcessInstance, i](void*) {
+			ProcessInstance(i + 1);
+		};
+	}
+	std::vector<Job::WorkHandle*> handles = Job::QueueWorkHandle(work);
+	if(numMeshes > 0) {
+		ProcessInstance(0);
+	}
+	for(int i = 0; i < handles.size(); i++) {
+		Job::WaitForWork(handles[i]);
+		handles[i]->Reset();
+	}
+
+	//uploads stay on this thread, in submesh order
+	for(size_t i = 0; i < numMeshes; i++) {
+		Mesh::SubMesh& subMesh = mMesh->mMesh[i];
+		mMesh->mOptimizeStats += stats[i];
+		mMesh->mAABB.Expand(subMesh.mAABB);
+		//temp
+		Mesh::CreateBuffers(subMesh);
+	}
+}
+
+void AssimpLoader::ProcessMaterials(const aiScene* aScene) {
+	ZoneScoped;
+	mMesh->mMaterials.resize(aScene->mNumMaterials);
+	MaterialManager* materialManager = gGraphics->GetMaterialManager();
+	for(unsigned int materialIndex = 0; materialIndex < aScene->mNumMaterials; materialIndex++) {
+		const aiMaterial* material = aScene->mMaterials[materialIndex];
+		Mesh::MeshMaterialData& materialData = mMesh->mMaterials[materialIndex];
+		for(int i = 0; i < material->mNumProperties; i++) {
+			const aiMaterialProperty* prop = material->mProperties[i];
+			//if(strcmp(prop->mKey.data, _AI_MATKEY_TEXTURE_BASE)){
+			LOGGER::Formated("Material semantic {}, {}\n", prop->mKey.C_Str(), prop->mSemantic);
+			//}
+		}
+		//first texture of each type
+		aiString str;
+		if(materialData.mImage == nullptr && material->GetTexture(aiTextureType_DIFFUSE, 0, &str) == aiReturn_SUCCESS) {
+			materialData.mImage = materialManager->AcquireTexture(mMesh->mImagePath + str.C_Str(), VK_FORMAT_UNDEFINED);
+		}
+		if(materialData.mMetallicRoughnessTexture == nullptr && material->GetTexture(aiTextureType_METALNESS, 0, &str) == aiReturn_SUCCESS) {
+			materialData.mMetallicRoughnessTexture = materialManager->AcquireTexture(mMesh->mImagePath + str.C_Str(), VK_FORMAT_UNDEFINED);
+		}
+		if(materialData.mNormal == nullptr && material->GetTexture(aiTextureType_NORMALS, 0, &str) == aiReturn_SUCCESS) {
+			materialData.mNormal = materialManager->AcquireTexture(mMesh->mImagePath + str.C_Str(), VK_FORMAT_UNDEFINED);
+		}
+
+		aiColor4D colorFactor;
+		if(material->Get(AI_MATKEY_BASE_COLOR, colorFactor) == aiReturn_SUCCESS) {
+			materialData.mColorFactor = AssimpToGlm(colorFactor);
+		} else if(material->Get(AI_MATKEY_COLOR_DIFFUSE, colorFactor) == aiReturn_SUCCESS) {
+			materialData.mColorFactor = AssimpToGlm(colorFactor);
+		}
+		float metallic;
+		if(material->Get(AI_MATKEY_METALLIC_FACTOR, metallic) == aiReturn_SUCCESS) {
+			materialData.mMetallicRoughness.x = metallic;
+		}
+		float roughness;
+		if(material->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness) == aiReturn_SUCCESS) {
+			materialData.mMetallicRoughness.y = roughness;
+		}
+
+		//std::vector<Texture> diffuseMaps = this->loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", scene);
+	}
+}
+
+void AssimpLoader::ProcessNode(const aiScene* aScene, const aiNode* aNode, std::vector<MeshInstance>& aMeshes) {
 	ZoneScoped;
 
 	Transform transform;
@@ -77,64 +183,64 @@ bool AssimpLoader::ProcessNode(const aiScene* aScene, const aiNode* aNode) {
 	transform.SetPosition(glm::vec3(position.x, position.y, position.z));
 	transform.SetRotation(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
 	transform.SetScale(glm::vec3(scale.x, scale.y, scale.z) / 100.0f);
+	const glm::mat4 matrix = transform.GetWorldMatrix();
 
 	for(uint16_t i = 0; i < aNode->mNumMeshes; i++) {
 		int meshId = aNode->mMeshes[i];
-		//meshes_.push_back(this->processMesh(aScene, mesh));
-		this->ProcessMesh(aScene, aScene->mMeshes[meshId]);
-
-		mMesh->mMesh.back().mMatrix = transform.GetWorldMatrix();
+		aMeshes.push_back({aScene->mMeshes[meshId], matrix});
 		//mMesh->mMesh.back().mTransform = transform.WorldToSimple();
 	}
 	for(uint16_t i = 0; i < aNode->mNumChildren; i++) {
-		this->ProcessNode(aScene, aNode->mChildren[i]);
+		this->ProcessNode(aScene, aNode->mChildren[i], aMeshes);
 	}
-	return true;
 }
 
-bool AssimpLoader::ProcessMesh(const aiScene* aScene, const aiMesh* aMesh) {
+void AssimpLoader::ProcessMesh(const aiMesh* aMesh, Mesh::SubMesh& aSubMesh, Mesh::OptimizeStats& aStats) const {
 	ZoneScoped;
-	mMesh->mMesh.push_back(Mesh::SubMesh());
-	Mesh::SubMesh& mesh = mMesh->mMesh.back();
+	Mesh::SubMesh& mesh = aSubMesh;
 	std::vector<MeshVert>& vertices = mesh.mVertices;
 	std::vector<MeshIndex>& indices = mesh.mIndices;
 
-	//todo memcpy these values?
-
-	mesh.mVertices.resize(aMesh->mNumVertices);
+	const size_t numVertices = aMesh->mNumVertices;
+	mesh.mVertices.resize(numVertices);
+	//assimp keeps each attribute in its own float array, converted straight into the MeshVert members
+	static_assert(sizeof(ai_real) == sizeof(float), "assimp built with double precision");
+	auto ConvertAttribute = [numVertices](const void* aSource, uint32_t aSourceStride, uint32_t aSourceComponents, float* aDest, uint32_t aDestComponents) {
+		VertexConvert::Stream stream;
+		stream.mData = aSource;
+		stream.mStride = aSourceStride;
+		stream.mFormat = VertexConvert::Format::FLOAT;
+		stream.mComponents = aSourceComponents;
+		VertexConvert::ConvertToFloat(stream, aDest, sizeof(MeshVert), aDestComponents, numVertices);
+	};
 	//Vertices
-	for(uint64_t i = 0; i < aMesh->mNumVertices; i++) {
-		MeshVert vertex;
-		if(aMesh->HasPositions()) {
-			vertex.mPos = AssimpToGlm(aMesh->mVertices[i]);
-		}
-
-		if(aMesh->HasNormals()) {
-			vertex.mNorm = AssimpToGlm(aMesh->mNormals[i]);
-		}
-
-		if(aMesh->HasTangentsAndBitangents()) {
-			vertex.mTangent = AssimpToGlm(aMesh->mTangents[i]);
-			vertex.mBiTangent = AssimpToGlm(aMesh->mBitangents[i]);
-		}
-
-		for(uint64_t channel = 0; channel < NUM_VERT_COLS; channel++) {
-			if(aMesh->HasVertexColors(channel)) {
-				vertex.mColors[channel] = AssimpToGlm(aMesh->mColors[channel][i]);
-			} else {
-				vertex.mColors[channel] = glm::vec4(1, 0, 1, 1);
+	if(aMesh->HasPositions()) {
+		ConvertAttribute(aMesh->mVertices, sizeof(aiVector3D), 3, &vertices[0].mPos.x, 3);
+	}
+	if(aMesh->HasNormals()) {
+		ConvertAttribute(aMesh->mNormals, sizeof(aiVector3D), 3, &vertices[0].mNorm.x, 3);
+	}
+	if(aMesh->HasTangentsAndBitangents()) {
+		ConvertAttribute(aMesh->mTangents, sizeof(aiVector3D), 3, &vertices[0].mTangent.x, 3);
+		ConvertAttribute(aMesh->mBitangents, sizeof(aiVector3D), 3, &vertices[0].mBiTangent.x, 3);
+	}
+	for(uint64_t channel = 0; channel < NUM_VERT_COLS; channel++) {
+		if(aMesh->HasVertexColors(channel)) {
+			ConvertAttribute(aMesh->mColors[channel], sizeof(aiColor4D), 4, &vertices[0].mColors[channel].x, 4);
+		} else {
+			for(size_t i = 0; i < numVertices; i++) {
+				vertices[i].mColors[channel] = glm::vec4(1, 0, 1, 1);
 			}
 		}
-
-		for(uint64_t channel = 0; channel < NUM_UVS; channel++) {
-			if(aMesh->HasTextureCoords(channel)) {
-				vertex.mUVs[channel] = AssimpToGlm(aMesh->mTextureCoords[channel][i]);
-			} else {
-				vertex.mUVs[channel] = glm::vec2(-1);
+	}
+	for(uint64_t channel = 0; channel < NUM_UVS; channel++) {
+		if(aMesh->HasTextureCoords(channel)) {
+			ConvertAttribute(aMesh->mTextureCoords[channel], sizeof(aiVector3D), 3, &vertices[0].mUVs[channel].x, 2);
+		} else {
+			for(size_t i = 0; i < numVertices; i++) {
+				vertices[i].mUVs[channel] = glm::vec2(-1);
 			}
 		}
-
-		vertices[i] = vertex;
 	}
 
 	//Indices
@@ -174,81 +280,12 @@ bool AssimpLoader::ProcessMesh(const aiScene* aScene, const aiMesh* aMesh) {
 	{
 		const aiAABB& aabb = aMesh->mAABB;
 		mesh.mAABB.Expand(AssimpToGlm(aabb.mMin), AssimpToGlm(aabb.mMax));
-		mMesh->mAABB.Expand(mesh.mAABB);
-	}
-
-	//Material
-	if(aMesh->mMaterialIndex >= 0) {
-		mesh.mMaterialID = aMesh->mMaterialIndex;
-		const aiMaterial* material = aScene->mMaterials[aMesh->mMaterialIndex];
-		for(int i = 0; i < material->mNumProperties; i++) {
-			const aiMaterialProperty* prop = material->mProperties[i];
-			//if(strcmp(prop->mKey.data, _AI_MATKEY_TEXTURE_BASE)){
-			LOGGER::Formated("Material semantic {}, {}\n", prop->mKey.C_Str(), prop->mSemantic);
-			//}
-		}
-		for(unsigned int i = 0; i < material->GetTextureCount(aiTextureType_DIFFUSE); i++) {
-			aiString str;
-			material->GetTexture(aiTextureType_DIFFUSE, i, &str);
-			const std::string fileName = str.C_Str();
-
-			Mesh::MeshMaterialData& materialData = mMesh->mMaterials[aMesh->mMaterialIndex];
-			if(materialData.mImage == nullptr) {
-				Image* image = new Image();
-				image->LoadImage(mMesh->mImagePath + fileName, VK_FORMAT_UNDEFINED);
-				materialData.mImage = image;
-			}
-		}
-		for(unsigned int i = 0; i < material->GetTextureCount(aiTextureType_METALNESS); i++) {
-			aiString str;
-			material->GetTexture(aiTextureType_METALNESS, i, &str);
-			const std::string fileName = str.C_Str();
-
-			Mesh::MeshMaterialData& materialData = mMesh->mMaterials[aMesh->mMaterialIndex];
-			if(materialData.mImage == nullptr) {
-				Image* image = new Image();
-				image->LoadImage(mMesh->mImagePath + fileName, VK_FORMAT_UNDEFINED);
-				materialData.mMetallicRoughnessTexture = image;
-			}
-		}
-		for(unsigned int i = 0; i < material->GetTextureCount(aiTextureType_NORMALS); i++) {
-			aiString str;
-			material->GetTexture(aiTextureType_NORMALS, i, &str);
-			const std::string fileName = str.C_Str();
-
-			Mesh::MeshMaterialData& materialData = mMesh->mMaterials[aMesh->mMaterialIndex];
-			if(materialData.mImage == nullptr) {
-				Image* image = new Image();
-				image->LoadImage(mMesh->mImagePath + fileName, VK_FORMAT_UNDEFINED);
-				materialData.mNormal = image;
-			}
-		}
-		for(unsigned int i = 0; i < mMesh->mMaterials.size(); i++) {
-			Mesh::MeshMaterialData& materialData = mMesh->mMaterials[i];
-			aiColor4D colorFactor;
-			if(material->Get(AI_MATKEY_BASE_COLOR, colorFactor) == aiReturn_SUCCESS) {
-				materialData.mColorFactor = AssimpToGlm(colorFactor);
-			} else if(material->Get(AI_MATKEY_COLOR_DIFFUSE, colorFactor) == aiReturn_SUCCESS) {
-				materialData.mColorFactor = AssimpToGlm(colorFactor);
-			}
-			float metallic;
-			if(material->Get(AI_MATKEY_METALLIC_FACTOR, metallic) == aiReturn_SUCCESS) {
-				materialData.mMetallicRoughness.x = metallic;
-			}
-			float roughness;
-			if(material->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness) == aiReturn_SUCCESS) {
-				materialData.mMetallicRoughness.y = roughness;
-			}
-		}
-
-		//std::vector<Texture> diffuseMaps = this->loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", scene);
 	}
 
-	//temp
-	mesh.mVertexBuffer.CreateFromData(BufferType::VERTEX, sizeof(MeshVert) * vertices.size(), vertices.data(), "Mesh Vertex Data");
-	mesh.mIndexBuffer.CreateFromData(BufferType::INDEX, sizeof(MeshIndex) * indices.size(), indices.data(), "Mesh Index Data");
-	mesh.mVertexBuffer.Flush();
-	mesh.mIndexBuffer.Flush();
+	//Material, set up in ProcessMaterials
+	mesh.mMaterialID = aMesh->mMaterialIndex;
 
-	return true;
+	Mesh::OptimizeSubMesh(mesh, aStats);
+	Mesh::GenerateLODs(mesh);
+	Mesh::GenerateMeshlets(mesh);
 }
\ No newline at end of file
@@ -142,14 +142,19 @@ Job::Work DDSLoader::GetWork(FileIO::Path aPath) {
 		ASSERT(header->flags & 0x4); //width
 		ASSERT(header->dataFlags & 0x4); //fourCC
 
+		const ImageSize size = {header->width, header->height};
 		uint8_t mipCount = 1;
 		if(header->flags & 0x20000) { //mipcount
-			mipCount = header->mipMapCount;
+			mipCount = std::clamp(header->mipMapCount, 1u, (uint32_t)Image::GetFullMipLevels(size));
 		}
+		//mips are stored largest first after the top level, drop any the file was cut short on
+		while(mipCount > 1 && pixelDataOffset + Image::GetByteSize(size, desiredFormat, mipCount) > file.mSize) {
+			mipCount--;
+		}
+		ASSERT(pixelDataOffset + Image::GetByteSize(size, desiredFormat, mipCount) <= file.mSize);
 
-		//todo mips
-
-		pThis->mImage->CreateFromData(data + pixelDataOffset, desiredFormat, {header->width, header->height}, aPath.String().c_str());
+		pThis->mImage->SetMipLevels(mipCount);
+		pThis->mImage->CreateFromData(data + pixelDataOffset, desiredFormat, size, aPath.String().c_str());
 
 		FileIO::UnloadFile(file);
 	};
@@ -160,6 +165,8 @@ VkFormat DDSLoader::SelectVKFormatFromDXGI(uint32_t aFormat) {
 	switch(aFormat) {
 		case 98: //DXGI_FORMAT_BC7_UNORM
 			return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 83: //DXGI_FORMAT_BC5_UNORM
+			return VK_FORMAT_BC5_UNORM_BLOCK;
 	}
 	return VK_FORMAT_UNDEFINED;
 }
@@ -0,0 +1,220 @@
+#pragma once
+//https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#if defined(ENABLE_ZSTD)
+#	include <zstd.h>
+#endif
+
+#include "LoaderBase.h"
+#include "Graphics/Image.h"
+#include "Graphics/Buffer.h"
+
+#include "PlatformDebug.h"
+
+//2d textures and arrays in any vulkan format we know the block size of, with their mips
+//levels can be zstd supercompressed. a level count of 0 has its mips generated after the upload
+//basis universal (vkFormat 0), zlib, cube maps and 3d textures aren't supported
+
+class KTX2Loader : public LoaderBase {
+private:
+	struct AsyncLoadData {
+		//every level of each layer in turn, filled and unmapped on the loading thread
+		Buffer mStaging;
+		bool mLoaded = false;
+		Image* ptr;
+		VkFormat mFormat;
+		ImageSize mSize;
+		uint8_t mMipLevels;
+		uint8_t mArrayLayers;
+		bool mGenerateMips;
+	};
+
+public:
+	virtual Job::Work GetWork(FileIO::Path aPath) override;
+
+private:
+	static bool Load(const FileIO::File& aFile, AsyncLoadData* aData, const std::string& aName);
+};
+
+struct KTX2Header {
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount; //0 when not an array
+	uint32_t faceCount;
+	uint32_t levelCount; //0 to generate the mips
+	uint32_t supercompressionScheme;
+
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+static_assert(sizeof(KTX2Header) == 80);
+
+//one for each level straight after the header, largest level first
+struct KTX2LevelIndex {
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+static constexpr uint8_t KTX2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+static constexpr uint32_t KTX2SupercompressionNone = 0;
+static constexpr uint32_t KTX2SupercompressionZstd = 2;
+
+Job::Work KTX2Loader::GetWork(FileIO::Path aPath) {
+	Job::Work work;
+	AsyncLoadData* imageData = new AsyncLoadData();
+	imageData->ptr = mImage;
+
+	work.mUserData = imageData;
+	work.mWorkPtr = [aPath](void* userData) {
+		ZoneScoped;
+		ZoneText(aPath.String().c_str(), aPath.String().size());
+		AsyncLoadData* imageData = (AsyncLoadData*)userData;
+		FileIO::File file = FileIO::MapFile(aPath);
+		if(file.mData == nullptr) {
+			LOGGER::Formated("Failed to open image {}\n", aPath.String());
+			ASSERT(false);
+			return;
+		}
+		imageData->mLoaded = Load(file, imageData, aPath.String());
+		ASSERT(imageData->mLoaded);
+		FileIO::UnloadFile(file);
+	};
+	work.mFinishPtr = [=](void* userData) {
+		ZoneScoped;
+		AsyncLoadData* imageData = (AsyncLoadData*)userData;
+		if(imageData->mLoaded) {
+			Image* image = imageData->ptr;
+			image->SetArrayLayers(imageData->mArrayLayers);
+			image->SetMipLevels(imageData->mGenerateMips ? Image::GetFullMipLevels(imageData->mSize) : imageData->mMipLevels);
+			image->CreateFromBuffer(imageData->mStaging, true, imageData->mFormat, imageData->mSize, aPath.String().c_str(), imageData->mGenerateMips);
+		} else {
+			imageData->mStaging.Destroy();
+		}
+		delete imageData;
+	};
+	return work;
+}
+
+//static
+bool KTX2Loader::Load(const FileIO::File& aFile, AsyncLoadData* aData, const std::string& aName) {
+	const auto Fail = [&aName](const char* aReason) {
+		LOGGER::Formated("Failed to load ktx2 {}, {}\n", aName, aReason);
+		return false;
+	};
+	if(aFile.mSize < sizeof(KTX2Header)) {
+		return Fail("too small");
+	}
+	KTX2Header header;
+	memcpy(&header, aFile.mData, sizeof(KTX2Header));
+	if(memcmp(header.identifier, KTX2Identifier, sizeof(KTX2Identifier)) != 0) {
+		return Fail("not a ktx2 file");
+	}
+	if(header.vkFormat == VK_FORMAT_UNDEFINED) {
+		return Fail("basis universal textures need transcoding");
+	}
+	if(header.pixelHeight == 0 || header.pixelDepth > 1 || header.faceCount != 1) {
+		return Fail("only 2d textures and arrays are supported");
+	}
+	const VkFormat format = (VkFormat)header.vkFormat;
+	if(!Image::IsUploadableFormat(format)) {
+		return Fail("unknown format");
+	}
+	const ImageSize size = {header.pixelWidth, header.pixelHeight};
+	const uint32_t mipLevels = std::max(header.levelCount, 1u);
+	const uint32_t arrayLayers = std::max(header.layerCount, 1u);
+	if(mipLevels > Image::GetFullMipLevels(size) || arrayLayers > UINT8_MAX) {
+		return Fail("too many levels or layers");
+	}
+#if defined(ENABLE_ZSTD)
+	if(header.supercompressionScheme != KTX2SupercompressionNone && header.supercompressionScheme != KTX2SupercompressionZstd) {
+		return Fail("only zstd supercompression is supported");
+	}
+#else
+	if(header.supercompressionScheme != KTX2SupercompressionNone) {
+		return Fail("supercompressed, built without zstd");
+	}
+#endif
+	if(sizeof(KTX2Header) + mipLevels * sizeof(KTX2LevelIndex) > aFile.mSize) {
+		return Fail("level index is cut short");
+	}
+	const KTX2LevelIndex* levelIndex = (const KTX2LevelIndex*)(aFile.mData + sizeof(KTX2Header));
+
+	aData->mFormat = format;
+	aData->mSize = size;
+	aData->mMipLevels = mipLevels;
+	aData->mArrayLayers = arrayLayers;
+	aData->mGenerateMips = header.levelCount == 0;
+
+	//ktx2 keeps each level's layers together, the staging buffer is layer by layer like dds
+	const VkDeviceSize layerSize = Image::GetByteSize(size, format, mipLevels);
+	aData->mStaging.Create(BufferType::STAGING, layerSize * arrayLayers, aName.c_str());
+	uint8_t* staging = (uint8_t*)aData->mStaging.Map();
+	//zstd reads back what it has written, which is slow on uncached memory
+	const bool decompressInPlace = arrayLayers == 1 && aData->mStaging.IsHostCached();
+
+	bool loaded = true;
+	std::vector<uint8_t> decompressed;
+	VkDeviceSize levelOffset = 0;
+	for(uint32_t level = 0; level < mipLevels && loaded; level++) {
+		const KTX2LevelIndex& index = levelIndex[level];
+		const VkDeviceSize levelLayerSize = Image::GetByteSize(Image::GetMipSize(size, level), format);
+		const VkDeviceSize levelSize = levelLayerSize * arrayLayers;
+		if(index.byteOffset > aFile.mSize || index.byteLength > aFile.mSize - index.byteOffset) {
+			loaded = Fail("level is past the end of the file");
+			break;
+		}
+		const uint8_t* source = (const uint8_t*)aFile.mData + index.byteOffset;
+
+		if(header.supercompressionScheme == KTX2SupercompressionNone) {
+			if(index.byteLength != levelSize) {
+				loaded = Fail("level is the wrong size");
+				break;
+			}
+		}
+#if defined(ENABLE_ZSTD)
+		if(header.supercompressionScheme == KTX2SupercompressionZstd) {
+			ZoneScopedN("Zstd");
+			if(index.uncompressedByteLength != levelSize) {
+				loaded = Fail("level is the wrong size");
+				break;
+			}
+			uint8_t* dest = staging + levelOffset;
+			if(!decompressInPlace) {
+				decompressed.resize(levelSize);
+				dest = decompressed.data();
+			}
+			const size_t result = ZSTD_decompress(dest, levelSize, source, index.byteLength);
+			if(ZSTD_isError(result) || result != levelSize) {
+				loaded = Fail(ZSTD_isError(result) ? ZSTD_getErrorName(result) : "level is the wrong size");
+				break;
+			}
+			source = decompressed.data();
+		}
+#endif
+
+		if(!(header.supercompressionScheme == KTX2SupercompressionZstd && decompressInPlace)) {
+			for(uint32_t layer = 0; layer < arrayLayers; layer++) {
+				memcpy(staging + layerSize * layer + levelOffset, source + levelLayerSize * layer, levelLayerSize);
+			}
+		}
+		levelOffset += levelLayerSize;
+	}
+
+	aData->mStaging.UnMap();
+	return loaded;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "Engine/Job.h"
 #include "Engine/FileIO.h"
 
@@ -8,7 +10,7 @@ class Image;
 
 enum class MeshLoaders
 {
-	TINYGLTF, //for .gltf files
+	TINYGLTF, //for .gltf/.glb files
 	ASSIMP, //generic fallback
 	COUNT
 };
@@ -16,10 +18,19 @@ enum class MeshLoaders
 enum class ImageLoaders
 {
 	DDS, //for .dds files
+	KTX2, //for .ktx2 files
 	STB, //generic fallback
 	COUNT
 };
 
+//how long the last load took
+struct LoadTimings {
+	//the work on the loading thread, reading and parsing the file
+	double mParseMs = 0.0;
+	//the finish, converting and queueing the uploads
+	double mFinishMs = 0.0;
+};
+
 class LoaderBase {
 public:
 	virtual ~LoaderBase() {
@@ -28,6 +39,29 @@ public:
 
 	virtual Job::Work GetWork(FileIO::Path aPath) = 0;
 
+	//wraps aWork's functions to fill in aTimings as they run
+	static void AddTimings(Job::Work& aWork, LoadTimings* aTimings) {
+		const auto MillisecondsSince = [](std::chrono::high_resolution_clock::time_point aStart) {
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - aStart).count();
+		};
+		const Job::WorkFunction work = aWork.mWorkPtr;
+		if(work) {
+			aWork.mWorkPtr = [work, aTimings, MillisecondsSince](void* aData) {
+				const auto start = std::chrono::high_resolution_clock::now();
+				work(aData);
+				aTimings->mParseMs = MillisecondsSince(start);
+			};
+		}
+		const Job::WorkFunction finish = aWork.mFinishPtr;
+		if(finish) {
+			aWork.mFinishPtr = [finish, aTimings, MillisecondsSince](void* aData) {
+				const auto start = std::chrono::high_resolution_clock::now();
+				finish(aData);
+				aTimings->mFinishMs = MillisecondsSince(start);
+			};
+		}
+	}
+
 	void SetUp(Mesh* aMesh) {
 		mMesh = aMesh;
 	}
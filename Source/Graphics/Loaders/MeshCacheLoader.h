@@ -0,0 +1,404 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <filesystem>
+
+#include <meshoptimizer.h>
+
+#include "LoaderBase.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Image.h"
+#include "Graphics/Graphics.h"
+#include "Graphics/MaterialManager.h"
+#include "PlatformDebug.h"
+
+//cooked copy of a Mesh, written after the first import and memory mapped on later loads
+//the file name is a hash of the source path, its write time and the importer settings, so any change to those makes a new file
+//the name starts with a hash of just the source path, writing a new file removes the others for that source
+//layout: Header, SubMeshHeader[mNumSubMeshes], MaterialHeader[mNumMaterials], then the vertex/index/string data they point to
+//vertex and index data is meshoptimizer encoded, it decodes faster than the file can be read
+class MeshCacheLoader : public LoaderBase {
+public:
+	~MeshCacheLoader() override {
+		FileIO::UnloadFile(mFile);
+	}
+
+	//empty if the source file can't be found
+	static std::string GetCachePath(const FileIO::Path& aSourcePath, const std::string& aImporterSettings);
+	static void WriteCache(const Mesh* aMesh, const std::string& aCachePath);
+
+	//maps the cache and checks it's usable, false means the source needs importing
+	bool Open(const std::string& aCachePath);
+
+	virtual Job::Work GetWork(FileIO::Path aPath) override;
+
+private:
+	static constexpr uint32_t cMagic = 0x434D5047; //GPMC
+	//bump when this layout or MeshVert changes
+	static constexpr uint32_t cVersion = 4;
+	static constexpr int cNumMaterialImages = 3;
+
+	struct Header {
+		uint32_t mMagic;
+		uint32_t mVersion;
+		uint32_t mVertexSize;
+		uint32_t mNumSubMeshes;
+		uint32_t mNumMaterials;
+		glm::vec3 mAABBMin;
+		glm::vec3 mAABBMax;
+	};
+
+	struct SubMeshHeader {
+		glm::mat4 mMatrix;
+		glm::vec3 mAABBMin;
+		glm::vec3 mAABBMax;
+		int32_t mMaterialID;
+		uint32_t mNumVertices;
+		uint32_t mNumIndices;
+		uint64_t mVertexOffset;
+		uint64_t mIndexOffset;
+		//encoded sizes
+		uint64_t mVertexBytes;
+		uint64_t mIndexBytes;
+		//lod 1+ indices, encoded separately
+		uint32_t mNumLODIndices;
+		uint64_t mLODIndexOffset;
+		uint64_t mLODIndexBytes;
+		uint32_t mNumLODs;
+		Mesh::MeshLOD mLODs[Mesh::cMaxLODs];
+		//meshlet indices are encoded, the Meshlets are stored as is
+		uint32_t mNumMeshletIndices;
+		uint64_t mMeshletIndexOffset;
+		uint64_t mMeshletIndexBytes;
+		uint32_t mNumMeshlets;
+		uint64_t mMeshletOffset;
+	};
+
+	struct MaterialHeader {
+		glm::vec4 mColorFactor;
+		glm::vec2 mMetallicRoughness;
+		float mAlphaCutoff;
+		uint32_t mNormalBC5;
+		//image, normal, metallic roughness. length 0 for no image
+		uint64_t mPathOffset[cNumMaterialImages];
+		uint32_t mPathLength[cNumMaterialImages];
+	};
+
+	static uint64_t Hash(const std::string& aKey);
+	//deletes the caches written for the same source with other settings or an older source file
+	static void RemoveStaleCaches(const std::string& aCachePath);
+	bool InFile(uint64_t aOffset, uint64_t aSize) const {
+		return aOffset <= mFile.mSize && aSize <= mFile.mSize - aOffset;
+	}
+
+	FileIO::File mFile;
+};
+
+//FNV-1a
+uint64_t MeshCacheLoader::Hash(const std::string& aKey) {
+	uint64_t hash = 14695981039346656037ull;
+	for(int i = 0; i < aKey.size(); i++) {
+		hash ^= (uint8_t)aKey[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string MeshCacheLoader::GetCachePath(const FileIO::Path& aSourcePath, const std::string& aImporterSettings) {
+	std::error_code error;
+	const std::filesystem::path sourcePath = aSourcePath.String();
+	const auto writeTime = std::filesystem::last_write_time(sourcePath, error);
+	if(error) {
+		return "";
+	}
+	const std::string key = aSourcePath.String() + "|" + std::to_string(writeTime.time_since_epoch().count()) + "|" + aImporterSettings + "|" +
+							std::to_string(cVersion) + "|" + std::to_string(sizeof(MeshVert));
+
+	char name[64];
+	snprintf(name, sizeof(name), "%016llx_%016llx.meshcache", (unsigned long long)Hash(aSourcePath.String()), (unsigned long long)Hash(key));
+	return std::string(WORK_DIR_REL) + "/Cache/Meshes/" + name;
+}
+
+//static
+void MeshCacheLoader::RemoveStaleCaches(const std::string& aCachePath) {
+	ZoneScoped;
+	const std::filesystem::path cachePath = aCachePath;
+	const std::string fileName = cachePath.filename().string();
+	const size_t prefixEnd = fileName.find('_');
+	if(prefixEnd == std::string::npos) {
+		return;
+	}
+	const std::string sourcePrefix = fileName.substr(0, prefixEnd + 1);
+	std::error_code error;
+	for(const auto& entry: std::filesystem::directory_iterator(cachePath.parent_path(), error)) {
+		const std::string name = entry.path().filename().string();
+		//SaveFile's temp files don't have the extension, they're left alone
+		if(name != fileName && name.compare(0, sourcePrefix.size(), sourcePrefix) == 0 && entry.path().extension() == ".meshcache") {
+			//may still be mapped by another mesh, it's tried again on the next write
+			std::error_code removeError;
+			if(std::filesystem::remove(entry.path(), removeError)) {
+				LOGGER::Formated("Removed stale mesh cache {}\n", name);
+			}
+		}
+	}
+}
+
+void MeshCacheLoader::WriteCache(const Mesh* aMesh, const std::string& aCachePath) {
+	ZoneScoped;
+	const int numSubMeshes = aMesh->mMesh.size();
+	const int numMaterials = aMesh->mMaterials.size();
+	//the cache only keeps image paths, images decoded out of the model itself need the importer to find them again
+	for(int i = 0; i < numMaterials; i++) {
+		const Mesh::MeshMaterialData& material = aMesh->mMaterials[i];
+		const Image* images[cNumMaterialImages] = {material.mImage, material.mNormal, material.mMetallicRoughnessTexture};
+		for(int q = 0; q < cNumMaterialImages; q++) {
+			if(images[q] && images[q]->IsFromMemory()) {
+				LOGGER::Formated("Not caching {}, it has images embedded in the model\n", aCachePath);
+				return;
+			}
+		}
+	}
+
+	//work out where everything goes first so the file is written in one go
+	const auto Align = [](uint64_t aOffset) {
+		return (aOffset + 15) & ~15ull;
+	};
+	uint64_t dataOffset = sizeof(Header) + sizeof(SubMeshHeader) * numSubMeshes + sizeof(MaterialHeader) * numMaterials;
+	std::vector<SubMeshHeader> subMeshHeaders(numSubMeshes);
+	std::vector<std::vector<unsigned char>> encodedVertices(numSubMeshes);
+	std::vector<std::vector<unsigned char>> encodedIndices(numSubMeshes);
+	std::vector<std::vector<unsigned char>> encodedLODIndices(numSubMeshes);
+	std::vector<std::vector<unsigned char>> encodedMeshletIndices(numSubMeshes);
+	uint64_t rawBytes = 0;
+	uint64_t encodedBytes = 0;
+	for(int i = 0; i < numSubMeshes; i++) {
+		const Mesh::SubMesh& mesh = aMesh->mMesh[i];
+		SubMeshHeader& header = subMeshHeaders[i];
+		header.mMatrix = mesh.mMatrix;
+		header.mAABBMin = mesh.mAABB.mMin;
+		header.mAABBMax = mesh.mAABB.mMax;
+		header.mMaterialID = mesh.mMaterialID;
+		header.mNumVertices = mesh.mVertices.size();
+		header.mNumIndices = mesh.mIndices.size();
+
+		std::vector<unsigned char>& vertexData = encodedVertices[i];
+		vertexData.resize(meshopt_encodeVertexBufferBound(header.mNumVertices, sizeof(MeshVert)));
+		vertexData.resize(meshopt_encodeVertexBuffer(vertexData.data(), vertexData.size(), mesh.mVertices.data(), header.mNumVertices, sizeof(MeshVert)));
+		//index codec only takes triangle lists, anything else is stored as is
+		std::vector<unsigned char>& indexData = encodedIndices[i];
+		if(header.mNumIndices % 3 == 0) {
+			indexData.resize(meshopt_encodeIndexBufferBound(header.mNumIndices, header.mNumVertices));
+			indexData.resize(meshopt_encodeIndexBuffer(indexData.data(), indexData.size(), mesh.mIndices.data(), header.mNumIndices));
+		} else {
+			indexData.resize(sizeof(MeshIndex) * header.mNumIndices);
+			memcpy(indexData.data(), mesh.mIndices.data(), indexData.size());
+		}
+
+		header.mVertexOffset = dataOffset = Align(dataOffset);
+		header.mVertexBytes = vertexData.size();
+		dataOffset += header.mVertexBytes;
+		header.mIndexOffset = dataOffset = Align(dataOffset);
+		header.mIndexBytes = indexData.size();
+		dataOffset += header.mIndexBytes;
+
+		//simplified lods are always triangle lists
+		std::vector<unsigned char>& lodIndexData = encodedLODIndices[i];
+		header.mNumLODIndices = mesh.mLODIndices.size();
+		if(header.mNumLODIndices != 0) {
+			lodIndexData.resize(meshopt_encodeIndexBufferBound(header.mNumLODIndices, header.mNumVertices));
+			lodIndexData.resize(meshopt_encodeIndexBuffer(lodIndexData.data(), lodIndexData.size(), mesh.mLODIndices.data(), header.mNumLODIndices));
+		}
+		header.mLODIndexOffset = dataOffset = Align(dataOffset);
+		header.mLODIndexBytes = lodIndexData.size();
+		dataOffset += header.mLODIndexBytes;
+		header.mNumLODs = glm::min((int)mesh.mLODs.size(), Mesh::cMaxLODs);
+		for(uint32_t q = 0; q < header.mNumLODs; q++) {
+			header.mLODs[q] = mesh.mLODs[q];
+		}
+
+		std::vector<unsigned char>& meshletIndexData = encodedMeshletIndices[i];
+		header.mNumMeshletIndices = mesh.mMeshletIndices.size();
+		if(header.mNumMeshletIndices != 0) {
+			meshletIndexData.resize(meshopt_encodeIndexBufferBound(header.mNumMeshletIndices, header.mNumVertices));
+			meshletIndexData.resize(
+				meshopt_encodeIndexBuffer(meshletIndexData.data(), meshletIndexData.size(), mesh.mMeshletIndices.data(), header.mNumMeshletIndices));
+		}
+		header.mMeshletIndexOffset = dataOffset = Align(dataOffset);
+		header.mMeshletIndexBytes = meshletIndexData.size();
+		dataOffset += header.mMeshletIndexBytes;
+		header.mNumMeshlets = mesh.mMeshlets.size();
+		header.mMeshletOffset = dataOffset = Align(dataOffset);
+		dataOffset += sizeof(Mesh::Meshlet) * header.mNumMeshlets;
+
+		rawBytes += sizeof(MeshVert) * header.mNumVertices + sizeof(MeshIndex) * (header.mNumIndices + header.mNumLODIndices + header.mNumMeshletIndices);
+		encodedBytes += header.mVertexBytes + header.mIndexBytes + header.mLODIndexBytes + header.mMeshletIndexBytes;
+	}
+	std::vector<MaterialHeader> materialHeaders(numMaterials);
+	std::vector<const std::string*> paths(numMaterials * cNumMaterialImages, nullptr);
+	for(int i = 0; i < numMaterials; i++) {
+		const Mesh::MeshMaterialData& material = aMesh->mMaterials[i];
+		MaterialHeader& header = materialHeaders[i];
+		header.mColorFactor = material.mColorFactor;
+		header.mMetallicRoughness = material.mMetallicRoughness;
+		header.mAlphaCutoff = material.mAlphaCutoff;
+		header.mNormalBC5 = material.mNormalBC5;
+		const Image* images[cNumMaterialImages] = {material.mImage, material.mNormal, material.mMetallicRoughnessTexture};
+		for(int q = 0; q < cNumMaterialImages; q++) {
+			const std::string* path = images[q] ? &images[q]->GetFilePath() : nullptr;
+			header.mPathOffset[q] = dataOffset;
+			header.mPathLength[q] = path ? path->size() : 0;
+			dataOffset += header.mPathLength[q];
+			paths[i * cNumMaterialImages + q] = path;
+		}
+	}
+
+	std::vector<char> data(dataOffset);
+	Header* header = (Header*)data.data();
+	header->mMagic = cMagic;
+	header->mVersion = cVersion;
+	header->mVertexSize = sizeof(MeshVert);
+	header->mNumSubMeshes = numSubMeshes;
+	header->mNumMaterials = numMaterials;
+	header->mAABBMin = aMesh->mAABB.mMin;
+	header->mAABBMax = aMesh->mAABB.mMax;
+	memcpy(data.data() + sizeof(Header), subMeshHeaders.data(), sizeof(SubMeshHeader) * numSubMeshes);
+	memcpy(data.data() + sizeof(Header) + sizeof(SubMeshHeader) * numSubMeshes, materialHeaders.data(), sizeof(MaterialHeader) * numMaterials);
+	for(int i = 0; i < numSubMeshes; i++) {
+		memcpy(data.data() + subMeshHeaders[i].mVertexOffset, encodedVertices[i].data(), encodedVertices[i].size());
+		memcpy(data.data() + subMeshHeaders[i].mIndexOffset, encodedIndices[i].data(), encodedIndices[i].size());
+		memcpy(data.data() + subMeshHeaders[i].mLODIndexOffset, encodedLODIndices[i].data(), encodedLODIndices[i].size());
+		memcpy(data.data() + subMeshHeaders[i].mMeshletIndexOffset, encodedMeshletIndices[i].data(), encodedMeshletIndices[i].size());
+		memcpy(data.data() + subMeshHeaders[i].mMeshletOffset, aMesh->mMesh[i].mMeshlets.data(), sizeof(Mesh::Meshlet) * subMeshHeaders[i].mNumMeshlets);
+	}
+	for(int i = 0; i < numMaterials; i++) {
+		for(int q = 0; q < cNumMaterialImages; q++) {
+			if(paths[i * cNumMaterialImages + q]) {
+				memcpy(data.data() + materialHeaders[i].mPathOffset[q], paths[i * cNumMaterialImages + q]->data(), materialHeaders[i].mPathLength[q]);
+			}
+		}
+	}
+
+	if(FileIO::SaveFile(aCachePath, data.data(), data.size())) {
+		LOGGER::Formated("Wrote mesh cache {} ({} bytes, geometry {} -> {} bytes)\n", aCachePath, data.size(), rawBytes, encodedBytes);
+		RemoveStaleCaches(aCachePath);
+	}
+}
+
+bool MeshCacheLoader::Open(const std::string& aCachePath) {
+	ZoneScoped;
+	mFile = FileIO::MapFile(aCachePath);
+	if(mFile.mData == nullptr) {
+		return false;
+	}
+
+	//only the headers are read here, the data pages get touched when the work runs
+	const Header* header = (const Header*)mFile.mData;
+	if(!InFile(0, sizeof(Header)) || header->mMagic != cMagic || header->mVersion != cVersion || header->mVertexSize != sizeof(MeshVert)) {
+		LOGGER::Formated("Mesh cache {} is out of date\n", aCachePath);
+		FileIO::UnloadFile(mFile);
+		return false;
+	}
+	const uint64_t headersSize = sizeof(SubMeshHeader) * header->mNumSubMeshes + sizeof(MaterialHeader) * header->mNumMaterials;
+	bool valid = InFile(sizeof(Header), headersSize);
+	const SubMeshHeader* subMeshes = (const SubMeshHeader*)(header + 1);
+	for(uint32_t i = 0; valid && i < header->mNumSubMeshes; i++) {
+		valid = InFile(subMeshes[i].mVertexOffset, subMeshes[i].mVertexBytes) && InFile(subMeshes[i].mIndexOffset, subMeshes[i].mIndexBytes) &&
+				InFile(subMeshes[i].mLODIndexOffset, subMeshes[i].mLODIndexBytes) && subMeshes[i].mNumLODs <= Mesh::cMaxLODs &&
+				InFile(subMeshes[i].mMeshletIndexOffset, subMeshes[i].mMeshletIndexBytes) &&
+				InFile(subMeshes[i].mMeshletOffset, sizeof(Mesh::Meshlet) * (uint64_t)subMeshes[i].mNumMeshlets);
+	}
+	const MaterialHeader* materials = (const MaterialHeader*)(subMeshes + header->mNumSubMeshes);
+	for(uint32_t i = 0; valid && i < header->mNumMaterials; i++) {
+		for(int q = 0; valid && q < cNumMaterialImages; q++) {
+			valid = InFile(materials[i].mPathOffset[q], materials[i].mPathLength[q]);
+		}
+	}
+	if(!valid) {
+		LOGGER::Formated("Mesh cache {} is truncated\n", aCachePath);
+		FileIO::UnloadFile(mFile);
+		return false;
+	}
+	return true;
+}
+
+Job::Work MeshCacheLoader::GetWork(FileIO::Path aPath) {
+	ASSERT(mFile.mData != nullptr);
+	Job::Work work;
+	work.mWorkPtr = [this, aPath](void*) {
+		ZoneScoped;
+		ZoneText(aPath.String().c_str(), aPath.String().size());
+		const Header* header = (const Header*)mFile.mData;
+		const SubMeshHeader* subMeshes = (const SubMeshHeader*)(header + 1);
+		const MaterialHeader* materials = (const MaterialHeader*)(subMeshes + header->mNumSubMeshes);
+
+		mMesh->mAABB.mMin = header->mAABBMin;
+		mMesh->mAABB.mMax = header->mAABBMax;
+
+		mMesh->mMaterials.resize(header->mNumMaterials);
+		for(uint32_t i = 0; i < header->mNumMaterials; i++) {
+			const MaterialHeader& material = materials[i];
+			Mesh::MeshMaterialData& materialData = mMesh->mMaterials[i];
+			materialData.mColorFactor = material.mColorFactor;
+			materialData.mMetallicRoughness = material.mMetallicRoughness;
+			materialData.mAlphaCutoff = material.mAlphaCutoff;
+			materialData.mNormalBC5 = material.mNormalBC5;
+			Image** images[cNumMaterialImages] = {&materialData.mImage, &materialData.mNormal, &materialData.mMetallicRoughnessTexture};
+			for(int q = 0; q < cNumMaterialImages; q++) {
+				if(material.mPathLength[q] == 0) {
+					continue;
+				}
+				const std::string path(mFile.mData + material.mPathOffset[q], material.mPathLength[q]);
+				*images[q] = gGraphics->GetMaterialManager()->AcquireTexture(path, VK_FORMAT_UNDEFINED);
+			}
+		}
+
+		mMesh->mMesh.resize(header->mNumSubMeshes);
+		for(uint32_t i = 0; i < header->mNumSubMeshes; i++) {
+			const SubMeshHeader& subMesh = subMeshes[i];
+			Mesh::SubMesh& mesh = mMesh->mMesh[i];
+			mesh.mMatrix = subMesh.mMatrix;
+			mesh.mAABB.mMin = subMesh.mAABBMin;
+			mesh.mAABB.mMax = subMesh.mAABBMax;
+			mesh.mMaterialID = subMesh.mMaterialID;
+
+			const unsigned char* vertexData = (const unsigned char*)(mFile.mData + subMesh.mVertexOffset);
+			const unsigned char* indexData = (const unsigned char*)(mFile.mData + subMesh.mIndexOffset);
+			mesh.mVertices.resize(subMesh.mNumVertices);
+			mesh.mIndices.resize(subMesh.mNumIndices);
+			const int vertexResult = meshopt_decodeVertexBuffer(mesh.mVertices.data(), subMesh.mNumVertices, sizeof(MeshVert), vertexData, subMesh.mVertexBytes);
+			int indexResult = 0;
+			if(subMesh.mNumIndices % 3 == 0) {
+				indexResult = meshopt_decodeIndexBuffer(mesh.mIndices.data(), subMesh.mNumIndices, sizeof(MeshIndex), indexData, subMesh.mIndexBytes);
+			} else if(subMesh.mIndexBytes == sizeof(MeshIndex) * (uint64_t)subMesh.mNumIndices) {
+				memcpy(mesh.mIndices.data(), indexData, subMesh.mIndexBytes);
+			} else {
+				indexResult = -1;
+			}
+			mesh.mLODIndices.resize(subMesh.mNumLODIndices);
+			if(indexResult == 0 && subMesh.mNumLODIndices != 0) {
+				const unsigned char* lodIndexData = (const unsigned char*)(mFile.mData + subMesh.mLODIndexOffset);
+				indexResult = meshopt_decodeIndexBuffer(mesh.mLODIndices.data(), subMesh.mNumLODIndices, sizeof(MeshIndex), lodIndexData, subMesh.mLODIndexBytes);
+			}
+			mesh.mLODs.assign(subMesh.mLODs, subMesh.mLODs + subMesh.mNumLODs);
+			mesh.mMeshletIndices.resize(subMesh.mNumMeshletIndices);
+			if(indexResult == 0 && subMesh.mNumMeshletIndices != 0) {
+				const unsigned char* meshletIndexData = (const unsigned char*)(mFile.mData + subMesh.mMeshletIndexOffset);
+				indexResult = meshopt_decodeIndexBuffer(
+					mesh.mMeshletIndices.data(), subMesh.mNumMeshletIndices, sizeof(MeshIndex), meshletIndexData, subMesh.mMeshletIndexBytes);
+			}
+			const Mesh::Meshlet* meshlets = (const Mesh::Meshlet*)(mFile.mData + subMesh.mMeshletOffset);
+			mesh.mMeshlets.assign(meshlets, meshlets + subMesh.mNumMeshlets);
+			if(vertexResult != 0 || indexResult != 0) {
+				LOGGER::Formated("Mesh cache {} submesh {} failed to decode ({}, {})\n", aPath.String(), i, vertexResult, indexResult);
+				ASSERT(false);
+			}
+
+			Mesh::CreateBuffers(mesh);
+		}
+	};
+	work.mFinishPtr = [this](void*) {
+		FileIO::UnloadFile(mFile);
+	};
+	return work;
+}
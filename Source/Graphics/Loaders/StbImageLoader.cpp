@@ -1,27 +1,273 @@
 #include "StbImageLoader.h"
 
 #include <string>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 #include "PlatformDebug.h"
+#include "Engine/FileIO.h"
 #include "Graphics/Image.h"
+#include "Graphics/Helpers.h"
+
+bool gImageDecodeFromMappedFile = true;
+
+namespace {
+	//stb's allocations while an image is decoded on a loading thread are bump allocated from that thread's arena,
+	//the zlib/jpeg buffers reuse the same blocks for every image instead of going back to malloc each load.
+	//anything allocated outside of a decode (tinygltf also has stb_image) goes straight to malloc
+	struct ScratchArena {
+		struct Header {
+			size_t mSize;
+			//0 when it came from malloc
+			size_t mFromArena;
+		};
+		struct Block {
+			uint8_t* mData;
+			size_t mSize;
+			size_t mUsed;
+		};
+
+		//smallest block, big enough for most of stb's buffers on a 2k texture
+		static constexpr size_t cBlockSize = 16 * 1024 * 1024;
+		//blocks past this are freed after the decode, so one huge image doesn't hold memory on every thread
+		static constexpr size_t cMaxRetainedSize = 128 * 1024 * 1024;
+
+		~ScratchArena() {
+			for(int i = 0; i < mBlocks.size(); i++) {
+				free(mBlocks[i].mData);
+			}
+		}
+
+		//aTarget is handed out for the first allocation of exactly aTargetSize, stb's output for the decoded image
+		void Begin(void* aTarget, size_t aTargetSize) {
+			ASSERT(!mActive);
+			mActive = true;
+			mTarget = aTarget;
+			mTargetSize = aTargetSize;
+			mTargetUsed = false;
+		}
+		void End() {
+			ASSERT(mActive);
+			mActive = false;
+			mTarget = nullptr;
+			mLast = nullptr;
+
+			//keep one block big enough for everything this decode needed, so the next similar image fits in it
+			size_t used = 0;
+			for(int i = 0; i < mBlocks.size(); i++) {
+				used += mBlocks[i].mUsed;
+			}
+			if(mBlocks.size() > 1 || used > cMaxRetainedSize) {
+				for(int i = 0; i < mBlocks.size(); i++) {
+					free(mBlocks[i].mData);
+				}
+				mBlocks.clear();
+				if(used <= cMaxRetainedSize) {
+					AddBlock(used);
+				}
+			}
+			for(int i = 0; i < mBlocks.size(); i++) {
+				mBlocks[i].mUsed = 0;
+			}
+		}
+
+		void* Allocate(size_t aSize) {
+			if(mActive && mTarget && !mTargetUsed && aSize == mTargetSize) {
+				mTargetUsed = true;
+				return mTarget;
+			}
+			const size_t total = sizeof(Header) + AlignUp(aSize);
+			Header* header;
+			if(mActive) {
+				if(mBlocks.empty() || mBlocks.back().mUsed + total > mBlocks.back().mSize) {
+					AddBlock(total);
+				}
+				Block& block = mBlocks.back();
+				header = (Header*)(block.mData + block.mUsed);
+				block.mUsed += total;
+				mLast = header;
+			} else {
+				header = (Header*)malloc(total);
+				if(header == nullptr) {
+					return nullptr;
+				}
+			}
+			header->mSize = aSize;
+			header->mFromArena = mActive;
+			return header + 1;
+		}
+
+		void* Reallocate(void* aPtr, size_t aSize) {
+			if(aPtr == nullptr) {
+				return Allocate(aSize);
+			}
+			if(aPtr == mTarget) {
+				void* result = Allocate(aSize);
+				if(result) {
+					memcpy(result, aPtr, std::min(aSize, mTargetSize));
+				}
+				return result;
+			}
+			Header* header = (Header*)aPtr - 1;
+			if(!header->mFromArena) {
+				Header* result = (Header*)realloc(header, sizeof(Header) + AlignUp(aSize));
+				if(result == nullptr) {
+					return nullptr;
+				}
+				result->mSize = aSize;
+				return result + 1;
+			}
+			//zlib grows its output one allocation at a time, extend it in place when it's still the newest
+			Block& block = mBlocks.back();
+			if(header == mLast) {
+				const size_t start = (uint8_t*)header - block.mData;
+				const size_t total = sizeof(Header) + AlignUp(aSize);
+				if(start + total <= block.mSize) {
+					block.mUsed = start + total;
+					header->mSize = aSize;
+					return aPtr;
+				}
+			}
+			const size_t oldSize = header->mSize;
+			void* result = Allocate(aSize);
+			if(result) {
+				memcpy(result, aPtr, std::min(aSize, oldSize));
+			}
+			return result;
+		}
+
+		void Free(void* aPtr) {
+			if(aPtr == nullptr || aPtr == mTarget) {
+				return;
+			}
+			Header* header = (Header*)aPtr - 1;
+			//arena memory is only given back in End
+			if(!header->mFromArena) {
+				free(header);
+			}
+		}
+
+	private:
+		static size_t AlignUp(size_t aSize) {
+			return (aSize + 15) & ~(size_t)15;
+		}
+		void AddBlock(size_t aSize) {
+			const size_t size = std::max(aSize, cBlockSize);
+			mBlocks.push_back({(uint8_t*)malloc(size), size, 0});
+			ASSERT(mBlocks.back().mData != nullptr);
+		}
+
+		std::vector<Block> mBlocks;
+		Header* mLast = nullptr;
+		bool mActive = false;
+
+		void* mTarget = nullptr;
+		size_t mTargetSize = 0;
+		bool mTargetUsed = false;
+	};
+	thread_local ScratchArena tScratch;
+
+	void* ScratchMalloc(size_t aSize) {
+		return tScratch.Allocate(aSize);
+	}
+	void* ScratchRealloc(void* aPtr, size_t aSize) {
+		return tScratch.Reallocate(aPtr, aSize);
+	}
+	void ScratchFree(void* aPtr) {
+		tScratch.Free(aPtr);
+	}
+} // namespace
+
+#define STBI_MALLOC(sz)		   ScratchMalloc(sz)
+#define STBI_REALLOC(p, newsz) ScratchRealloc(p, newsz)
+#define STBI_FREE(p)		   ScratchFree(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
 
 Job::Work StbImageLoader::GetWork(FileIO::Path aPath) {
 	Job::Work work;
 	AsyncLoadData* imageData = new AsyncLoadData();
 	imageData->ptr = mImage;
+	imageData->mEncoded = std::move(mEncoded);
 
 	work.mUserData = imageData;
 	work.mWorkPtr = [aPath](void* userData) {
 		ZoneScoped;
 		ZoneText(aPath.String().c_str(), aPath.String().size());
 		AsyncLoadData* imageData = (AsyncLoadData*)userData;
-		//todo
-		imageData->mData = stbi_load(aPath.String().c_str(), &imageData->width, &imageData->height, &imageData->comp, STBI_rgb_alpha);
-		ASSERT(imageData->mData != nullptr);
-		//ASSERT(imageData->comp == 4);
+
+		FileIO::File file;
+		FILE* stdioFile = nullptr;
+		//the encoded file, from the mapping or already in memory
+		const stbi_uc* encoded = nullptr;
+		int encodedSize = 0;
+		if(!imageData->mEncoded.empty()) {
+			encoded = imageData->mEncoded.data();
+			encodedSize = (int)imageData->mEncoded.size();
+		} else if(gImageDecodeFromMappedFile) {
+			file = FileIO::MapFile(aPath);
+			encoded = (const stbi_uc*)file.mData;
+			encodedSize = (int)file.mSize;
+		} else {
+			stdioFile = fopen(aPath.String().c_str(), "rb");
+		}
+		if(encoded == nullptr && stdioFile == nullptr) {
+			LOGGER::Formated("Failed to open image {}\n", aPath.String());
+			ASSERT(false);
+			return;
+		}
+		const auto Info = [&](int* aWidth, int* aHeight, int* aComp) {
+			if(stdioFile) {
+				//leaves the file where it was
+				return stbi_info_from_file(stdioFile, aWidth, aHeight, aComp);
+			}
+			return stbi_info_from_memory(encoded, encodedSize, aWidth, aHeight, aComp);
+		};
+		const auto Load = [&]() {
+			if(stdioFile) {
+				return stbi_load_from_file(stdioFile, &imageData->width, &imageData->height, &imageData->comp, STBI_rgb_alpha);
+			}
+			return stbi_load_from_memory(encoded, encodedSize, &imageData->width, &imageData->height, &imageData->comp, STBI_rgb_alpha);
+		};
+
+		stbi_uc* pixels = nullptr;
+		int width, height, comp;
+		if(Info(&width, &height, &comp)) {
+			//always rgba, most devices can't sample VK_FORMAT_R8G8B8_UNORM
+			const size_t size = (size_t)width * height * STBI_rgb_alpha;
+			imageData->mStaging.Create(BufferType::STAGING, size, aPath.String().c_str());
+			void* staging = imageData->mStaging.Map();
+
+			//stb's output goes straight into the staging buffer when it's only written to,
+			//png unfiltering reads the previous row back so that only decodes in place if the memory is cached
+			const bool rereadsOutput = str_tolower(aPath.Extension()) == ".png";
+			const bool decodeInPlace = !rereadsOutput || imageData->mStaging.IsHostCached();
+
+			tScratch.Begin(decodeInPlace ? staging : nullptr, size);
+			pixels = Load();
+			if(pixels && pixels != staging) {
+				ZoneScopedN("Copy to staging");
+				memcpy(staging, pixels, size);
+			}
+			stbi_image_free(pixels);
+			tScratch.End();
+
+			imageData->mStaging.UnMap();
+		}
+		if(stdioFile) {
+			fclose(stdioFile);
+		}
+		FileIO::UnloadFile(file);
+		imageData->mEncoded = std::vector<uint8_t>();
+
+		if(pixels == nullptr) {
+			LOGGER::Formated("Failed to decode image {}, {}\n", aPath.String(), stbi_failure_reason());
+			ASSERT(false);
+			return;
+		}
+		imageData->mDecoded = true;
 		ZoneValue(imageData->width);
 		ZoneValue(imageData->height);
 	};
@@ -29,8 +275,15 @@ Job::Work StbImageLoader::GetWork(FileIO::Path aPath) {
 	work.mFinishPtr = [=](void* userData) {
 		ZoneScoped;
 		AsyncLoadData* imageData = (AsyncLoadData*)userData;
-		imageData->ptr->CreateFromData(imageData->mData, imageData->ptr->mFormat, {imageData->width, imageData->height}, aPath.String().c_str());
-		stbi_image_free(imageData->mData);
+		if(imageData->mDecoded) {
+			//the image takes the staging buffer and destroys it once the copy is done, the rest of the mips are blitted from it
+			const ImageSize size = {imageData->width, imageData->height};
+			imageData->ptr->SetMipLevels(Image::GetFullMipLevels(size));
+			imageData->ptr->CreateFromBuffer(imageData->mStaging, true, imageData->ptr->mFormat, size, aPath.String().c_str(), true);
+		} else {
+			imageData->mStaging.Destroy();
+		}
+		delete imageData;
 	};
 	return work;
-}
\ No newline at end of file
+}
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <vector>
+
 #include <vulkan/vulkan.h>
 
 #include "LoaderBase.h"
+#include "Graphics/Buffer.h"
 
 class Image;
 
+//decodes the file from a read only mapping instead of reading it through stdio
+extern bool gImageDecodeFromMappedFile;
+
 class StbImageLoader : public LoaderBase {
 private:
 	struct AsyncLoadData {
-		unsigned char* mData;
+		//decoded rgba pixels, filled and unmapped on the loading thread
+		Buffer mStaging;
+		bool mDecoded = false;
+		//the file when it was given to SetEncodedData
+		std::vector<uint8_t> mEncoded;
 		int width, height, comp;
 		Image* ptr;
 		VkFormat format;
@@ -18,5 +28,11 @@ private:
 public:
 	virtual Job::Work GetWork(FileIO::Path aPath) override;
 
+	//decodes aEncoded (a whole png/jpg file) instead of reading aPath, which is then only used to name the image
+	void SetEncodedData(std::vector<uint8_t> aEncoded) {
+		mEncoded = std::move(aEncoded);
+	}
+
 private:
+	std::vector<uint8_t> mEncoded;
 };
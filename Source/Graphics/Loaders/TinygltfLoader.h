@@ -1,31 +1,84 @@
 #pragma once
 
 #include <string>
+#include <filesystem>
 
 #include "Mesh/tinygltf/tiny_gltf.h"
 
 #include "LoaderBase.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/VertexConvert.h"
+#include "Graphics/Graphics.h"
+#include "Graphics/MaterialManager.h"
 #include "PlatformDebug.h"
 #include "Engine/Transform.h"
 
+//.gltf and .glb files
+//the source file and any external .bin files are memory mapped and accessors are converted straight out of the mapping
+//tinygltf only gets the json, with each buffer swapped for a 1 byte stand in so it doesn't read/copy them itself
 class TinygltfLoader : public LoaderBase {
 private:
+	//a gltf buffer's bytes, either in a mapped file or (for data uri's) tinygltf's own copy
+	struct MappedBuffer {
+		const unsigned char* mData = nullptr;
+		size_t mSize = 0;
+	};
+	//an image stored in a buffer view rather than its own file
+	struct EmbeddedImage {
+		int mBufferView = -1;
+		//from the mime type, so the decoder can tell png from jpg
+		std::string mExtension;
+		//the encoded file, in one of the buffers
+		MappedBuffer mData;
+	};
 	struct AsyncLoadData {
+		~AsyncLoadData() {
+			FileIO::UnloadFile(file);
+			for(FileIO::File& external: externalFiles) {
+				FileIO::UnloadFile(external);
+			}
+		}
 		tinygltf::Model model;
 		tinygltf::TinyGLTF loader;
+		FileIO::File file;
+		std::vector<FileIO::File> externalFiles;
+		std::vector<MappedBuffer> buffers;
+		//one per image, mData is null for images loaded from a uri
+		std::vector<EmbeddedImage> images;
+		bool loaded = false;
 	};
 
 public:
 	virtual Job::Work GetWork(FileIO::Path aPath) override;
 
 private:
-	void ProcessMaterials(tinygltf::Model& aModel);
-	void ProcessModel(tinygltf::Model& aModel);
-	void ProcessScene(tinygltf::Model& aModel, tinygltf::Scene& aScene);
-	void ProcessNode(tinygltf::Model& aModel, tinygltf::Node& aNode, const glm::mat4& aMatrix);
-	void ProcessMesh(tinygltf::Model& aModel, tinygltf::Mesh& aMesh);
-	void ProcessPrimitive(tinygltf::Model& aModel, tinygltf::Primitive& aPrimitive);
+	//fills in aData.buffers and gives tinygltf the json with the buffers replaced
+	static bool LoadFile(AsyncLoadData& aData, const FileIO::Path& aPath);
+	//start of aAccessor's first element and the distance between elements
+	const unsigned char* GetAccessorData(const tinygltf::Model& aModel, const tinygltf::Accessor& aAccessor, int& aStride) const;
+	//aNormalized treats integer data as normalized even if the accessor doesn't say so
+	VertexConvert::Stream GetAccessorStream(const tinygltf::Model& aModel, const tinygltf::Accessor& aAccessor, bool aNormalized = false) const;
+
+	//a primitive found by the node walk and the node matrix it's drawn with
+	struct PrimitiveInstance {
+		const tinygltf::Primitive* mPrimitive;
+		glm::mat4 mMatrix;
+	};
+
+	//images in buffer views are cached under aPath, so other meshes using the same file share them
+	void ProcessMaterials(tinygltf::Model& aModel, const FileIO::Path& aPath);
+	//false if any primitive failed, the mesh is left empty
+	bool ProcessModel(tinygltf::Model& aModel);
+	void ProcessScene(tinygltf::Model& aModel, tinygltf::Scene& aScene, std::vector<PrimitiveInstance>& aPrimitives);
+	void ProcessNode(tinygltf::Model& aModel, tinygltf::Node& aNode, const glm::mat4& aMatrix, std::vector<PrimitiveInstance>& aPrimitives);
+	void ProcessMesh(tinygltf::Model& aModel, tinygltf::Mesh& aMesh, const glm::mat4& aMatrix, std::vector<PrimitiveInstance>& aPrimitives);
+	//thread safe, only writes to aMesh and aStats
+	//false if an accessor is missing or reads outside its buffer
+	bool ProcessPrimitive(const tinygltf::Model& aModel, const tinygltf::Primitive& aPrimitive, Mesh::SubMesh& aMesh, Mesh::OptimizeStats& aStats) const;
+
+	//only valid while the finish is processing the model
+	std::vector<MappedBuffer> mBuffers;
+	std::vector<EmbeddedImage> mEmbeddedImages;
 };
 
 Job::Work TinygltfLoader::GetWork(FileIO::Path aPath) {
@@ -36,33 +89,241 @@ Job::Work TinygltfLoader::GetWork(FileIO::Path aPath) {
 		ZoneScoped;
 		ZoneText(aPath.String().c_str(), aPath.String().size());
 		AsyncLoadData* asyncData = (AsyncLoadData*)data;
-		std::string err;
-		std::string warn;
-
-		asyncData->loader.SetStoreOriginalJSONForExtrasAndExtensions(true);
-
-		asyncData->loader.LoadASCIIFromFile(&asyncData->model, &err, &warn, aPath.String());
-
-		if(!err.empty()) {
-			LOGGER::Formated("gltf Load error {}\n\t{}", aPath.String(), err);
-		}
-		if(!warn.empty()) {
-			LOGGER::Formated("gltf Load warnings {}\n\t{}", aPath.String(), warn);
-		}
+		asyncData->loaded = LoadFile(*asyncData, aPath);
 	};
-	work.mFinishPtr = [this](void* data) {
+	work.mFinishPtr = [this, aPath](void* data) {
 		ZoneScoped;
 		AsyncLoadData* asyncData = (AsyncLoadData*)data;
 
-		ProcessMaterials(asyncData->model);
-		ProcessModel(asyncData->model);
+		if(asyncData->loaded) {
+			mBuffers = asyncData->buffers;
+			mEmbeddedImages = asyncData->images;
+			//queues the image loads first so they decode while the primitives are converted
+			ProcessMaterials(asyncData->model, aPath);
+			if(!ProcessModel(asyncData->model)) {
+				LOGGER::Formated("gltf Load error {}\n\tinvalid accessor data, the model was dropped\n", aPath.String());
+			}
+			mBuffers.clear();
+			mEmbeddedImages.clear();
+		}
 		delete asyncData;
 	};
 
 	return work;
 }
 
-void TinygltfLoader::ProcessMaterials(tinygltf::Model& aModel) {
+//static
+bool TinygltfLoader::LoadFile(AsyncLoadData& aData, const FileIO::Path& aPath) {
+	ZoneScoped;
+	aData.file = FileIO::MapFile(aPath);
+	if(aData.file.mData == nullptr) {
+		LOGGER::Formated("gltf Load error {}\n\tcan't open file\n", aPath.String());
+		return false;
+	}
+	const unsigned char* fileData = (const unsigned char*)aData.file.mData;
+	const size_t fileSize = aData.file.mSize;
+
+	//https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout
+	static const uint32_t cGlbMagic = 0x46546C67; //glTF
+	static const uint32_t cGlbChunkJson = 0x4E4F534A; //JSON
+	static const uint32_t cGlbChunkBin = 0x004E4942; //BIN
+	const char* jsonStart = aData.file.mData;
+	size_t jsonSize = fileSize;
+	MappedBuffer binChunk;
+	uint32_t magic = 0;
+	if(fileSize >= 12) {
+		memcpy(&magic, fileData, sizeof(uint32_t));
+	}
+	if(magic == cGlbMagic) {
+		//header is magic, version, length. then chunks of length, type, data
+		uint32_t header[5];
+		if(fileSize < sizeof(header)) {
+			LOGGER::Formated("gltf Load error {}\n\ttruncated glb header\n", aPath.String());
+			return false;
+		}
+		memcpy(header, fileData, sizeof(header));
+		if(header[1] != 2 || header[2] > fileSize || header[4] != cGlbChunkJson || sizeof(header) + (size_t)header[3] > header[2]) {
+			LOGGER::Formated("gltf Load error {}\n\tinvalid glb header\n", aPath.String());
+			return false;
+		}
+		jsonStart = aData.file.mData + sizeof(header);
+		jsonSize = header[3];
+		//optional BIN chunk straight after the json, chunks are 4 byte aligned
+		const size_t binHeaderOffset = sizeof(header) + jsonSize;
+		if(binHeaderOffset + 8 <= header[2]) {
+			uint32_t chunk[2];
+			memcpy(chunk, fileData + binHeaderOffset, sizeof(chunk));
+			if(chunk[1] == cGlbChunkBin && binHeaderOffset + 8 + (size_t)chunk[0] <= header[2]) {
+				binChunk.mData = fileData + binHeaderOffset + 8;
+				binChunk.mSize = chunk[0];
+			}
+		}
+	}
+
+	nlohmann::json json = nlohmann::json::parse(jsonStart, jsonStart + jsonSize, nullptr, false);
+	if(json.is_discarded() || !json.is_object()) {
+		LOGGER::Formated("gltf Load error {}\n\tinvalid json\n", aPath.String());
+		return false;
+	}
+
+	const std::filesystem::path baseDir = std::filesystem::path(aPath.String()).parent_path();
+	std::vector<bool> dataUri;
+	if(json.contains("buffers") && json["buffers"].is_array()) {
+		nlohmann::json& buffers = json["buffers"];
+		aData.buffers.resize(buffers.size());
+		dataUri.resize(buffers.size(), false);
+		for(size_t i = 0; i < buffers.size(); i++) {
+			nlohmann::json& buffer = buffers[i];
+			const size_t byteLength = buffer.value("byteLength", (size_t)0);
+			const std::string uri = buffer.value("uri", std::string());
+			MappedBuffer& mapped = aData.buffers[i];
+			if(uri.empty()) {
+				//the glb's own BIN chunk
+				mapped = binChunk;
+			} else if(uri.rfind("data:", 0) == 0) {
+				//embedded base64, tinygltf has to decode it anyway
+				dataUri[i] = true;
+				continue;
+			} else {
+				FileIO::File external = FileIO::MapFile((baseDir / uri).generic_string());
+				mapped.mData = (const unsigned char*)external.mData;
+				mapped.mSize = external.mSize;
+				aData.externalFiles.push_back(external);
+			}
+			if(mapped.mData == nullptr || mapped.mSize < byteLength) {
+				LOGGER::Formated("gltf Load error {}\n\tbuffer {} ({}) is missing or smaller than {} bytes\n", aPath.String(), i, uri, byteLength);
+				return false;
+			}
+			buffer = {{"byteLength", 1}, {"uri", "data:application/octet-stream;base64,AA=="}};
+		}
+	}
+	//images in buffer views would be read from the stand in buffers, they're found in the mapped buffers after the load instead
+	if(json.contains("images") && json["images"].is_array()) {
+		nlohmann::json& images = json["images"];
+		aData.images.resize(images.size());
+		for(size_t i = 0; i < images.size(); i++) {
+			nlohmann::json& image = images[i];
+			if(image.contains("bufferView")) {
+				EmbeddedImage& embedded = aData.images[i];
+				embedded.mBufferView = image.value("bufferView", -1);
+				const std::string mimeType = image.value("mimeType", std::string());
+				embedded.mExtension = mimeType == "image/jpeg" ? ".jpg" : ".png";
+				image.erase("bufferView");
+				image.erase("mimeType");
+				image["uri"] = "";
+			}
+		}
+	}
+	const std::string jsonString = json.dump();
+
+	std::string err;
+	std::string warn;
+	aData.loader.SetStoreOriginalJSONForExtrasAndExtensions(true);
+	const bool result = aData.loader.LoadASCIIFromString(&aData.model, &err, &warn, jsonString.c_str(), (unsigned int)jsonString.size(), baseDir.generic_string());
+
+	if(!err.empty()) {
+		LOGGER::Formated("gltf Load error {}\n\t{}", aPath.String(), err);
+	}
+	if(!warn.empty()) {
+		LOGGER::Formated("gltf Load warnings {}\n\t{}", aPath.String(), warn);
+	}
+	if(!result) {
+		return false;
+	}
+	for(size_t i = 0; i < dataUri.size(); i++) {
+		if(dataUri[i]) {
+			aData.buffers[i].mData = aData.model.buffers[i].data.data();
+			aData.buffers[i].mSize = aData.model.buffers[i].data.size();
+		}
+	}
+	//a bad view only loses that image, the model can still load
+	for(size_t i = 0; i < aData.images.size(); i++) {
+		EmbeddedImage& embedded = aData.images[i];
+		if(embedded.mBufferView == -1) {
+			continue;
+		}
+		if(embedded.mBufferView < 0 || embedded.mBufferView >= aData.model.bufferViews.size()) {
+			LOGGER::Formated("gltf Load warnings {}\n\timage {} has an invalid buffer view {}\n", aPath.String(), i, embedded.mBufferView);
+			continue;
+		}
+		const tinygltf::BufferView& view = aData.model.bufferViews[embedded.mBufferView];
+		if(view.buffer < 0 || view.buffer >= aData.buffers.size() || aData.buffers[view.buffer].mData == nullptr ||
+		   view.byteOffset + view.byteLength > aData.buffers[view.buffer].mSize) {
+			LOGGER::Formated("gltf Load warnings {}\n\timage {} is outside of its buffer\n", aPath.String(), i);
+			continue;
+		}
+		embedded.mData.mData = aData.buffers[view.buffer].mData + view.byteOffset;
+		embedded.mData.mSize = view.byteLength;
+	}
+	return true;
+}
+
+const unsigned char* TinygltfLoader::GetAccessorData(const tinygltf::Model& aModel, const tinygltf::Accessor& aAccessor, int& aStride) const {
+	//sparse accessors without a buffer view aren't supported
+	if(aAccessor.bufferView < 0 || aAccessor.bufferView >= aModel.bufferViews.size()) {
+		LOGGER::Formated("gltf accessor {} has no valid buffer view\n", aAccessor.name);
+		return nullptr;
+	}
+	const tinygltf::BufferView& view = aModel.bufferViews[aAccessor.bufferView];
+	if(view.buffer < 0 || view.buffer >= mBuffers.size() || mBuffers[view.buffer].mData == nullptr) {
+		LOGGER::Formated("gltf accessor {} has no valid buffer\n", aAccessor.name);
+		return nullptr;
+	}
+	const MappedBuffer& buffer = mBuffers[view.buffer];
+	aStride = aAccessor.ByteStride(view);
+	const int componentSize = tinygltf::GetComponentSizeInBytes(aAccessor.componentType);
+	const int numComponents = tinygltf::GetNumComponentsInType(aAccessor.type);
+	if(aStride <= 0 || componentSize <= 0 || numComponents <= 0) {
+		LOGGER::Formated("gltf accessor {} has an invalid type or stride\n", aAccessor.name);
+		return nullptr;
+	}
+	const size_t elementSize = (size_t)componentSize * numComponents;
+	const size_t start = aAccessor.byteOffset + view.byteOffset;
+	//the last element only needs to fit its own size, not the full stride
+	const size_t end = aAccessor.count == 0 ? start : start + (aAccessor.count - 1) * (size_t)aStride + elementSize;
+	if(view.byteOffset + view.byteLength > buffer.mSize || end > view.byteOffset + view.byteLength) {
+		LOGGER::Formated("gltf accessor {} reads past the end of its buffer view ({} > {})\n", aAccessor.name, end, view.byteOffset + view.byteLength);
+		return nullptr;
+	}
+	return buffer.mData + start;
+}
+
+VertexConvert::Stream TinygltfLoader::GetAccessorStream(const tinygltf::Model& aModel, const tinygltf::Accessor& aAccessor, bool aNormalized) const {
+	VertexConvert::Stream stream;
+	int stride = 0;
+	stream.mData = GetAccessorData(aModel, aAccessor, stride);
+	if(stream.mData == nullptr) {
+		return stream;
+	}
+	stream.mStride = stride;
+	stream.mComponents = tinygltf::GetNumComponentsInType(aAccessor.type);
+	const bool normalized = aAccessor.normalized || aNormalized;
+	switch(aAccessor.componentType) {
+		case TINYGLTF_COMPONENT_TYPE_FLOAT:
+			stream.mFormat = VertexConvert::Format::FLOAT;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			stream.mFormat = normalized ? VertexConvert::Format::UNORM8 : VertexConvert::Format::UINT8;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			stream.mFormat = normalized ? VertexConvert::Format::UNORM16 : VertexConvert::Format::UINT16;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			stream.mFormat = normalized ? VertexConvert::Format::SNORM8 : VertexConvert::Format::SINT8;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			stream.mFormat = normalized ? VertexConvert::Format::SNORM16 : VertexConvert::Format::SINT16;
+			break;
+		default:
+			//32 bit ints aren't valid for vertex attributes
+			LOGGER::Formated("gltf accessor {} has an unsupported component type {}\n", aAccessor.name, aAccessor.componentType);
+			stream.mData = nullptr;
+			break;
+	}
+	return stream;
+}
+
+void TinygltfLoader::ProcessMaterials(tinygltf::Model& aModel, const FileIO::Path& aPath) {
 	ZoneScoped;
 	const size_t numMaterials = aModel.materials.size();
 	mMesh->mMaterials.resize(numMaterials);
@@ -70,23 +331,34 @@ void TinygltfLoader::ProcessMaterials(tinygltf::Model& aModel) {
 		ZoneScoped;
 		Mesh::MeshMaterialData& materialData = mMesh->mMaterials[i];
 		tinygltf::Material& mat = aModel.materials[i];
-		auto SetLoadTexture = [&](tinygltf::Image& aTinyImagePath, Image** aOutputImage) {
-			LOGGER::Formated("Loading Texture {}\n", aTinyImagePath.uri);
-			Image* image = new Image();
-			image->LoadImage(mMesh->mImagePath + aTinyImagePath.uri, VK_FORMAT_UNDEFINED);
-			*aOutputImage = image;
+		auto SetLoadTexture = [&](int aImageIndex, Image** aOutputImage) {
+			tinygltf::Image& tinyImage = aModel.images[aImageIndex];
+			if(aImageIndex < mEmbeddedImages.size() && mEmbeddedImages[aImageIndex].mData.mData) {
+				//decoded from the mapped buffer, the cache copies it so it doesn't need to outlive the finish
+				const EmbeddedImage& embedded = mEmbeddedImages[aImageIndex];
+				const std::string name = aPath.String() + "#image" + std::to_string(aImageIndex) + embedded.mExtension;
+				LOGGER::Formated("Loading Texture {}\n", name);
+				*aOutputImage = gGraphics->GetMaterialManager()->AcquireTexture(name, embedded.mData.mData, embedded.mData.mSize, VK_FORMAT_UNDEFINED);
+				return;
+			}
+			if(tinyImage.uri.empty()) {
+				LOGGER::Formated("Skipping Texture {}, it has no uri or valid buffer view\n", tinyImage.name);
+				return;
+			}
+			LOGGER::Formated("Loading Texture {}\n", tinyImage.uri);
+			*aOutputImage = gGraphics->GetMaterialManager()->AcquireTexture(mMesh->mImagePath + tinyImage.uri, VK_FORMAT_UNDEFINED);
 		};
 		if(mat.pbrMetallicRoughness.baseColorTexture.index != -1) {
 			tinygltf::Texture& baseTexture = aModel.textures[mat.pbrMetallicRoughness.baseColorTexture.index];
-			SetLoadTexture(aModel.images[baseTexture.source], &materialData.mImage);
+			SetLoadTexture(baseTexture.source, &materialData.mImage);
 		}
 		if(mat.pbrMetallicRoughness.metallicRoughnessTexture.index != -1) {
 			tinygltf::Texture& baseTexture = aModel.textures[mat.pbrMetallicRoughness.metallicRoughnessTexture.index];
-			SetLoadTexture(aModel.images[baseTexture.source], &materialData.mMetallicRoughnessTexture);
+			SetLoadTexture(baseTexture.source, &materialData.mMetallicRoughnessTexture);
 		}
 		if(mat.normalTexture.index != -1) {
 			tinygltf::Texture& baseTexture = aModel.textures[mat.normalTexture.index];
-			SetLoadTexture(aModel.images[baseTexture.source], &materialData.mNormal);
+			SetLoadTexture(baseTexture.source, &materialData.mNormal);
 		}
 		for(int i = 0; i < mat.pbrMetallicRoughness.baseColorFactor.size(); i++) {
 			materialData.mColorFactor[i] = mat.pbrMetallicRoughness.baseColorFactor[i];
@@ -97,7 +369,7 @@ void TinygltfLoader::ProcessMaterials(tinygltf::Model& aModel) {
 	}
 }
 
-void TinygltfLoader::ProcessModel(tinygltf::Model& aModel) {
+bool TinygltfLoader::ProcessModel(tinygltf::Model& aModel) {
 	ZoneScoped;
 	//const size_t numScenes = aModel.scenes.size();
 	//for(size_t i = 0; i < numScenes; i++) {
@@ -105,15 +377,60 @@ void TinygltfLoader::ProcessModel(tinygltf::Model& aModel) {
 	//}
 	ASSERT(aModel.scenes.size() == 1);
 	ASSERT(aModel.defaultScene == 0);
-	ProcessScene(aModel, aModel.scenes[aModel.defaultScene]);
+	std::vector<PrimitiveInstance> primitives;
+	ProcessScene(aModel, aModel.scenes[aModel.defaultScene], primitives);
+
+	//each primitive converts into its own submesh slot, so the jobs don't need to lock anything
+	const size_t numPrimitives = primitives.size();
+	mMesh->mMesh.resize(numPrimitives);
+	std::vector<Mesh::OptimizeStats> stats(numPrimitives);
+	//not a vector<bool>, each job writes its own element
+	std::vector<uint8_t> succeeded(numPrimitives, 0);
+	auto ProcessInstance = [this, &aModel, &primitives, &stats, &succeeded](size_t aIndex) {
+		const PrimitiveInstance& instance = primitives[aIndex];
+		Mesh::SubMesh& mesh = mMesh->mMesh[aIndex];
+		mesh.mMatrix = instance.mMatrix;
+		succeeded[aIndex] = ProcessPrimitive(aModel, *instance.mPrimitive, mesh, stats[aIndex]);
+	};
+
+	//queued behind the image loads from ProcessMaterials so workers pick those up first
+	//this thread takes the first primitive, and any still queued when it waits on them
+	std::vector<Job::Work> work(numPrimitives > 0 ? numPrimitives - 1 : 0);
+	for(size_t i = 0; i < work.size(); i++) {
+		work[i].mWorkPtr = [ProcessInstance, i](void*) {
+			ProcessInstance(i + 1);
+		};
+	}
+	std::vector<Job::WorkHandle*> handles = Job::QueueWorkHandle(work);
+	if(numPrimitives > 0) {
+		ProcessInstance(0);
+	}
+	for(int i = 0; i < handles.size(); i++) {
+		Job::WaitForWork(handles[i]);
+		handles[i]->Reset();
+	}
+	//a partial model would draw with holes in it, drop all of it
+	for(size_t i = 0; i < numPrimitives; i++) {
+		if(!succeeded[i]) {
+			for(Mesh::SubMesh& mesh: mMesh->mMesh) {
+				gGraphics->GetGeometryArena()->Free(mesh.mGeometry);
+			}
+			mMesh->mMesh.clear();
+			return false;
+		}
+	}
+	for(size_t i = 0; i < numPrimitives; i++) {
+		mMesh->mOptimizeStats += stats[i];
+	}
+	return true;
 }
-void TinygltfLoader::ProcessScene(tinygltf::Model& aModel, tinygltf::Scene& aScene) {
+void TinygltfLoader::ProcessScene(tinygltf::Model& aModel, tinygltf::Scene& aScene, std::vector<PrimitiveInstance>& aPrimitives) {
 	const int numNodes = aScene.nodes.size();
 	for(size_t i = 0; i < numNodes; i++) {
-		ProcessNode(aModel, aModel.nodes[aScene.nodes[i]], glm::mat4(1));
+		ProcessNode(aModel, aModel.nodes[aScene.nodes[i]], glm::mat4(1), aPrimitives);
 	}
 }
-void TinygltfLoader::ProcessNode(tinygltf::Model& aModel, tinygltf::Node& aNode, const glm::mat4& aMatrix) {
+void TinygltfLoader::ProcessNode(tinygltf::Model& aModel, tinygltf::Node& aNode, const glm::mat4& aMatrix, std::vector<PrimitiveInstance>& aPrimitives) {
 
 	//also contains position information here
 	SimpleTransform nodeTransform;
@@ -146,33 +463,29 @@ void TinygltfLoader::ProcessNode(tinygltf::Model& aModel, tinygltf::Node& aNode,
 	const int numChildren = aNode.children.size();
 	if(numChildren != 0) {
 		for(size_t i = 0; i < numChildren; i++) {
-			ProcessNode(aModel, aModel.nodes[aNode.children[i]], nodeMatrix);
+			ProcessNode(aModel, aModel.nodes[aNode.children[i]], nodeMatrix, aPrimitives);
 		}
 	}
 	if(aNode.mesh == -1) {
 		return;
 	}
-	const int numMeshBefore = mMesh->mMesh.size();
-	ProcessMesh(aModel, aModel.meshes[aNode.mesh]);
-	const int numMeshs = mMesh->mMesh.size();
-	for(size_t i = numMeshBefore; i < numMeshs; i++) {
-		mMesh->mMesh[i].mMatrix = nodeMatrix;
-		//mMesh->mMesh[i].mTransform.SetMatrix(nodeMatrix);
-	}
+	ProcessMesh(aModel, aModel.meshes[aNode.mesh], nodeMatrix, aPrimitives);
 }
-void TinygltfLoader::ProcessMesh(tinygltf::Model& aModel, tinygltf::Mesh& aMesh) {
+void TinygltfLoader::ProcessMesh(tinygltf::Model& aModel, tinygltf::Mesh& aMesh, const glm::mat4& aMatrix, std::vector<PrimitiveInstance>& aPrimitives) {
 	const int numPrimitives = aMesh.primitives.size();
 	for(size_t i = 0; i < numPrimitives; i++) {
-		ProcessPrimitive(aModel, aMesh.primitives[i]);
+		aPrimitives.push_back({&aMesh.primitives[i], aMatrix});
 	}
 }
-void TinygltfLoader::ProcessPrimitive(tinygltf::Model& aModel, tinygltf::Primitive& aPrimitive) {
+bool TinygltfLoader::ProcessPrimitive(const tinygltf::Model& aModel,
+									  const tinygltf::Primitive& aPrimitive,
+									  Mesh::SubMesh& aMesh,
+									  Mesh::OptimizeStats& aStats) const {
 	ZoneScoped;
 
 	ASSERT(aPrimitive.mode == TINYGLTF_MODE_TRIANGLES);
 
-	mMesh->mMesh.push_back(Mesh::SubMesh());
-	Mesh::SubMesh& mesh = mMesh->mMesh.back();
+	Mesh::SubMesh& mesh = aMesh;
 	std::vector<MeshVert>& vertices = mesh.mVertices;
 	std::vector<MeshIndex>& indices = mesh.mIndices;
 
@@ -181,158 +494,113 @@ void TinygltfLoader::ProcessPrimitive(tinygltf::Model& aModel, tinygltf::Primiti
 		if(vertCount == -1) {
 			vertices.resize(count);
 			vertCount = count;
-			return;
+			return true;
 		}
-		ASSERT(vertCount == count);
+		return vertCount == count;
 	};
+	//cleared by any attribute that can't be read, the rest are skipped
+	bool valid = true;
 
 	mesh.mMaterialID = aPrimitive.material;
 
 	//vertex
 	//POSITION, NORMAL, TANGENT, TEXCOORD_n, COLOR_n, JOINTS_n
 	//https://www.khronos.org/registry/glTF/specs/2.0/glTF-2.0.html#meshes
-	if(aPrimitive.attributes.contains("POSITION")) {
-		const tinygltf::Accessor& accessor = aModel.accessors[aPrimitive.attributes["POSITION"]];
-		const tinygltf::BufferView& view = aModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = aModel.buffers[view.buffer];
-		const unsigned char* datastart = &buffer.data[accessor.byteOffset + view.byteOffset];
-		const int dataSize =
-			accessor.ByteStride(view); //tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
-		const int count = accessor.count;
-
-		ASSERT(accessor.type == TINYGLTF_TYPE_VEC3 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-		SetOrValidateVertCount(count);
-
-		if(accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
-			mesh.mAABB.mMin = glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]);
-			mesh.mAABB.mMax = glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]);
+	//each attribute is converted straight into its MeshVert member, aNumComponents of it are written
+	//aMember is the member in a dummy vertex, as vertices is only sized once the first attribute is found
+	MeshVert layout;
+	auto ConvertAttribute = [&](const char* aName, float* aMember, uint32_t aNumComponents, bool aNormalized = false) -> const tinygltf::Accessor* {
+		if(!valid || !aPrimitive.attributes.contains(aName)) {
+			return nullptr;
 		}
-
-		for(int i = 0; i < count; i++) {
-			glm::vec3 data = glm::vec3(0);
-			memcpy(&data, datastart + (dataSize * i), dataSize * sizeof(char));
-			vertices[i].mPos = data;
+		const int accessorIndex = aPrimitive.attributes.at(aName);
+		if(accessorIndex < 0 || accessorIndex >= aModel.accessors.size()) {
+			LOGGER::Formated("gltf attribute {} has an invalid accessor {}\n", aName, accessorIndex);
+			valid = false;
+			return nullptr;
 		}
-	}
-	if(aPrimitive.attributes.contains("NORMAL")) {
-		const tinygltf::Accessor& accessor = aModel.accessors[aPrimitive.attributes["NORMAL"]];
-		const tinygltf::BufferView& view = aModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = aModel.buffers[view.buffer];
-		const unsigned char* datastart = &buffer.data[accessor.byteOffset + view.byteOffset];
-		const int dataSize =
-			accessor.ByteStride(view); //tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
-		const int count = accessor.count;
-
-		ASSERT(accessor.type == TINYGLTF_TYPE_VEC3 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-		SetOrValidateVertCount(count);
-
-		for(int i = 0; i < count; i++) {
-			glm::vec3 data = glm::vec3(0);
-			memcpy(&data, datastart + (dataSize * i), dataSize * sizeof(char));
-			vertices[i].mNorm = data;
+		const tinygltf::Accessor& accessor = aModel.accessors[accessorIndex];
+		if(!SetOrValidateVertCount(accessor.count)) {
+			LOGGER::Formated("gltf attribute {} has {} vertices, expected {}\n", aName, accessor.count, vertCount);
+			valid = false;
+			return nullptr;
 		}
-	}
-	if(aPrimitive.attributes.contains("TANGENT")) {
-		const tinygltf::Accessor& accessor = aModel.accessors[aPrimitive.attributes["TANGENT"]];
-		const tinygltf::BufferView& view = aModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = aModel.buffers[view.buffer];
-		const unsigned char* datastart = &buffer.data[accessor.byteOffset + view.byteOffset];
-		const int dataSize =
-			accessor.ByteStride(view); //tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
-		const int count = accessor.count;
-
-		ASSERT(accessor.type == TINYGLTF_TYPE_VEC4 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-		SetOrValidateVertCount(count);
-
-		for(int i = 0; i < count; i++) {
-			glm::vec4 data = glm::vec4(0);
-			memcpy(&data, datastart + (dataSize * i), dataSize * sizeof(char));
-			vertices[i].mTangent = glm::vec3(data);
+		const VertexConvert::Stream stream = GetAccessorStream(aModel, accessor, aNormalized);
+		if(stream.mData == nullptr) {
+			valid = false;
+			return nullptr;
 		}
-	}
-	if(aPrimitive.attributes.contains("TEXCOORD_0")) {
-		const tinygltf::Accessor& accessor = aModel.accessors[aPrimitive.attributes["TEXCOORD_0"]];
-		const tinygltf::BufferView& view = aModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = aModel.buffers[view.buffer];
-		const unsigned char* datastart = &buffer.data[accessor.byteOffset + view.byteOffset];
-		const int dataSize =
-			accessor.ByteStride(view); //tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
-		const int count = accessor.count;
-
-		ASSERT(accessor.type == TINYGLTF_TYPE_VEC2 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-		SetOrValidateVertCount(count);
-
-		for(int i = 0; i < count; i++) {
-			glm::vec2 data = glm::vec2(0);
-			memcpy(&data, datastart + (dataSize * i), dataSize * sizeof(char));
-			vertices[i].mUVs[0] = data;
+		const size_t memberOffset = (uint8_t*)aMember - (uint8_t*)&layout;
+		VertexConvert::ConvertToFloat(stream, (float*)((uint8_t*)vertices.data() + memberOffset), sizeof(MeshVert), aNumComponents, accessor.count);
+		return &accessor;
+	};
+	if(const tinygltf::Accessor* accessor = ConvertAttribute("POSITION", &layout.mPos.x, 3)) {
+		ASSERT(accessor->type == TINYGLTF_TYPE_VEC3);
+		if(accessor->minValues.size() == 3 && accessor->maxValues.size() == 3) {
+			mesh.mAABB.mMin = glm::vec3(accessor->minValues[0], accessor->minValues[1], accessor->minValues[2]);
+			mesh.mAABB.mMax = glm::vec3(accessor->maxValues[0], accessor->maxValues[1], accessor->maxValues[2]);
 		}
 	}
-	if(aPrimitive.attributes.contains("COLOR_0")) {
-		const tinygltf::Accessor& accessor = aModel.accessors[aPrimitive.attributes["COLOR_0"]];
-		const tinygltf::BufferView& view = aModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = aModel.buffers[view.buffer];
-		const unsigned char* dataStart = &buffer.data[accessor.byteOffset + view.byteOffset];
-		const int dataSize =
-			accessor.ByteStride(view); //tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
-		const int count = accessor.count;
-
-		ASSERT(accessor.type == TINYGLTF_TYPE_VEC4 &&
-			   (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT));
-		SetOrValidateVertCount(count);
-
-		for(int i = 0; i < count; i++) {
-			glm::vec4 data = glm::vec4(0);
-			switch(accessor.componentType) {
-				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-					unsigned short tempData[4];
-					memcpy(&tempData, dataStart + (dataSize * i), dataSize);
-					data[0] = (float)tempData[0] / USHRT_MAX;
-					data[1] = (float)tempData[1] / USHRT_MAX;
-					data[2] = (float)tempData[2] / USHRT_MAX;
-					data[3] = (float)tempData[3] / USHRT_MAX;
-					break;
-				case TINYGLTF_COMPONENT_TYPE_FLOAT:
-					memcpy(&data, dataStart + (dataSize * i), dataSize * sizeof(float));
-					break;
-				default:
-					ASSERT(false);
-					break;
-			}
-
-			vertices[i].mColors[0] = data;
-		}
+	if(const tinygltf::Accessor* accessor = ConvertAttribute("NORMAL", &layout.mNorm.x, 3)) {
+		ASSERT(accessor->type == TINYGLTF_TYPE_VEC3);
+	}
+	//w is the bitangent sign, not kept
+	if(const tinygltf::Accessor* accessor = ConvertAttribute("TANGENT", &layout.mTangent.x, 3)) {
+		ASSERT(accessor->type == TINYGLTF_TYPE_VEC4);
+	}
+	if(const tinygltf::Accessor* accessor = ConvertAttribute("TEXCOORD_0", &layout.mUVs[0].x, 2)) {
+		ASSERT(accessor->type == TINYGLTF_TYPE_VEC2);
+	}
+	//integer colors are always normalized, vec3 colors get an alpha of 1
+	if(const tinygltf::Accessor* accessor = ConvertAttribute("COLOR_0", &layout.mColors[0].x, 4, true)) {
+		ASSERT(accessor->type == TINYGLTF_TYPE_VEC3 || accessor->type == TINYGLTF_TYPE_VEC4);
 	} else {
-		ASSERT(vertCount != -1);
 		for(int i = 0; i < vertCount; i++) {
-			glm::vec4 data = glm::vec4(1);
-			vertices[i].mColors[0] = data;
+			vertices[i].mColors[0] = glm::vec4(1);
+		}
+	}
+	if(!valid || vertCount == -1) {
+		if(valid) {
+			LOGGER::Log("gltf primitive has no vertex attributes\n");
 		}
+		vertices.clear();
+		return false;
 	}
 
 	//index
 	{
+		if(aPrimitive.indices < 0 || aPrimitive.indices >= aModel.accessors.size()) {
+			LOGGER::Formated("gltf primitive has an invalid index accessor {}\n", aPrimitive.indices);
+			vertices.clear();
+			return false;
+		}
 		const tinygltf::Accessor& accessor = aModel.accessors[aPrimitive.indices];
-		const tinygltf::BufferView& view = aModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = aModel.buffers[view.buffer];
-		const unsigned char* datastart = &buffer.data[accessor.byteOffset + view.byteOffset];
-		const int dataSize =
-			accessor.ByteStride(view); //tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
-		const int count = accessor.count;
+		int dataSize;
+		const unsigned char* dataStart = GetAccessorData(aModel, accessor, dataSize);
+		if(dataStart == nullptr) {
+			vertices.clear();
+			return false;
+		}
 
 		ASSERT(accessor.type == TINYGLTF_TYPE_SCALAR);
-		indices.resize(count);
-
-		for(int i = 0; i < count; i++) {
-			MeshIndex data = 0;
-			memcpy(&data, datastart + (dataSize * i), dataSize);
-			indices[i] = data;
+		indices.resize(accessor.count);
+		VertexConvert::ConvertIndices(dataStart, dataSize, tinygltf::GetComponentSizeInBytes(accessor.componentType), indices.data(), accessor.count);
+		//the optimizer and the gpu would read past the vertices otherwise
+		for(size_t i = 0; i < indices.size(); i++) {
+			if(indices[i] >= (MeshIndex)vertCount) {
+				LOGGER::Formated("gltf index {} is {}, past the {} vertices\n", i, indices[i], vertCount);
+				vertices.clear();
+				indices.clear();
+				return false;
+			}
 		}
 	}
 
+	Mesh::OptimizeSubMesh(mesh, aStats);
+	Mesh::GenerateLODs(mesh);
+	Mesh::GenerateMeshlets(mesh);
+
 	//temp
-	mesh.mVertexBuffer.CreateFromData(BufferType::VERTEX, sizeof(MeshVert) * vertices.size(), vertices.data(), "Mesh Vertex Data");
-	mesh.mIndexBuffer.CreateFromData(BufferType::INDEX, sizeof(MeshIndex) * indices.size(), indices.data(), "Mesh Index Data");
-	mesh.mVertexBuffer.Flush();
-	mesh.mIndexBuffer.Flush();
+	Mesh::CreateBuffers(mesh);
+	return true;
 }
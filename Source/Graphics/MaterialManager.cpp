@@ -1,5 +1,7 @@
 #include "MaterialManager.h"
 
+#include <filesystem>
+
 #include <imgui/imgui.h>
 
 #include "Graphics.h"
@@ -53,6 +55,19 @@ void MaterialManager::Initalize() {
 }
 
 void MaterialManager::Destroy() {
+	{
+		std::unique_lock<std::mutex> lock(mTextureCacheLock);
+		//meshes should have released theirs before this
+		for(auto& [key, texture]: mTextureCache) {
+			LOGGER::Formated("Texture cache still has {} references to {}\n", texture.mReferences, key);
+			texture.mImage->WaitForLoad();
+			texture.mImage->Destroy();
+			delete texture.mImage;
+		}
+		mTextureCache.clear();
+		mTextureCacheKeys.clear();
+	}
+
 	for(int index = 0; index < 3; index++) {
 		for(int i = 0; i < mTextureGroups[index].size(); i++) {
 			vkFreeDescriptorSets(gGraphics->GetVkDevice(), gGraphics->GetDesciptorPool(), 1, &mTextureGroups[index][i].mTextureSet);
@@ -84,6 +99,14 @@ void MaterialManager::ImGuiDraw() {
 			sprintf(buf, "%d/%d", group.mGlobalImageIndex, group.mMaxImageCount);
 			ImGui::ProgressBar(group.mGlobalImageIndex / (float)group.mMaxImageCount, ImVec2(-1.f, 0.f), buf);
 		}
+
+		const TextureCacheStats stats = GetTextureCacheStats();
+		const uint64_t requests = stats.mHits + stats.mMisses;
+		ImGui::Text("Texture cache: %u textures, %u references, %.2f MB", stats.mTextures, stats.mReferences, stats.mBytes / (1024.0f * 1024.0f));
+		ImGui::Text("%llu hits, %llu misses (%.1f%% hit)",
+					(unsigned long long)stats.mHits,
+					(unsigned long long)stats.mMisses,
+					requests ? stats.mHits * 100.0f / requests : 0.0f);
 	}
 	ImGui::End();
 }
@@ -120,6 +143,76 @@ uint32_t MaterialManager::AddTextureToGlobalSet(VkImageView aImageView) {
 	return -1;
 }
 
+Image* MaterialManager::AcquireTexture(const std::string& aPath, VkFormat aFormat) {
+	return AcquireTexture(aPath, nullptr, 0, aFormat);
+}
+
+Image* MaterialManager::AcquireTexture(const std::string& aPath, const void* aData, size_t aSize, VkFormat aFormat) {
+	ZoneScoped;
+	//different spellings of the same file ("a/../b", relative to the working dir) share an entry
+	const std::string key = std::filesystem::absolute(aPath).lexically_normal().generic_string() + "|" + std::to_string(aFormat);
+
+	std::unique_lock<std::mutex> lock(mTextureCacheLock);
+	auto result = mTextureCache.find(key);
+	if(result != mTextureCache.end()) {
+		result->second.mReferences++;
+		mTextureCacheStats.mHits++;
+		return result->second.mImage;
+	}
+	mTextureCacheStats.mMisses++;
+	Image* image = new Image();
+	mTextureCache[key] = {image, 1};
+	mTextureCacheKeys[image] = key;
+	//LoadImage only queues the work, fine to do while locked
+	if(aData) {
+		const uint8_t* data = (const uint8_t*)aData;
+		image->LoadImage(aPath, std::vector<uint8_t>(data, data + aSize), aFormat);
+	} else {
+		image->LoadImage(aPath, aFormat);
+	}
+	return image;
+}
+
+void MaterialManager::ReleaseTexture(Image* aImage) {
+	if(aImage == nullptr) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mTextureCacheLock);
+	auto keyResult = mTextureCacheKeys.find(aImage);
+	ASSERT(keyResult != mTextureCacheKeys.end());
+	if(keyResult == mTextureCacheKeys.end()) {
+		return;
+	}
+	auto result = mTextureCache.find(keyResult->second);
+	CachedTexture& texture = result->second;
+	ASSERT(texture.mReferences > 0);
+	if(--texture.mReferences != 0) {
+		return;
+	}
+	mTextureCache.erase(result);
+	mTextureCacheKeys.erase(keyResult);
+	lock.unlock();
+
+	//can still be loading if the mesh is destroyed straight after it's loaded
+	aImage->WaitForLoad();
+	aImage->Destroy();
+	delete aImage;
+}
+
+MaterialManager::TextureCacheStats MaterialManager::GetTextureCacheStats() const {
+	std::unique_lock<std::mutex> lock(mTextureCacheLock);
+	TextureCacheStats stats = mTextureCacheStats;
+	stats.mTextures = mTextureCache.size();
+	stats.mReferences = 0;
+	for(const auto& [key, texture]: mTextureCache) {
+		stats.mReferences += texture.mReferences;
+		if(texture.mImage->HasLoaded()) {
+			stats.mBytes += texture.mImage->GetMemorySize();
+		}
+	}
+	return stats;
+}
+
 void MaterialManager::BindlessTextureGroup::Create(uint32_t aCount) {
 	VkDescriptorSetAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
 
 #include <vulkan/vulkan.h>
 
@@ -49,7 +52,36 @@ public:
 	//instead adding the view in when it's first used
 	uint32_t AddTextureToGlobalSet(VkImageView aImageView);
 
+	//shared textures for mesh materials, keyed by the absolute path and format
+	//the first request starts the load, later ones get the same Image (which may still be loading)
+	//every AcquireTexture needs a ReleaseTexture, the image is destroyed with the last one. thread safe
+	Image* AcquireTexture(const std::string& aPath, VkFormat aFormat);
+	//for an encoded image already in memory, aPath is the name it's cached under
+	//aData is only copied when it isn't already cached, it only needs to live for this call
+	Image* AcquireTexture(const std::string& aPath, const void* aData, size_t aSize, VkFormat aFormat);
+	void ReleaseTexture(Image* aImage);
+
+	struct TextureCacheStats {
+		uint32_t mTextures = 0;
+		uint32_t mReferences = 0;
+		//device memory of the loaded textures
+		uint64_t mBytes = 0;
+		uint64_t mHits = 0;
+		uint64_t mMisses = 0;
+	};
+	TextureCacheStats GetTextureCacheStats() const;
+
 private:
+	struct CachedTexture {
+		Image* mImage;
+		uint32_t mReferences;
+	};
+	std::unordered_map<std::string, CachedTexture> mTextureCache;
+	//to find the key again in ReleaseTexture
+	std::unordered_map<Image*, std::string> mTextureCacheKeys;
+	TextureCacheStats mTextureCacheStats;
+	mutable std::mutex mTextureCacheLock;
+
 	//min of 16, max of int_max
 	uint32_t mMaxTextures;
 	enum MODE
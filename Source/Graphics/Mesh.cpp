@@ -1,15 +1,363 @@
 #include "Mesh.h"
 
+#include <glm/gtc/packing.hpp>
+#include <meshoptimizer.h>
+
 #include "PlatformDebug.h"
 #include "Graphics/Conversions.h"
 
 #include "Graphics/Material.h"
 #include "Graphics/Image.h"
+#include "Graphics/MaterialManager.h"
 
 #include "Helpers.h"
+#include "Graphics.h"
 
 #include "Loaders/AssimpLoader.h"
 #include "Loaders/TinygltfLoader.h"
+#include "Loaders/MeshCacheLoader.h"
+
+MeshVertexStreams gMeshVertexStreams = MeshVertexStreams::INTERLEAVED;
+bool gMeshBuildMeshlets = false;
+unsigned int gMeshAssimpPostProcessFlags = AssimpLoader::cDefaultPostProcessFlags;
+bool gMeshUseCache = true;
+
+//octahedral normal encoding, maps the unit sphere onto a [-1,1] square
+static uint32_t PackOctahedral(const glm::vec3& aNormal) {
+	const float length = glm::abs(aNormal.x) + glm::abs(aNormal.y) + glm::abs(aNormal.z);
+	if(length == 0.0f) {
+		return glm::packSnorm2x16(glm::vec2(0));
+	}
+	const glm::vec3 normal = aNormal / length;
+	glm::vec2 encoded = glm::vec2(normal.x, normal.y);
+	if(normal.z < 0.0f) {
+		//fold the lower hemisphere over the diagonals
+		const glm::vec2 sign = glm::vec2(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+		encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+	}
+	return glm::packSnorm2x16(encoded);
+}
+
+static PackedMeshAttributes PackAttributes(const MeshVert& aVert) {
+	PackedMeshAttributes packed;
+	packed.mNorm = PackOctahedral(aVert.mNorm);
+	packed.mTangent = PackOctahedral(aVert.mTangent);
+	packed.mColor = glm::packUnorm4x8(aVert.mColors[0]);
+	packed.mUV = glm::packHalf2x16(aVert.mUVs[0]);
+	return packed;
+}
+
+void Mesh::CreateBuffers(SubMesh& aMesh) {
+	ZoneScoped;
+	const size_t numVertices = aMesh.mVertices.size();
+	if(aMesh.mLODs.empty()) {
+		MeshLOD lod;
+		lod.mIndexCount = aMesh.mIndices.size();
+		aMesh.mLODs.push_back(lod);
+	}
+	//every index (lods and meshlets included) points into this submesh's vertices, so 16 bit is enough when there's few of them
+	aMesh.mIndexType = numVertices <= cMaxIndex16Vertices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	GeometryArena* arena = gGraphics->GetGeometryArena();
+	ASSERT(!aMesh.mGeometry.IsValid());
+	aMesh.mGeometry = arena->Allocate(numVertices, aMesh.mIndices.size() + aMesh.mLODIndices.size() + aMesh.mMeshletIndices.size(), aMesh.mIndexType);
+
+	switch(gMeshVertexStreams) {
+		case MeshVertexStreams::INTERLEAVED: {
+			std::vector<PackedMeshVert> packed(numVertices);
+			for(size_t i = 0; i < numVertices; i++) {
+				const PackedMeshAttributes attributes = PackAttributes(aMesh.mVertices[i]);
+				packed[i].mPos = aMesh.mVertices[i].mPos;
+				packed[i].mNorm = attributes.mNorm;
+				packed[i].mTangent = attributes.mTangent;
+				packed[i].mColor = attributes.mColor;
+				packed[i].mUV = attributes.mUV;
+			}
+			arena->WriteVertices(aMesh.mGeometry, 0, packed.data());
+			break;
+		}
+		case MeshVertexStreams::SPLIT_POSITION: {
+			std::vector<glm::vec3> positions(numVertices);
+			std::vector<PackedMeshAttributes> packed(numVertices);
+			for(size_t i = 0; i < numVertices; i++) {
+				positions[i] = aMesh.mVertices[i].mPos;
+				packed[i] = PackAttributes(aMesh.mVertices[i]);
+			}
+			arena->WriteVertices(aMesh.mGeometry, 0, positions.data());
+			arena->WriteVertices(aMesh.mGeometry, 1, packed.data());
+			break;
+		}
+	}
+
+	if(aMesh.mIndexType == VK_INDEX_TYPE_UINT16) {
+		std::vector<uint16_t> indices;
+		indices.reserve(aMesh.mGeometry.mNumIndices);
+		indices.insert(indices.end(), aMesh.mIndices.begin(), aMesh.mIndices.end());
+		indices.insert(indices.end(), aMesh.mLODIndices.begin(), aMesh.mLODIndices.end());
+		indices.insert(indices.end(), aMesh.mMeshletIndices.begin(), aMesh.mMeshletIndices.end());
+		arena->WriteIndices(aMesh.mGeometry, indices.data());
+	} else if(aMesh.mLODIndices.empty() && aMesh.mMeshletIndices.empty()) {
+		arena->WriteIndices(aMesh.mGeometry, aMesh.mIndices.data());
+	} else {
+		std::vector<MeshIndex> indices;
+		indices.reserve(aMesh.mGeometry.mNumIndices);
+		indices.insert(indices.end(), aMesh.mIndices.begin(), aMesh.mIndices.end());
+		indices.insert(indices.end(), aMesh.mLODIndices.begin(), aMesh.mLODIndices.end());
+		indices.insert(indices.end(), aMesh.mMeshletIndices.begin(), aMesh.mMeshletIndices.end());
+		arena->WriteIndices(aMesh.mGeometry, indices.data());
+	}
+}
+
+//static
+void Mesh::OptimizeSubMesh(SubMesh& aMesh, OptimizeStats& aStats) {
+	ZoneScoped;
+	std::vector<MeshVert>& vertices = aMesh.mVertices;
+	std::vector<MeshIndex>& indices = aMesh.mIndices;
+	if(vertices.empty() || indices.empty() || indices.size() % 3 != 0) {
+		return;
+	}
+	//typical post transform cache size, warp size and primitive group size don't apply here
+	const unsigned int cacheSize = 16;
+	//allow a little extra cache misses for less overdraw
+	const float overdrawThreshold = 1.05f;
+
+	const meshopt_VertexCacheStatistics cacheBefore = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize, 0, 0);
+	const meshopt_OverdrawStatistics overdrawBefore =
+		meshopt_analyzeOverdraw(indices.data(), indices.size(), &vertices[0].mPos.x, vertices.size(), sizeof(MeshVert));
+	const meshopt_VertexFetchStatistics fetchBefore = meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertices.size(), sizeof(MeshVert));
+
+	meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+	meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), &vertices[0].mPos.x, vertices.size(), sizeof(MeshVert), overdrawThreshold);
+	//also drops vertices no index uses
+	const size_t numVertices = meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(MeshVert));
+	vertices.resize(numVertices);
+
+	const meshopt_VertexCacheStatistics cacheAfter = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize, 0, 0);
+	const meshopt_OverdrawStatistics overdrawAfter =
+		meshopt_analyzeOverdraw(indices.data(), indices.size(), &vertices[0].mPos.x, vertices.size(), sizeof(MeshVert));
+	const meshopt_VertexFetchStatistics fetchAfter = meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertices.size(), sizeof(MeshVert));
+
+	aStats.mTriangles += indices.size() / 3;
+	aStats.mVertices += vertices.size();
+	aStats.mTransformedBefore += cacheBefore.vertices_transformed;
+	aStats.mTransformedAfter += cacheAfter.vertices_transformed;
+	aStats.mCoveredBefore += overdrawBefore.pixels_covered;
+	aStats.mShadedBefore += overdrawBefore.pixels_shaded;
+	aStats.mCoveredAfter += overdrawAfter.pixels_covered;
+	aStats.mShadedAfter += overdrawAfter.pixels_shaded;
+	aStats.mFetchedBefore += fetchBefore.bytes_fetched;
+	aStats.mFetchedAfter += fetchAfter.bytes_fetched;
+}
+
+//static
+void Mesh::GenerateLODs(SubMesh& aMesh) {
+	ZoneScoped;
+	const std::vector<MeshVert>& vertices = aMesh.mVertices;
+	const std::vector<MeshIndex>& indices = aMesh.mIndices;
+	aMesh.mLODIndices.clear();
+	aMesh.mLODs.clear();
+
+	MeshLOD baseLOD;
+	baseLOD.mIndexCount = indices.size();
+	aMesh.mLODs.push_back(baseLOD);
+	if(vertices.empty() || indices.empty() || indices.size() % 3 != 0) {
+		return;
+	}
+
+	//max error allowed for each lod, relative to the mesh size
+	const float cLODErrors[cMaxLODs - 1] = {0.002f, 0.01f, 0.04f};
+	//each lod needs to remove at least this much of the one before it to be worth keeping
+	const float cMinReduction = 0.75f;
+	const size_t cMinTriangles = 32;
+
+	std::vector<MeshIndex> lodIndices(indices.size());
+	size_t previousCount = indices.size();
+	for(int i = 0; i < cMaxLODs - 1; i++) {
+		const size_t targetCount = (previousCount / 2) / 3 * 3;
+		if(targetCount < cMinTriangles * 3) {
+			break;
+		}
+		float error = 0.0f;
+		//simplify from the full mesh so the errors don't stack up
+		size_t count = meshopt_simplify(lodIndices.data(),
+										indices.data(),
+										indices.size(),
+										&vertices[0].mPos.x,
+										vertices.size(),
+										sizeof(MeshVert),
+										targetCount,
+										cLODErrors[i],
+										0,
+										&error);
+		if(count == 0 || count > previousCount * cMinReduction) {
+			continue;
+		}
+		meshopt_optimizeVertexCache(lodIndices.data(), lodIndices.data(), count, vertices.size());
+
+		MeshLOD lod;
+		lod.mIndexOffset = indices.size() + aMesh.mLODIndices.size();
+		lod.mIndexCount = count;
+		lod.mError = error;
+		aMesh.mLODs.push_back(lod);
+		aMesh.mLODIndices.insert(aMesh.mLODIndices.end(), lodIndices.begin(), lodIndices.begin() + count);
+		previousCount = count;
+	}
+}
+
+//static
+void Mesh::GenerateMeshlets(SubMesh& aMesh) {
+	ZoneScoped;
+	aMesh.mMeshletIndices.clear();
+	aMesh.mMeshlets.clear();
+	const std::vector<MeshVert>& vertices = aMesh.mVertices;
+	const std::vector<MeshIndex>& indices = aMesh.mIndices;
+	if(!gMeshBuildMeshlets || vertices.empty() || indices.empty() || indices.size() % 3 != 0) {
+		return;
+	}
+	//0 favours smaller bounding spheres, 1 tighter normal cones
+	const float coneWeight = 0.25f;
+
+	const size_t maxMeshlets = meshopt_buildMeshletsBound(indices.size(), cMeshletMaxVertices, cMeshletMaxTriangles);
+	std::vector<meshopt_Meshlet> meshlets(maxMeshlets);
+	std::vector<unsigned int> meshletVertices(maxMeshlets * cMeshletMaxVertices);
+	std::vector<unsigned char> meshletTriangles(maxMeshlets * cMeshletMaxTriangles * 3);
+	const size_t numMeshlets = meshopt_buildMeshlets(meshlets.data(),
+													 meshletVertices.data(),
+													 meshletTriangles.data(),
+													 indices.data(),
+													 indices.size(),
+													 &vertices[0].mPos.x,
+													 vertices.size(),
+													 sizeof(MeshVert),
+													 cMeshletMaxVertices,
+													 cMeshletMaxTriangles,
+													 coneWeight);
+
+	//expand back to normal indices so the meshlets can go through the regular pipelines and indirect draws
+	const uint32_t indexStart = aMesh.mIndices.size() + aMesh.mLODIndices.size();
+	aMesh.mMeshlets.resize(numMeshlets);
+	aMesh.mMeshletIndices.reserve(indices.size());
+	for(size_t i = 0; i < numMeshlets; i++) {
+		const meshopt_Meshlet& meshlet = meshlets[i];
+		const unsigned int* localVertices = &meshletVertices[meshlet.vertex_offset];
+		const unsigned char* localTriangles = &meshletTriangles[meshlet.triangle_offset];
+		const meshopt_Bounds bounds =
+			meshopt_computeMeshletBounds(localVertices, localTriangles, meshlet.triangle_count, &vertices[0].mPos.x, vertices.size(), sizeof(MeshVert));
+
+		Meshlet& data = aMesh.mMeshlets[i];
+		data.mCenter = glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]);
+		data.mRadius = bounds.radius;
+		data.mConeAxis = glm::vec3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+		data.mConeCutoff = bounds.cone_cutoff;
+		data.mIndexOffset = indexStart + aMesh.mMeshletIndices.size();
+		data.mIndexCount = meshlet.triangle_count * 3;
+		for(unsigned int q = 0; q < meshlet.triangle_count * 3; q++) {
+			aMesh.mMeshletIndices.push_back(localVertices[localTriangles[q]]);
+		}
+	}
+}
+
+void Mesh::ApplyRetention() {
+	ZoneScoped;
+	for(int i = 0; i < mMesh.size(); i++) {
+		SubMesh& mesh = mMesh[i];
+		//the lod/meshlet index lists only exist to be uploaded or cached
+		std::vector<MeshIndex>().swap(mesh.mLODIndices);
+		std::vector<MeshIndex>().swap(mesh.mMeshletIndices);
+		switch(mRetention) {
+			case MeshRetention::DISCARD:
+				std::vector<MeshVert>().swap(mesh.mVertices);
+				std::vector<MeshIndex>().swap(mesh.mIndices);
+				break;
+			case MeshRetention::POSITIONS:
+				mesh.mPositions.resize(mesh.mVertices.size());
+				for(int q = 0; q < mesh.mVertices.size(); q++) {
+					mesh.mPositions[q] = mesh.mVertices[q].mPos;
+				}
+				std::vector<MeshVert>().swap(mesh.mVertices);
+				mesh.mIndices.shrink_to_fit();
+				break;
+			case MeshRetention::ALL:
+				break;
+		}
+	}
+	const MemoryStats memory = GetMemoryStats();
+	LOGGER::Formated("Mesh memory: cpu {} KB, gpu {} KB\n", memory.mCPUBytes / 1024, memory.mGPUBytes / 1024);
+}
+
+Mesh::MemoryStats Mesh::GetMemoryStats() const {
+	MemoryStats stats;
+	for(int i = 0; i < mMesh.size(); i++) {
+		const SubMesh& mesh = mMesh[i];
+		stats.mCPUBytes += sizeof(MeshVert) * mesh.mVertices.capacity() + sizeof(glm::vec3) * mesh.mPositions.capacity();
+		stats.mCPUBytes += sizeof(MeshIndex) * (mesh.mIndices.capacity() + mesh.mLODIndices.capacity() + mesh.mMeshletIndices.capacity());
+		stats.mCPUBytes += sizeof(MeshLOD) * mesh.mLODs.capacity() + sizeof(Meshlet) * mesh.mMeshlets.capacity();
+		//both stream layouts are the same size per vertex
+		stats.mGPUBytes += sizeof(PackedMeshVert) * (size_t)mesh.mGeometry.mNumVertices + GeometryArena::GetIndexSize(mesh.mIndexType) * (size_t)mesh.mGeometry.mNumIndices;
+	}
+	return stats;
+}
+
+void Mesh::LogOptimizeStats() const {
+	const OptimizeStats& stats = mOptimizeStats;
+	if(stats.mTriangles == 0) {
+		return;
+	}
+	const auto Ratio = [](uint64_t aValue, uint64_t aOver) {
+		return aOver == 0 ? 0.0f : (float)((double)aValue / aOver);
+	};
+	const uint64_t vertexBytes = stats.mVertices * sizeof(MeshVert);
+	LOGGER::Formated("Optimized {} triangles, {} vertices\n\tACMR {} -> {}\n\toverdraw {} -> {}\n\toverfetch {} -> {}\n",
+					 stats.mTriangles,
+					 stats.mVertices,
+					 Ratio(stats.mTransformedBefore, stats.mTriangles),
+					 Ratio(stats.mTransformedAfter, stats.mTriangles),
+					 Ratio(stats.mShadedBefore, stats.mCoveredBefore),
+					 Ratio(stats.mShadedAfter, stats.mCoveredAfter),
+					 Ratio(stats.mFetchedBefore, vertexBytes),
+					 Ratio(stats.mFetchedAfter, vertexBytes));
+}
+
+//static
+void Mesh::GetVertexInput(std::vector<VkVertexInputBindingDescription>& aBindings, std::vector<VkVertexInputAttributeDescription>& aAttributes) {
+	aAttributes = std::vector<VkVertexInputAttributeDescription>(4);
+	aAttributes[0].location = 0;
+	aAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	aAttributes[1].location = 1;
+	aAttributes[1].format = VK_FORMAT_R16G16_SNORM;
+	aAttributes[2].location = 2;
+	aAttributes[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+	aAttributes[3].location = 3;
+	aAttributes[3].format = VK_FORMAT_R16G16_SFLOAT;
+
+	switch(gMeshVertexStreams) {
+		case MeshVertexStreams::INTERLEAVED:
+			aBindings = std::vector<VkVertexInputBindingDescription>(1);
+			aBindings[0].binding = 0;
+			aBindings[0].stride = sizeof(PackedMeshVert);
+			aBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			aAttributes[0].offset = offsetof(PackedMeshVert, mPos);
+			aAttributes[1].offset = offsetof(PackedMeshVert, mNorm);
+			aAttributes[2].offset = offsetof(PackedMeshVert, mColor);
+			aAttributes[3].offset = offsetof(PackedMeshVert, mUV);
+			break;
+		case MeshVertexStreams::SPLIT_POSITION:
+			aBindings = std::vector<VkVertexInputBindingDescription>(2);
+			aBindings[0].binding = 0;
+			aBindings[0].stride = sizeof(glm::vec3);
+			aBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			aBindings[1].binding = 1;
+			aBindings[1].stride = sizeof(PackedMeshAttributes);
+			aBindings[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			aAttributes[0].offset = 0;
+			for(int i = 1; i < 4; i++) {
+				aAttributes[i].binding = 1;
+			}
+			aAttributes[1].offset = offsetof(PackedMeshAttributes, mNorm);
+			aAttributes[2].offset = offsetof(PackedMeshAttributes, mColor);
+			aAttributes[3].offset = offsetof(PackedMeshAttributes, mUV);
+			break;
+	}
+}
 
 Job::Work Mesh::GetWork(FileIO::Path aFilePath) {
 	const std::string ext = str_tolower(aFilePath.Extension());
@@ -32,6 +380,41 @@ Job::Work Mesh::GetWork(FileIO::Path aFilePath) {
 
 	mLoadingBase = nullptr;
 
+	//anything that changes the imported result needs to be in here
+	std::string importerSettings;
+	switch(selectedLoader) {
+		case MeshLoaders::TINYGLTF:
+			importerSettings = "tinygltf";
+			break;
+		case MeshLoaders::ASSIMP:
+		case MeshLoaders::COUNT: //fallback
+			importerSettings = "assimp " + std::to_string(AssimpLoader::GetPostProcessFlags());
+			break;
+		default:
+			ASSERT(false);
+	}
+	if(gMeshBuildMeshlets) {
+		importerSettings += " meshlets";
+	}
+	const std::string cachePath = gMeshUseCache ? MeshCacheLoader::GetCachePath(aFilePath, importerSettings) : "";
+	if(!cachePath.empty()) {
+		MeshCacheLoader* cacheLoader = new MeshCacheLoader();
+		if(cacheLoader->Open(cachePath)) {
+			LOGGER::Formated("Using mesh cache {}\n", cachePath);
+			mLoadingBase = cacheLoader;
+			mLoadingBase->SetUp(this);
+			Job::Work work = mLoadingBase->GetWork(cachePath);
+			LoaderBase::AddTimings(work, &mLoadTimings);
+			const Job::WorkFunction loaderFinish = work.mFinishPtr;
+			work.mFinishPtr = [this, loaderFinish](void* aData) {
+				loaderFinish(aData);
+				ApplyRetention();
+			};
+			return work;
+		}
+		delete cacheLoader;
+	}
+
 	switch(selectedLoader) {
 		case MeshLoaders::TINYGLTF:
 			mLoadingBase = new TinygltfLoader();
@@ -49,7 +432,19 @@ Job::Work Mesh::GetWork(FileIO::Path aFilePath) {
 	}
 
 	mLoadingBase->SetUp(this);
-	return mLoadingBase->GetWork(aFilePath);
+	Job::Work work = mLoadingBase->GetWork(aFilePath);
+	LoaderBase::AddTimings(work, &mLoadTimings);
+	const Job::WorkFunction loaderFinish = work.mFinishPtr;
+	work.mFinishPtr = [this, loaderFinish, cachePath](void* aData) {
+		loaderFinish(aData);
+		LogOptimizeStats();
+		//cook the result so the next load can skip the importer
+		if(!cachePath.empty() && !mMesh.empty()) {
+			MeshCacheLoader::WriteCache(this, cachePath);
+		}
+		ApplyRetention();
+	};
+	return work;
 }
 
 bool Mesh::LoadMeshSync(FileIO::Path aFilePath, FileIO::Path aImagePath /*= ""*/) {
@@ -96,10 +491,7 @@ bool Mesh::LoadShape(Mesh::Shapes aShape) {
 	memcpy(mesh.mVertices.data(), positions, sizeof(positions));
 	memcpy(mesh.mIndices.data(), indices, sizeof(indices));
 
-	mesh.mVertexBuffer.CreateFromData(BufferType::VERTEX, sizeof(MeshVert) * mesh.mVertices.size(), mesh.mVertices.data(), "Mesh Vertex Data");
-	mesh.mIndexBuffer.CreateFromData(BufferType::INDEX, sizeof(MeshIndex) * mesh.mIndices.size(), mesh.mIndices.data(), "Mesh Index Data");
-	mesh.mVertexBuffer.Flush();
-	mesh.mIndexBuffer.Flush();
+	CreateBuffers(mesh);
 	return false;
 }
 
@@ -110,29 +502,26 @@ void Mesh::Destroy() {
 		mLoadingHandle = nullptr;
 	}
 
+	//images come from the MaterialManager's texture cache, other meshes can still be using them
+	MaterialManager* materialManager = gGraphics->GetMaterialManager();
 	for(int i = 0; i < mMaterials.size(); i++) {
-		if(mMaterials[i].mImage) {
-			mMaterials[i].mImage->Destroy();
-			mMaterials[i].mImage = nullptr;
-		}
-		if(mMaterials[i].mMetallicRoughnessTexture) {
-			mMaterials[i].mMetallicRoughnessTexture->Destroy();
-			mMaterials[i].mMetallicRoughnessTexture = nullptr;
-		}
-		if(mMaterials[i].mNormal) {
-			mMaterials[i].mNormal->Destroy();
-			mMaterials[i].mNormal = nullptr;
-		}
+		materialManager->ReleaseTexture(mMaterials[i].mImage);
+		mMaterials[i].mImage = nullptr;
+		materialManager->ReleaseTexture(mMaterials[i].mMetallicRoughnessTexture);
+		mMaterials[i].mMetallicRoughnessTexture = nullptr;
+		materialManager->ReleaseTexture(mMaterials[i].mNormal);
+		mMaterials[i].mNormal = nullptr;
 	}
 	mMaterials.clear();
 	for(int i = 0; i < mMesh.size(); i++) {
 		SubMesh& mesh = mMesh[i];
-		mesh.mVertexBuffer.Destroy();
-		mesh.mIndexBuffer.Destroy();
+		gGraphics->GetGeometryArena()->Free(mesh.mGeometry);
 	}
 	mMesh.clear();
 
 	mAABB = AABB();
+	mOptimizeStats = OptimizeStats();
+	mLoadTimings = LoadTimings();
 	mImagePath = "";
 	if(mLoadingBase) {
 		delete mLoadingBase;
@@ -160,8 +549,12 @@ const bool Mesh::HasLoaded() const {
 	return false;
 }
 
+const bool Mesh::HasLoadFinished() const {
+	return Job::IsDone(mLoadingHandle);
+}
+
 //temp
-void Mesh::QuickTempRender(VkCommandBuffer aBuffer, int aMeshIndex) const {
+void Mesh::QuickTempRender(VkCommandBuffer aBuffer, int aMeshIndex, int aLOD, GeometryArena::BindState* aBindState) const {
 	ZoneScoped;
 	if(false == HasLoaded()) {
 		return;
@@ -171,9 +564,12 @@ void Mesh::QuickTempRender(VkCommandBuffer aBuffer, int aMeshIndex) const {
 	//if(mesh.mMaterial != nullptr) {
 	//	vkCmdBindDescriptorSets(aBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayout, 1, 1, mesh.mMaterial->GetSet(), 0, nullptr);
 	//}
-	VkDeviceSize offsets[1] = {0};
-	vkCmdBindVertexBuffers(aBuffer, 0, 1, mesh.mVertexBuffer.GetBufferRef(), offsets);
-	vkCmdBindIndexBuffer(aBuffer, mesh.mIndexBuffer.GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
-	vkCmdDrawIndexed(aBuffer, mesh.mIndices.size(), 1, 0, 0, 0);
+	//the staged copy goes in at the start of the frame, a mesh finishing mid frame waits for the next one
+	if(!mesh.mGeometry.IsValid() || !mesh.mGeometry.IsUploaded()) {
+		return;
+	}
+	gGraphics->GetGeometryArena()->Bind(aBuffer, mesh.mGeometry, aBindState);
+	const MeshLOD& lod = mesh.mLODs[aLOD];
+	vkCmdDrawIndexed(aBuffer, lod.mIndexCount, 1, mesh.mGeometry.mFirstIndex + lod.mIndexOffset, mesh.mGeometry.mFirstVertex, 0);
 	//}
 }
@@ -10,13 +10,16 @@
 //#include "Engine/Transform.h"
 
 #include "Buffer.h"
+#include "GeometryArena.h"
 #include "Engine/Job.h"
+#include "Loaders/LoaderBase.h"
 
 class Image;
 class Model;
 class LoaderBase;
 class AssimpLoader;
 class TinygltfLoader;
+class MeshCacheLoader;
 
 static constexpr char NUM_UVS		= 1;
 static constexpr char NUM_VERT_COLS = 1;
@@ -32,12 +35,63 @@ struct MeshVert {
 };
 typedef uint32_t MeshIndex;
 
+//what gets uploaded, packed from MeshVert in Mesh::CreateBuffers
+//28 bytes instead of 72, bitangent is dropped as it can be rebuilt from the normal and tangent
+struct PackedMeshVert {
+	glm::vec3 mPos;
+	//octahedral encoded, snorm16x2
+	uint32_t mNorm;
+	uint32_t mTangent;
+	//unorm8x4
+	uint32_t mColor;
+	//half2
+	uint32_t mUV;
+};
+//PackedMeshVert without the position, for the second stream when positions are split out
+struct PackedMeshAttributes {
+	uint32_t mNorm;
+	uint32_t mTangent;
+	uint32_t mColor;
+	uint32_t mUV;
+};
+
+enum class MeshVertexStreams
+{
+	//one buffer of PackedMeshVert
+	INTERLEAVED,
+	//positions in their own buffer (binding 0) and PackedMeshAttributes in another (binding 1)
+	//lets depth only passes fetch just the positions
+	SPLIT_POSITION
+};
+//needs to be set before any meshes are loaded or mesh pipelines are created
+extern MeshVertexStreams gMeshVertexStreams;
+//split submeshes into meshlets with culling bounds on import, nothing draws them yet
+//needs to be set before meshes are loaded
+extern bool gMeshBuildMeshlets;
+//aiPostProcessSteps used when importing through assimp, part of the mesh cache key
+//cheap re-imports can drop aiProcess_CalcTangentSpace and aiProcess_OptimizeGraph/aiProcess_OptimizeMeshes
+//triangulating and bounding boxes are always added
+extern unsigned int gMeshAssimpPostProcessFlags;
+//load from and write to the mesh cache, off to always run the importers
+extern bool gMeshUseCache;
+
+
+//what a mesh keeps on the cpu once its geometry is uploaded
+enum class MeshRetention {
+	//nothing, the mesh can only be drawn
+	DISCARD,
+	//positions and lod 0 indices, enough for a collision mesh
+	POSITIONS,
+	//every vertex attribute and lod 0 index
+	ALL
+};
 
 class Mesh {
 public:
 	friend Model;
 	friend AssimpLoader;
 	friend TinygltfLoader;
+	friend MeshCacheLoader;
 	bool LoadMeshSync(FileIO::Path aFilePath, FileIO::Path aImagePath = "");
 	bool LoadMesh(FileIO::Path aFilePath, FileIO::Path aImagePath = "");
 	enum Shapes{
@@ -46,6 +100,11 @@ public:
 	bool LoadShape(Shapes aShape);
 	void Destroy();
 
+	//needs to be set before loading
+	void SetRetention(MeshRetention aRetention) {
+		mRetention = aRetention;
+	}
+
 	struct MeshMaterialData {
 		Image* mImage = nullptr;
 		Image* mNormal = nullptr;
@@ -56,23 +115,74 @@ public:
 		bool mNormalBC5 = false;//bc5 textures are incorrect atm
 	};
 
+	//range of the index buffer to draw, lod 0 is mIndices
+	struct MeshLOD {
+		uint32_t mIndexOffset = 0;
+		uint32_t mIndexCount = 0;
+		//simplification error relative to the submesh size
+		float mError = 0.0f;
+	};
+	static const int cMaxLODs = 4;
+
+	//small cluster of a submesh, drawn with mIndexCount indices from mIndexOffset in the submesh's index range
+	//bounds are in the submesh space
+	struct Meshlet {
+		glm::vec3 mCenter;
+		float mRadius;
+		//backfacing from every view point where dot(normalize(center - view), mConeAxis) >= mConeCutoff
+		glm::vec3 mConeAxis;
+		float mConeCutoff;
+		uint32_t mIndexOffset;
+		uint32_t mIndexCount;
+	};
+	static const int cMeshletMaxVertices = 64;
+	static const int cMeshletMaxTriangles = 124;
+	//submeshes with up to this many vertices upload 16 bit indices
+	static const uint32_t cMaxIndex16Vertices = 1 << 16;
+
 	struct SubMesh {
+		//emptied after loading unless the mesh uses MeshRetention::ALL
 		std::vector<MeshVert> mVertices;
+		//only filled after loading with MeshRetention::POSITIONS
+		std::vector<glm::vec3> mPositions;
 		std::vector<MeshIndex> mIndices;
+		//simplified index lists for lod 1+, share mVertices and go after mIndices in the index range
+		std::vector<MeshIndex> mLODIndices;
+		std::vector<MeshLOD> mLODs;
+		//lod 0 split up, with gMeshBuildMeshlets. indices go after mLODIndices in the index range
+		std::vector<MeshIndex> mMeshletIndices;
+		std::vector<Meshlet> mMeshlets;
 		AABB mAABB;
 
 		glm::mat4 mMatrix = glm::mat4(1);
 		//SimpleTransform mTransform;//should this be a normal Transform?
 
-		Buffer mVertexBuffer;
-		Buffer mIndexBuffer;
+		//vertices/indices in the GeometryArena, see GetVertexInput for the streams
+		GeometryArena::Allocation mGeometry;
+		//picked in CreateBuffers from the vertex count, mIndices stays 32 bit on the cpu
+		VkIndexType mIndexType = VK_INDEX_TYPE_UINT32;
 
 		int mMaterialID = -1;
+
+		//positions from whichever of mVertices/mPositions was kept
+		const glm::vec3* GetPositions() const {
+			return mVertices.empty() ? mPositions.data() : &mVertices[0].mPos;
+		}
+		uint32_t GetPositionStride() const {
+			return mVertices.empty() ? sizeof(glm::vec3) : sizeof(MeshVert);
+		}
+		uint32_t GetNumPositions() const {
+			return mVertices.empty() ? mPositions.size() : mVertices.size();
+		}
 	};
 
 	uint32_t GetNumMesh() const {
 		return mMesh.size();
 	}
+	//bounds of every submesh in mesh space, only valid once loaded
+	const AABB& GetAABB() const {
+		return mAABB;
+	}
 	const SubMesh& GetMesh(uint32_t aMeshIndex) const {
 		return mMesh[aMeshIndex];
 	}
@@ -85,20 +195,86 @@ public:
 
 	//checks if this mesh and it's images are loaded
 	const bool HasLoaded() const;
+	//the LoadMesh job is done, its images can still be loading
+	//a load that failed leaves the mesh without any submeshes
+	const bool HasLoadFinished() const;
+
+	struct MemoryStats {
+		size_t mCPUBytes = 0;
+		size_t mGPUBytes = 0;
+	};
+	MemoryStats GetMemoryStats() const;
+
+	const LoadTimings& GetLoadTimings() const {
+		return mLoadTimings;
+	}
+
+	//bindings/attributes matching the buffers made by CreateBuffers, for the mesh pipelines
+	//locations: 0 position, 1 normal, 2 color, 3 uv
+	static void GetVertexInput(std::vector<VkVertexInputBindingDescription>& aBindings, std::vector<VkVertexInputAttributeDescription>& aAttributes);
 
 protected:
-    void QuickTempRender(VkCommandBuffer aBuffer, int aMeshIndex) const;
+	//aBindState skips rebinding arena buffers the last draw already bound
+	void QuickTempRender(VkCommandBuffer aBuffer, int aMeshIndex, int aLOD = 0, GeometryArena::BindState* aBindState = nullptr) const;
 
 private:
 
 	Job::Work GetWork(FileIO::Path aFilePath);
 
+	//packs mVertices and uploads them with the index lists into the GeometryArena, used by the loaders once a submesh is filled in
+	static void CreateBuffers(SubMesh& aMesh);
+
+	//totals over every submesh given to OptimizeSubMesh, logged when the import finishes
+	struct OptimizeStats {
+		uint64_t mTriangles = 0;
+		uint64_t mVertices = 0;
+		//vertex cache
+		uint64_t mTransformedBefore = 0;
+		uint64_t mTransformedAfter = 0;
+		//overdraw
+		uint64_t mCoveredBefore = 0;
+		uint64_t mShadedBefore = 0;
+		uint64_t mCoveredAfter = 0;
+		uint64_t mShadedAfter = 0;
+		//vertex fetch
+		uint64_t mFetchedBefore = 0;
+		uint64_t mFetchedAfter = 0;
+
+		//for loaders that optimize submeshes in parallel then combine the results
+		OptimizeStats& operator+=(const OptimizeStats& aOther) {
+			mTriangles += aOther.mTriangles;
+			mVertices += aOther.mVertices;
+			mTransformedBefore += aOther.mTransformedBefore;
+			mTransformedAfter += aOther.mTransformedAfter;
+			mCoveredBefore += aOther.mCoveredBefore;
+			mShadedBefore += aOther.mShadedBefore;
+			mCoveredAfter += aOther.mCoveredAfter;
+			mShadedAfter += aOther.mShadedAfter;
+			mFetchedBefore += aOther.mFetchedBefore;
+			mFetchedAfter += aOther.mFetchedAfter;
+			return *this;
+		}
+	};
+	//reorders indices for the vertex cache and overdraw, then vertices for fetch locality
+	//for freshly imported triangle lists, the mesh cache stores the result
+	static void OptimizeSubMesh(SubMesh& aMesh, OptimizeStats& aStats);
+	void LogOptimizeStats() const;
+	//drops cpu data based on mRetention, after the cache has been written
+	void ApplyRetention();
+	//fills mLODIndices/mLODs with simplified copies of mIndices, call after OptimizeSubMesh
+	static void GenerateLODs(SubMesh& aMesh);
+	//fills mMeshletIndices/mMeshlets when gMeshBuildMeshlets is set, call after GenerateLODs
+	static void GenerateMeshlets(SubMesh& aMesh);
+
 	AABB mAABB;
 	std::vector<SubMesh> mMesh;
 	std::vector<MeshMaterialData> mMaterials;
+	OptimizeStats mOptimizeStats;
 
 	Job::WorkHandle* mLoadingHandle = nullptr;
 	LoaderBase* mLoadingBase = nullptr;
+	LoadTimings mLoadTimings;
 
 	std::string mImagePath;
+	MeshRetention mRetention = MeshRetention::DISCARD;
 };
\ No newline at end of file
@@ -9,6 +9,11 @@
 #include "Graphics/Helpers.h"
 #include "Engine/Transform.h"
 #include "Graphics/MaterialManager.h"
+#include "Graphics/StreamingManager.h"
+#include "Engine/Engine.h"
+#include "Engine/Camera/Camera.h"
+
+float gModelLODPixelError = 1.0f;
 
 void Model::Destroy() {
 	mLocation.Clear();
@@ -31,11 +36,15 @@ void Model::SetMaterial(int aIndex, Material aMaterial) {
 
 void Model::Render(VkCommandBuffer aBuffer, VkPipelineLayout aLayout) {
 	ZoneScoped;
+	//streamed meshes are loaded once they're drawn
+	gGraphics->GetStreamingManager()->MarkVisible(mMesh, mLocation.GetWorldMatrix());
 	if(!mMesh->HasLoaded()) {
 		return;
 	}
 	//UpdateMaterials();
 	const int numMesh = mMesh->GetNumMesh();
+	//submeshes are usually in the same arena block
+	GeometryArena::BindState bindState;
 
 	for(int i = 0; i < numMesh; i++) {
 		const Mesh::SubMesh& mesh = mMesh->GetMesh(i);
@@ -77,8 +86,42 @@ void Model::Render(VkCommandBuffer aBuffer, VkPipelineLayout aLayout) {
 		modelPC.mWorld = mLocation.GetWorldMatrix() * mesh.mMatrix;
 		//modelPC.mWorld = mLocation.GetWorldMatrix() * mesh.mTransform.GetLocalMatrixSlow();
 		vkCmdPushConstants(aBuffer, aLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(MeshPCTest), &modelPC);
-		mMesh->QuickTempRender(aBuffer, i);
+		mMesh->QuickTempRender(aBuffer, i, SelectLOD(mMesh, i, modelPC.mWorld), &bindState);
+	}
+}
+
+int Model::SelectLOD(const Mesh* aMesh, int aMeshIndex, const glm::mat4& aWorld) const {
+	const Mesh::SubMesh& mesh = aMesh->GetMesh(aMeshIndex);
+	const int numLODs = mesh.mLODs.size();
+	if(mForceLOD >= 0) {
+		return glm::min(mForceLOD, numLODs - 1);
+	}
+	Camera* camera = gEngine->GetMainCamera();
+	if(numLODs <= 1 || camera == nullptr || gModelLODPixelError <= 0.0f || mesh.mAABB.mMin.x > mesh.mAABB.mMax.x) {
+		return 0;
+	}
+
+	//bounding sphere of the aabb in world space
+	const glm::vec3 center = aWorld * glm::vec4((mesh.mAABB.mMin + mesh.mAABB.mMax) * 0.5f, 1.0f);
+	const float scale = glm::max(glm::length(glm::vec3(aWorld[0])), glm::max(glm::length(glm::vec3(aWorld[1])), glm::length(glm::vec3(aWorld[2]))));
+	const float radius = glm::length(mesh.mAABB.mMax - mesh.mAABB.mMin) * 0.5f * scale;
+	const float distance = glm::length(center - camera->GetTransform().GetWorldPosition());
+	if(distance <= radius) {
+		return 0;
+	}
+
+	//[1][1] is 1/tan(fovY/2), gives the projected diameter as a fraction of the screen height
+	const float screenHeight = gGraphics->GetDesiredSize().mHeight;
+	const float projectedSize = (radius / distance) * glm::abs(camera->GetProjMatrix()[1][1]) * screenHeight;
+
+	int selected = 0;
+	for(int i = 1; i < numLODs; i++) {
+		if(mesh.mLODs[i].mError * projectedSize > gModelLODPixelError) {
+			break;
+		}
+		selected = i;
 	}
+	return selected;
 }
 
 void Model::UpdateMaterials() {
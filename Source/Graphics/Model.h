@@ -8,6 +8,10 @@
 
 class Mesh;
 
+//each submesh draws its lowest lod whose simplification error covers fewer pixels than this on the main camera
+//0 always draws the full mesh
+extern float gModelLODPixelError;
+
 class Model {
 public:
 	void Destroy();
@@ -28,8 +32,12 @@ public:
 	glm::vec4 mColorOverride;
 	bool mOverrideColor = false;
 
+	//-1 picks from the main camera distance
+	int mForceLOD = -1;
+
 private:
 	void UpdateMaterials();
+	int SelectLOD(const Mesh* aMesh, int aMeshIndex, const glm::mat4& aWorld) const;
 
 	const Mesh* mMesh;
 	struct ModelMaterial {
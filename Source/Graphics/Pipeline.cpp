@@ -48,10 +48,8 @@ bool Pipeline::Create(VkRenderPass aPass, const char* aName /*= 0*/) {
 	{
 		LOGGER::Log("-- Pipeline Vertex Input needs work\n");
 		vertexInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		if(vertexBinding.stride != 0) {
-			vertexInfo.vertexBindingDescriptionCount = 1;
-			vertexInfo.pVertexBindingDescriptions = &vertexBinding;
-		}
+		vertexInfo.pVertexBindingDescriptions = vertexBindings.data();
+		vertexInfo.vertexBindingDescriptionCount = vertexBindings.size();
 		vertexInfo.pVertexAttributeDescriptions = vertexAttribute.data();
 		vertexInfo.vertexAttributeDescriptionCount = vertexAttribute.size();
 	}
@@ -48,7 +48,7 @@ public:
 	std::vector<Material> MakeMaterials(uint8_t aBinding) const;
 
 	//Temp
-	VkVertexInputBindingDescription vertexBinding = {};
+	std::vector<VkVertexInputBindingDescription> vertexBindings = {};
 	std::vector<VkVertexInputAttributeDescription> vertexAttribute = {};
 
 private:
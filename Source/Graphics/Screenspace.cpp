@@ -32,12 +32,8 @@ void Screenspace::Create(const FileIO::Path& aFragmentPath, const char* aName /*
 	mPipeline.Create(mRenderPass.GetRenderPass(), aName ? aName : "Unnamed Screenspace");
 
 	//duplicated data
-	mIndexBuffer.Create(BufferType::INDEX, sizeof(uint16_t) * 3, "Screenspace Index Buffer");
-	uint16_t* data = (uint16_t*)mIndexBuffer.Map();
-	data[0]		   = 0;
-	data[1]		   = 1;
-	data[2]		   = 2;
-	mIndexBuffer.UnMap();
+	const uint16_t indices[3] = {0, 1, 2};
+	mIndexBuffer.CreateFromData(BufferType::INDEX, sizeof(indices), indices, "Screenspace Index Buffer");
 
 	mMaterials = mPipeline.MakeMaterials(0);
 }
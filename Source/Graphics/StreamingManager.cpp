@@ -0,0 +1,240 @@
+#include "StreamingManager.h"
+
+#include <algorithm>
+
+#include <imgui/imgui.h>
+
+#include "PlatformDebug.h"
+#include "Graphics.h"
+#include "Mesh.h"
+#include "MaterialManager.h"
+#include "Engine/Engine.h"
+#include "Engine/Camera/Camera.h"
+
+void StreamingManager::Initalize() {
+	mFrame = 1;
+	mStats = Stats();
+}
+
+void StreamingManager::Destroy() {
+	std::unique_lock<std::mutex> lock(mLock);
+	//meshes are owned by whoever registered them, they destroy them
+	mEntries.clear();
+}
+
+void StreamingManager::ImGuiDraw() {
+	if(ImGui::Begin("Streaming")) {
+		std::unique_lock<std::mutex> lock(mLock);
+		ImGui::Text("%u meshes: %u loaded, %u loading, %u failed, %llu evicted", mStats.mRegistered, mStats.mLoaded, mStats.mLoading, mStats.mFailed,
+					(unsigned long long)mStats.mEvictions);
+
+		const auto BudgetBar = [](const char* aName, size_t aUsed, size_t aBudget) {
+			char buf[64];
+			if(aBudget == 0) {
+				sprintf(buf, "%s %.1f MB (no budget)", aName, aUsed / (1024.0f * 1024.0f));
+				ImGui::ProgressBar(0.0f, ImVec2(-1.f, 0.f), buf);
+			} else {
+				sprintf(buf, "%s %.1f/%.1f MB", aName, aUsed / (1024.0f * 1024.0f), aBudget / (1024.0f * 1024.0f));
+				ImGui::ProgressBar(aUsed / (float)aBudget, ImVec2(-1.f, 0.f), buf);
+			}
+		};
+		BudgetBar("CPU", mStats.mCPUBytes, mCPUBudget);
+		BudgetBar("GPU", mStats.mGPUBytes, mGPUBudget);
+
+		int cpuBudgetMB = mCPUBudget / (1024 * 1024);
+		if(ImGui::DragInt("CPU Budget (MB)", &cpuBudgetMB, 16.0f, 0, 64 * 1024)) {
+			mCPUBudget = (size_t)cpuBudgetMB * 1024 * 1024;
+		}
+		int gpuBudgetMB = mGPUBudget / (1024 * 1024);
+		if(ImGui::DragInt("GPU Budget (MB)", &gpuBudgetMB, 16.0f, 0, 64 * 1024)) {
+			mGPUBudget = (size_t)gpuBudgetMB * 1024 * 1024;
+		}
+		int maxLoads = mMaxLoadsInFlight;
+		if(ImGui::SliderInt("Loads in flight", &maxLoads, 1, 16)) {
+			mMaxLoadsInFlight = maxLoads;
+		}
+	}
+	ImGui::End();
+}
+
+void StreamingManager::Update() {
+	ZoneScoped;
+	std::unique_lock<std::mutex> lock(mLock);
+
+	const auto UpdateStats = [this]() {
+		mStats.mRegistered = mEntries.size();
+		mStats.mLoading = 0;
+		mStats.mLoaded = 0;
+		mStats.mFailed = 0;
+		mStats.mCPUBytes = 0;
+		mStats.mGPUBytes = gGraphics->GetMaterialManager()->GetTextureCacheStats().mBytes;
+		for(const auto& [mesh, entry]: mEntries) {
+			mStats.mLoading += entry.mState == State::LOADING;
+			mStats.mLoaded += entry.mState == State::LOADED;
+			mStats.mFailed += entry.mState == State::FAILED;
+			mStats.mCPUBytes += entry.mCPUBytes;
+			mStats.mGPUBytes += entry.mGPUBytes;
+		}
+	};
+
+	//loads that finished since last frame
+	//only waits for the load job, HasLoaded also waits on the textures and stays false if one of them fails
+	for(auto& [mesh, entry]: mEntries) {
+		if(entry.mState != State::LOADING || !entry.mMesh->HasLoadFinished()) {
+			continue;
+		}
+		if(entry.mMesh->GetNumMesh() == 0) {
+			LOGGER::Formated("Streaming: failed to load {}\n", entry.mFilePath.String());
+			//releases any textures it got before failing
+			entry.mMesh->Destroy();
+			entry.mState = State::FAILED;
+		} else {
+			entry.mState = State::LOADED;
+			const Mesh::MemoryStats memory = entry.mMesh->GetMemoryStats();
+			entry.mCPUBytes = memory.mCPUBytes;
+			entry.mGPUBytes = memory.mGPUBytes;
+		}
+	}
+	UpdateStats();
+
+	//least recently drawn first, anything drawn last frame is kept even if that leaves us over budget
+	while(IsOverBudget()) {
+		Entry* oldest = nullptr;
+		for(auto& [mesh, entry]: mEntries) {
+			if(entry.mState != State::LOADED || entry.mLastVisibleFrame == mFrame) {
+				continue;
+			}
+			if(oldest == nullptr || entry.mLastVisibleFrame < oldest->mLastVisibleFrame) {
+				oldest = &entry;
+			}
+		}
+		if(oldest == nullptr) {
+			break;
+		}
+		Evict(*oldest);
+		UpdateStats();
+	}
+
+	//biggest on screen first, sizes aren't known until loaded so the budget is only checked before starting
+	std::vector<Entry*> wanted;
+	for(auto& [mesh, entry]: mEntries) {
+		if(entry.mState == State::UNLOADED && entry.mLastVisibleFrame == mFrame) {
+			wanted.push_back(&entry);
+		}
+	}
+	std::sort(wanted.begin(), wanted.end(), [](const Entry* aLeft, const Entry* aRight) {
+		return aLeft->mPriority > aRight->mPriority;
+	});
+	for(int i = 0; i < wanted.size() && mStats.mLoading < mMaxLoadsInFlight && !IsOverBudget(); i++) {
+		Entry& entry = *wanted[i];
+		entry.mState = State::LOADING;
+		entry.mMesh->LoadMesh(entry.mFilePath, entry.mImagePath);
+		mStats.mLoading++;
+	}
+
+	//priorities are rebuilt by the next frame's MarkVisible calls
+	for(auto& [mesh, entry]: mEntries) {
+		entry.mPriority = 0.0f;
+	}
+	mFrame++;
+}
+
+void StreamingManager::Register(Mesh* aMesh, const FileIO::Path& aFilePath, const FileIO::Path& aImagePath, float aRadius) {
+	std::unique_lock<std::mutex> lock(mLock);
+	ASSERT(mEntries.find(aMesh) == mEntries.end());
+	Entry& entry = mEntries[aMesh];
+	entry.mMesh = aMesh;
+	entry.mFilePath = aFilePath;
+	entry.mImagePath = aImagePath;
+	entry.mRadius = aRadius;
+}
+
+void StreamingManager::Unregister(Mesh* aMesh) {
+	std::unique_lock<std::mutex> lock(mLock);
+	mEntries.erase(aMesh);
+}
+
+void StreamingManager::MarkVisible(const Mesh* aMesh, const glm::mat4& aWorld) {
+	std::unique_lock<std::mutex> lock(mLock);
+	auto result = mEntries.find(aMesh);
+	if(result == mEntries.end()) {
+		return;
+	}
+	Entry& entry = result->second;
+
+	//model origin and the registered radius until the mesh's bounds are known
+	glm::vec3 center = glm::vec3(aWorld[3]);
+	float radius = entry.mRadius;
+	const AABB& aabb = aMesh->GetAABB();
+	if(entry.mState == State::LOADED && aabb.mMin.x <= aabb.mMax.x) {
+		center = glm::vec3(aWorld * glm::vec4((aabb.mMin + aabb.mMax) * 0.5f, 1.0f));
+		radius = glm::length(aabb.mMax - aabb.mMin) * 0.5f;
+	}
+	const float scale = glm::max(glm::length(glm::vec3(aWorld[0])), glm::max(glm::length(glm::vec3(aWorld[1])), glm::length(glm::vec3(aWorld[2]))));
+	radius *= scale;
+
+	//rendered but off screen, leave it to be evicted
+	if(!IsInView(center, radius)) {
+		return;
+	}
+	entry.mPriority = glm::max(entry.mPriority, GetScreenSize(center, radius));
+	entry.mLastVisibleFrame = mFrame;
+}
+
+//static
+bool StreamingManager::IsInView(const glm::vec3& aCenter, float aRadius) {
+	Camera* camera = gEngine->GetMainCamera();
+	if(camera == nullptr) {
+		return true;
+	}
+	//frustum planes from the rows of the view projection, pointing inwards
+	//vulkan depth is 0-1 so near is just the third row
+	const glm::mat4 viewProj = glm::transpose(camera->GetViewProjMatrix());
+	const glm::vec4 planes[6] = {
+		viewProj[3] + viewProj[0],
+		viewProj[3] - viewProj[0],
+		viewProj[3] + viewProj[1],
+		viewProj[3] - viewProj[1],
+		viewProj[2],
+		viewProj[3] - viewProj[2],
+	};
+	for(int i = 0; i < 6; i++) {
+		const float length = glm::length(glm::vec3(planes[i]));
+		if(glm::dot(glm::vec3(planes[i]), aCenter) + planes[i].w < -aRadius * length) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//static
+float StreamingManager::GetScreenSize(const glm::vec3& aCenter, float aRadius) {
+	Camera* camera = gEngine->GetMainCamera();
+	if(camera == nullptr) {
+		return aRadius;
+	}
+	const float distance = glm::length(aCenter - camera->GetTransform().GetWorldPosition());
+	const float screenHeight = gGraphics->GetDesiredSize().mHeight;
+	//inside the bounds, covers the screen
+	if(distance <= aRadius) {
+		return screenHeight;
+	}
+	//same as Model::SelectLOD, [1][1] is 1/tan(fovY/2)
+	return (aRadius / distance) * glm::abs(camera->GetProjMatrix()[1][1]) * screenHeight;
+}
+
+bool StreamingManager::IsOverBudget() const {
+	return (mCPUBudget != 0 && mStats.mCPUBytes > mCPUBudget) || (mGPUBudget != 0 && mStats.mGPUBytes > mGPUBudget);
+}
+
+void StreamingManager::Evict(Entry& aEntry) {
+	ZoneScoped;
+	ASSERT(aEntry.mState == State::LOADED);
+	LOGGER::Formated("Streaming: unloading {}\n", aEntry.mFilePath.String());
+	//releases its textures too, shared ones stay loaded for the other meshes
+	aEntry.mMesh->Destroy();
+	aEntry.mState = State::UNLOADED;
+	aEntry.mCPUBytes = 0;
+	aEntry.mGPUBytes = 0;
+	mStats.mEvictions++;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "Engine/FileIO.h"
+
+class Mesh;
+
+//loads registered meshes when they are drawn, biggest on the main camera first
+//a few loads are in flight at a time so the ones queued later don't wait behind the whole scene,
+//a mesh's textures are queued by its loader so they follow the same order
+//when the cpu/gpu budget is exceeded the meshes that haven't been drawn for the longest are unloaded
+//meshes are still owned by whoever registered them
+
+class StreamingManager {
+public:
+	void Initalize();
+	void Destroy();
+
+	void ImGuiDraw();
+
+	//once a frame, before rendering
+	//finishes loads, evicts over the budget then starts the next loads
+	void Update();
+
+	//aMesh is loaded from aFilePath once it's drawn, and can be unloaded again when over budget
+	//aRadius is used for the priority until the mesh has loaded and its own bounds are known
+	void Register(Mesh* aMesh, const FileIO::Path& aFilePath, const FileIO::Path& aImagePath = "", float aRadius = 1.0f);
+	//stops streaming aMesh, it's left as it is
+	void Unregister(Mesh* aMesh);
+
+	//called by Model::Render for every drawn mesh, aWorld is the model's world matrix. unregistered meshes are ignored
+	//only counts as visible when its bounds are inside the main camera's frustum
+	void MarkVisible(const Mesh* aMesh, const glm::mat4& aWorld);
+
+	//0 for no limit
+	size_t mCPUBudget = 1024ull * 1024 * 1024;
+	//includes every texture in the MaterialManager's cache
+	size_t mGPUBudget = 2048ull * 1024 * 1024;
+	uint32_t mMaxLoadsInFlight = 2;
+
+	struct Stats {
+		uint32_t mRegistered = 0;
+		uint32_t mLoading = 0;
+		uint32_t mLoaded = 0;
+		uint32_t mFailed = 0;
+		uint64_t mEvictions = 0;
+		size_t mCPUBytes = 0;
+		size_t mGPUBytes = 0;
+	};
+	const Stats& GetStats() const {
+		return mStats;
+	}
+
+private:
+	enum class State
+	{
+		UNLOADED,
+		LOADING,
+		LOADED,
+		//the load left it without any submeshes, not tried again until it's registered again
+		FAILED
+	};
+	struct Entry {
+		Mesh* mMesh;
+		FileIO::Path mFilePath;
+		FileIO::Path mImagePath;
+		float mRadius;
+		State mState = State::UNLOADED;
+
+		//from the last MarkVisible inside the frustum
+		uint32_t mLastVisibleFrame = 0;
+		//projected size in pixels, the biggest of the models drawing it this frame
+		float mPriority = 0.0f;
+		//set once loaded
+		size_t mCPUBytes = 0;
+		size_t mGPUBytes = 0;
+	};
+
+	//projected diameter on the main camera in pixels
+	static float GetScreenSize(const glm::vec3& aCenter, float aRadius);
+	//the sphere is at least partly inside the main camera's frustum
+	static bool IsInView(const glm::vec3& aCenter, float aRadius);
+	bool IsOverBudget() const;
+	void Evict(Entry& aEntry);
+
+	std::unordered_map<const Mesh*, Entry> mEntries;
+	//MarkVisible can come from other threads than Update
+	mutable std::mutex mLock;
+
+	uint32_t mFrame = 1;
+	Stats mStats;
+};
@@ -0,0 +1,513 @@
+#include "TextureCompress.h"
+
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#define STB_DXT_IMPLEMENTATION
+#include "stb_dxt.h"
+#include "stb_image.h"
+
+#include "PlatformDebug.h"
+#include "Engine/Job.h"
+#include "Engine/FileIO.h"
+#include "Graphics/Helpers.h"
+
+namespace TextureCompress {
+
+	//bc7's 4 bit interpolation weights, out of 64
+	static const int cWeights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	//dxgi formats for the dds dx10 header, the same ones DDSLoader reads
+	static const uint32_t cDXGIFormatBC5Unorm = 83;
+	static const uint32_t cDXGIFormatBC7Unorm = 98;
+
+	//blocks in a single job
+	static const uint32_t cBlocksPerJob = 4096;
+
+	const char* GetFormatName(Format aFormat) {
+		switch(aFormat) {
+			case Format::BC7:
+				return "BC7";
+			case Format::BC5:
+				return "BC5";
+		}
+		ASSERT(false);
+		return "";
+	}
+
+	//7 bit endpoint and the p bit shared by its channels, the decoded channel is (q << 1) | p
+	static uint32_t QuantizeEndpoint(const float aEndpoint[4], uint8_t aQuantized[4], uint32_t& aPBit) {
+		float bestError = FLT_MAX;
+		for(uint32_t p = 0; p < 2; p++) {
+			uint8_t quantized[4];
+			float error = 0.0f;
+			for(int c = 0; c < 4; c++) {
+				const int value = std::clamp((int)std::lround((aEndpoint[c] - p) * 0.5f), 0, 127);
+				quantized[c] = value;
+				const float diff = (float)((value << 1) | p) - aEndpoint[c];
+				error += diff * diff;
+			}
+			if(error < bestError) {
+				bestError = error;
+				memcpy(aQuantized, quantized, 4);
+				aPBit = p;
+			}
+		}
+		return (uint32_t)bestError;
+	}
+
+	//closest of the 16 interpolated colors for each pixel, returns the squared error of the block
+	static uint32_t FindIndices(const uint8_t* aPixels, const uint8_t aQuantized0[4], uint32_t aPBit0, const uint8_t aQuantized1[4], uint32_t aPBit1,
+								uint8_t aIndices[16]) {
+		int palette[16][4];
+		for(int c = 0; c < 4; c++) {
+			const int endpoint0 = (aQuantized0[c] << 1) | aPBit0;
+			const int endpoint1 = (aQuantized1[c] << 1) | aPBit1;
+			for(int i = 0; i < 16; i++) {
+				palette[i][c] = ((64 - cWeights4[i]) * endpoint0 + cWeights4[i] * endpoint1 + 32) >> 6;
+			}
+		}
+		uint32_t totalError = 0;
+		for(int p = 0; p < 16; p++) {
+			const uint8_t* pixel = aPixels + p * 4;
+			uint32_t bestError = UINT32_MAX;
+			for(int i = 0; i < 16; i++) {
+				uint32_t error = 0;
+				for(int c = 0; c < 4; c++) {
+					const int diff = palette[i][c] - pixel[c];
+					error += diff * diff;
+				}
+				if(error < bestError) {
+					bestError = error;
+					aIndices[p] = i;
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	void CompressBlockBC7(const uint8_t* aPixels, uint8_t* aBlock) {
+		//mode 6, the block's colors are fitted to a line through its principal axis
+		float mean[4] = {};
+		for(int p = 0; p < 16; p++) {
+			for(int c = 0; c < 4; c++) {
+				mean[c] += aPixels[p * 4 + c];
+			}
+		}
+		for(int c = 0; c < 4; c++) {
+			mean[c] /= 16.0f;
+		}
+		float covariance[4][4] = {};
+		for(int p = 0; p < 16; p++) {
+			float diff[4];
+			for(int c = 0; c < 4; c++) {
+				diff[c] = aPixels[p * 4 + c] - mean[c];
+			}
+			for(int a = 0; a < 4; a++) {
+				for(int b = 0; b < 4; b++) {
+					covariance[a][b] += diff[a] * diff[b];
+				}
+			}
+		}
+		//power iteration, a few steps is plenty for a 4x4
+		float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+		for(int iteration = 0; iteration < 8; iteration++) {
+			float next[4] = {};
+			for(int a = 0; a < 4; a++) {
+				for(int b = 0; b < 4; b++) {
+					next[a] += covariance[a][b] * axis[b];
+				}
+			}
+			float length = 0.0f;
+			for(int c = 0; c < 4; c++) {
+				length += next[c] * next[c];
+			}
+			length = std::sqrt(length);
+			if(length < 1e-6f) {
+				break;
+			}
+			for(int c = 0; c < 4; c++) {
+				axis[c] = next[c] / length;
+			}
+		}
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		for(int p = 0; p < 16; p++) {
+			float t = 0.0f;
+			for(int c = 0; c < 4; c++) {
+				t += (aPixels[p * 4 + c] - mean[c]) * axis[c];
+			}
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		float endpoints[2][4];
+		for(int c = 0; c < 4; c++) {
+			endpoints[0][c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+			endpoints[1][c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+		}
+
+		uint8_t quantized[2][4];
+		uint32_t pBits[2];
+		QuantizeEndpoint(endpoints[0], quantized[0], pBits[0]);
+		QuantizeEndpoint(endpoints[1], quantized[1], pBits[1]);
+		uint8_t indices[16];
+		uint32_t error = FindIndices(aPixels, quantized[0], pBits[0], quantized[1], pBits[1], indices);
+
+		//least squares fit of the endpoints to the chosen indices, kept while it lowers the error
+		for(int iteration = 0; iteration < 2 && error > 0; iteration++) {
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ax[4] = {}, bx[4] = {};
+			for(int p = 0; p < 16; p++) {
+				const float b = cWeights4[indices[p]] / 64.0f;
+				const float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for(int c = 0; c < 4; c++) {
+					ax[c] += a * aPixels[p * 4 + c];
+					bx[c] += b * aPixels[p * 4 + c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if(std::abs(det) < 1e-6f) {
+				break;
+			}
+			float refined[2][4];
+			for(int c = 0; c < 4; c++) {
+				refined[0][c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+				refined[1][c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+			}
+			uint8_t refinedQuantized[2][4];
+			uint32_t refinedPBits[2];
+			QuantizeEndpoint(refined[0], refinedQuantized[0], refinedPBits[0]);
+			QuantizeEndpoint(refined[1], refinedQuantized[1], refinedPBits[1]);
+			uint8_t refinedIndices[16];
+			const uint32_t refinedError = FindIndices(aPixels, refinedQuantized[0], refinedPBits[0], refinedQuantized[1], refinedPBits[1], refinedIndices);
+			if(refinedError >= error) {
+				break;
+			}
+			error = refinedError;
+			memcpy(quantized, refinedQuantized, sizeof(quantized));
+			memcpy(pBits, refinedPBits, sizeof(pBits));
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+
+		//the first index is stored without its top bit, swapping the endpoints flips it below 8
+		if(indices[0] >= 8) {
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for(int p = 0; p < 16; p++) {
+				indices[p] = 15 - indices[p];
+			}
+		}
+
+		memset(aBlock, 0, 16);
+		uint32_t bit = 0;
+		const auto Write = [&](uint32_t aValue, uint32_t aBits) {
+			for(uint32_t i = 0; i < aBits; i++, bit++) {
+				aBlock[bit >> 3] |= ((aValue >> i) & 1) << (bit & 7);
+			}
+		};
+		Write(1 << 6, 7);
+		for(int c = 0; c < 4; c++) {
+			Write(quantized[0][c], 7);
+			Write(quantized[1][c], 7);
+		}
+		Write(pBits[0], 1);
+		Write(pBits[1], 1);
+		Write(indices[0], 3);
+		for(int p = 1; p < 16; p++) {
+			Write(indices[p], 4);
+		}
+		ASSERT(bit == 128);
+	}
+
+	void CompressBlockBC5(const uint8_t* aPixels, uint8_t* aBlock) {
+		uint8_t redGreen[32];
+		for(int p = 0; p < 16; p++) {
+			redGreen[p * 2 + 0] = aPixels[p * 4 + 0];
+			redGreen[p * 2 + 1] = aPixels[p * 4 + 1];
+		}
+		stb_compress_bc5_block(aBlock, redGreen);
+	}
+
+	//2x2 box filter, odd edges reuse the last row/column. normals are renormalized
+	static void Downsample(const uint8_t* aSource, uint32_t aWidth, uint32_t aHeight, uint8_t* aDest, uint32_t aDestWidth, uint32_t aDestHeight, Format aFormat) {
+		for(uint32_t y = 0; y < aDestHeight; y++) {
+			const uint32_t y0 = std::min(y * 2, aHeight - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, aHeight - 1);
+			for(uint32_t x = 0; x < aDestWidth; x++) {
+				const uint32_t x0 = std::min(x * 2, aWidth - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, aWidth - 1);
+				const uint8_t* samples[4] = {aSource + (y0 * aWidth + x0) * 4,
+											 aSource + (y0 * aWidth + x1) * 4,
+											 aSource + (y1 * aWidth + x0) * 4,
+											 aSource + (y1 * aWidth + x1) * 4};
+				uint8_t* dest = aDest + (y * aDestWidth + x) * 4;
+				for(int c = 0; c < 4; c++) {
+					dest[c] = (samples[0][c] + samples[1][c] + samples[2][c] + samples[3][c] + 2) / 4;
+				}
+				if(aFormat == Format::BC5) {
+					float normal[3];
+					float length = 0.0f;
+					for(int c = 0; c < 3; c++) {
+						normal[c] = dest[c] / 127.5f - 1.0f;
+						length += normal[c] * normal[c];
+					}
+					length = std::sqrt(length);
+					if(length > 1e-4f) {
+						for(int c = 0; c < 3; c++) {
+							dest[c] = (uint8_t)std::clamp(std::lround((normal[c] / length + 1.0f) * 127.5f), 0l, 255l);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void CompressImage(const uint8_t* aPixels, uint32_t aWidth, uint32_t aHeight, Format aFormat, std::vector<uint8_t>& aOutput, uint32_t& aMipLevels) {
+		ZoneScoped;
+		struct Level {
+			const uint8_t* mPixels;
+			uint32_t mWidth;
+			uint32_t mHeight;
+			size_t mOffset;
+		};
+		std::vector<Level> levels;
+		//every level past the first is owned here
+		std::vector<std::vector<uint8_t>> mipPixels;
+		size_t outputSize = 0;
+		{
+			ZoneScopedN("Mips");
+			uint32_t width = aWidth;
+			uint32_t height = aHeight;
+			const uint8_t* pixels = aPixels;
+			while(true) {
+				levels.push_back({pixels, width, height, outputSize});
+				outputSize += ((width + 3) / 4) * ((height + 3) / 4) * 16;
+				if(width == 1 && height == 1) {
+					break;
+				}
+				const uint32_t nextWidth = std::max(width / 2, 1u);
+				const uint32_t nextHeight = std::max(height / 2, 1u);
+				mipPixels.emplace_back((size_t)nextWidth * nextHeight * 4);
+				Downsample(pixels, width, height, mipPixels.back().data(), nextWidth, nextHeight, aFormat);
+				pixels = mipPixels.back().data();
+				width = nextWidth;
+				height = nextHeight;
+			}
+		}
+		aOutput.resize(outputSize);
+		aMipLevels = levels.size();
+
+		//runs of blocks, the small mips share a job with each other
+		struct Range {
+			uint32_t mLevel;
+			uint32_t mFirstBlock;
+			uint32_t mNumBlocks;
+		};
+		std::vector<Range> ranges;
+		for(uint32_t i = 0; i < levels.size(); i++) {
+			const uint32_t numBlocks = ((levels[i].mWidth + 3) / 4) * ((levels[i].mHeight + 3) / 4);
+			for(uint32_t first = 0; first < numBlocks; first += cBlocksPerJob) {
+				ranges.push_back({i, first, std::min(cBlocksPerJob, numBlocks - first)});
+			}
+		}
+
+		uint8_t* output = aOutput.data();
+		const auto CompressRange = [&levels, output, aFormat](const Range& aRange) {
+			const Level& level = levels[aRange.mLevel];
+			const uint32_t blocksWide = (level.mWidth + 3) / 4;
+			uint8_t pixels[16 * 4];
+			for(uint32_t block = aRange.mFirstBlock; block < aRange.mFirstBlock + aRange.mNumBlocks; block++) {
+				const uint32_t blockX = (block % blocksWide) * 4;
+				const uint32_t blockY = (block / blocksWide) * 4;
+				//partial blocks repeat the edge pixels
+				for(uint32_t y = 0; y < 4; y++) {
+					const uint32_t sourceY = std::min(blockY + y, level.mHeight - 1);
+					for(uint32_t x = 0; x < 4; x++) {
+						const uint32_t sourceX = std::min(blockX + x, level.mWidth - 1);
+						memcpy(pixels + (y * 4 + x) * 4, level.mPixels + ((size_t)sourceY * level.mWidth + sourceX) * 4, 4);
+					}
+				}
+				uint8_t* dest = output + level.mOffset + (size_t)block * 16;
+				if(aFormat == Format::BC7) {
+					CompressBlockBC7(pixels, dest);
+				} else {
+					CompressBlockBC5(pixels, dest);
+				}
+			}
+		};
+
+		{
+			ZoneScopedN("Compress");
+			std::vector<Job::Work> work(ranges.size() > 0 ? ranges.size() - 1 : 0);
+			for(int i = 0; i < work.size(); i++) {
+				work[i].mWorkPtr = [&ranges, &CompressRange, i](void*) {
+					ZoneScopedN("Compress Blocks");
+					CompressRange(ranges[i + 1]);
+				};
+			}
+			std::vector<Job::WorkHandle*> handles = Job::QueueWorkHandle(work);
+			if(ranges.size() > 0) {
+				CompressRange(ranges[0]);
+			}
+			for(int i = 0; i < handles.size(); i++) {
+				Job::WaitForWork(handles[i]);
+				handles[i]->Reset();
+			}
+		}
+	}
+
+	bool CanCompress(const std::string& aSourcePath) {
+		const std::string extension = str_tolower(std::filesystem::path(aSourcePath).extension().generic_string());
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+	}
+
+	Format SelectFormat(const std::string& aSourcePath) {
+		const std::string name = str_tolower(std::filesystem::path(aSourcePath).filename().generic_string());
+		for(const char* hint: {"normal", "_nrm", "_ddn", "_n."}) {
+			if(name.find(hint) != std::string::npos) {
+				return Format::BC5;
+			}
+		}
+		return Format::BC7;
+	}
+
+	std::string GetCachePath(const std::string& aSourcePath) {
+		return aSourcePath + ".dds";
+	}
+
+	bool IsCacheValid(const std::string& aSourcePath) {
+		std::error_code error;
+		const auto sourceTime = std::filesystem::last_write_time(aSourcePath, error);
+		if(error) {
+			return false;
+		}
+		const auto cacheTime = std::filesystem::last_write_time(GetCachePath(aSourcePath), error);
+		return !error && cacheTime >= sourceTime;
+	}
+
+	//dds header with the dx10 extension, what DDSLoader expects
+	static std::vector<uint8_t> MakeDDSHeader(uint32_t aWidth, uint32_t aHeight, uint32_t aMipLevels, Format aFormat, size_t aTopLevelSize) {
+		uint32_t header[32 + 5] = {};
+		header[0] = 'D' | 'D' << 8 | 'S' << 16 | ' ' << 24;
+		header[1] = 124; //size
+		header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; //caps, height, width, pixelformat, mipcount, linearsize
+		header[3] = aHeight;
+		header[4] = aWidth;
+		header[5] = aTopLevelSize;
+		header[7] = aMipLevels;
+		header[19] = 32; //pixel format size
+		header[20] = 0x4; //fourcc
+		header[21] = 'D' | 'X' << 8 | '1' << 16 | '0' << 24;
+		header[27] = 0x1000 | 0x8 | 0x400000; //texture, complex, mipmap
+		header[32] = aFormat == Format::BC7 ? cDXGIFormatBC7Unorm : cDXGIFormatBC5Unorm;
+		header[33] = 3; //TEXTURE2D
+		header[35] = 1; //array size
+		std::vector<uint8_t> data(sizeof(header));
+		memcpy(data.data(), header, sizeof(header));
+		return data;
+	}
+
+	ImportResult ImportTexture(const std::string& aSourcePath, bool aForce) {
+		ZoneScoped;
+		ZoneText(aSourcePath.c_str(), aSourcePath.size());
+		ImportResult result;
+		result.mSourcePath = aSourcePath;
+		result.mFormat = SelectFormat(aSourcePath);
+		std::error_code error;
+		result.mSourceBytes = std::filesystem::file_size(aSourcePath, error);
+		if(!aForce && IsCacheValid(aSourcePath)) {
+			result.mSkipped = true;
+			result.mCompressedBytes = std::filesystem::file_size(GetCachePath(aSourcePath), error);
+			return result;
+		}
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		int width, height, comp;
+		stbi_uc* pixels = stbi_load(aSourcePath.c_str(), &width, &height, &comp, STBI_rgb_alpha);
+		if(pixels == nullptr) {
+			LOGGER::Formated("Texture import: can't decode {}, {}\n", aSourcePath, stbi_failure_reason());
+			result.mFailed = true;
+			return result;
+		}
+		auto endTime = std::chrono::high_resolution_clock::now();
+		result.mDecodeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+		startTime = std::chrono::high_resolution_clock::now();
+		std::vector<uint8_t> blocks;
+		uint32_t mipLevels;
+		CompressImage(pixels, width, height, result.mFormat, blocks, mipLevels);
+		endTime = std::chrono::high_resolution_clock::now();
+		result.mCompressMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		stbi_image_free(pixels);
+
+		for(uint32_t i = 0; i < mipLevels; i++) {
+			result.mUncompressedBytes += (size_t)std::max(width >> i, 1) * std::max(height >> i, 1) * 4;
+		}
+
+		std::vector<uint8_t> file = MakeDDSHeader(width, height, mipLevels, result.mFormat, ((width + 3) / 4) * ((height + 3) / 4) * 16);
+		file.insert(file.end(), blocks.begin(), blocks.end());
+		result.mCompressedBytes = file.size();
+		result.mFailed = !FileIO::SaveFile(GetCachePath(aSourcePath), file.data(), file.size());
+		return result;
+	}
+
+	std::vector<ImportResult> ImportFolder(const std::string& aFolder, bool aForce) {
+		ZoneScoped;
+		std::vector<std::string> sources;
+		std::error_code error;
+		for(const auto& entry: std::filesystem::recursive_directory_iterator(aFolder, error)) {
+			if(entry.is_regular_file() && CanCompress(entry.path().generic_string())) {
+				sources.push_back(entry.path().generic_string());
+			}
+		}
+		if(error) {
+			LOGGER::Formated("Texture import: can't read {}, {}\n", aFolder, error.message());
+		}
+		std::sort(sources.begin(), sources.end());
+		LOGGER::Formated("Texture import: {} textures from {}{}\n", sources.size(), aFolder, aForce ? " (forced)" : "");
+
+		std::vector<ImportResult> results;
+		for(int i = 0; i < sources.size(); i++) {
+			results.push_back(ImportTexture(sources[i], aForce));
+		}
+
+		LOGGER::Log(" decode ms | compress ms | source KB |  rgba KB | compressed KB | format | texture\n");
+		size_t sourceBytes = 0;
+		size_t uncompressedBytes = 0;
+		size_t compressedBytes = 0;
+		double totalMs = 0.0;
+		for(int i = 0; i < results.size(); i++) {
+			const ImportResult& result = results[i];
+			char line[128];
+			snprintf(line,
+					 sizeof(line),
+					 "%10.2f | %11.2f | %9zu | %8zu | %13zu | %6s | ",
+					 result.mDecodeMs,
+					 result.mCompressMs,
+					 result.mSourceBytes / 1024,
+					 result.mUncompressedBytes / 1024,
+					 result.mCompressedBytes / 1024,
+					 GetFormatName(result.mFormat));
+			LOGGER::Formated("{}{}{}\n", line, result.mSourcePath, result.mFailed ? " (failed)" : result.mSkipped ? " (up to date)" : "");
+			sourceBytes += result.mSourceBytes;
+			uncompressedBytes += result.mUncompressedBytes;
+			compressedBytes += result.mCompressedBytes;
+			totalMs += result.mDecodeMs + result.mCompressMs;
+		}
+		LOGGER::Formated("Texture import: {} ms, source {} KB, rgba {} KB, compressed {} KB\n",
+						 totalMs,
+						 sourceBytes / 1024,
+						 uncompressedBytes / 1024,
+						 compressedBytes / 1024);
+		return results;
+	}
+
+}; // namespace TextureCompress
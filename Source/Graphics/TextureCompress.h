@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//offline block compression for png/jpg textures, the result is written to a dds next to the source
+//Image::LoadImage picks that up instead of decoding the source while it's newer than the source
+//color textures are BC7 (mode 6 only, one rgba line per block) and normal maps BC5, chosen by file name
+//GraphicsPlayground -compress-textures [-assets folder] [-force]
+
+namespace TextureCompress {
+	enum class Format {
+		BC7,
+		//red/green only, the normal's z has to be rebuilt when sampled
+		BC5,
+	};
+	const char* GetFormatName(Format aFormat);
+
+	//16 rgba pixels, row by row, into one 16 byte block
+	void CompressBlockBC7(const uint8_t* aPixels, uint8_t* aBlock);
+	void CompressBlockBC5(const uint8_t* aPixels, uint8_t* aBlock);
+
+	//aPixels is aWidth x aHeight rgba, every mip down to 1x1 is box filtered and compressed, largest first
+	//blocks are split across the job threads, aOutput is resized to fit
+	void CompressImage(const uint8_t* aPixels, uint32_t aWidth, uint32_t aHeight, Format aFormat, std::vector<uint8_t>& aOutput, uint32_t& aMipLevels);
+
+	//png/jpg, the formats that can be compressed
+	bool CanCompress(const std::string& aSourcePath);
+	//names with normal/_nrm/_ddn/_n. are normal maps
+	Format SelectFormat(const std::string& aSourcePath);
+	std::string GetCachePath(const std::string& aSourcePath);
+	//the cache exists and was written after the source last changed
+	bool IsCacheValid(const std::string& aSourcePath);
+
+	struct ImportResult {
+		std::string mSourcePath;
+		Format mFormat;
+		bool mFailed = false;
+		bool mSkipped = false;
+		double mDecodeMs = 0.0;
+		double mCompressMs = 0.0;
+		size_t mSourceBytes = 0;
+		//the same mip chain as rgba8
+		size_t mUncompressedBytes = 0;
+		size_t mCompressedBytes = 0;
+	};
+	//decodes, compresses and writes the cache for one texture, skipped if the cache is already valid unless aForce
+	ImportResult ImportTexture(const std::string& aSourcePath, bool aForce);
+	//every png/jpg under aFolder, one texture at a time, then logs a size/time report
+	//needs the job system
+	std::vector<ImportResult> ImportFolder(const std::string& aFolder, bool aForce);
+}; // namespace TextureCompress
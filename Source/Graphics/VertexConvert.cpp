@@ -0,0 +1,289 @@
+#include "VertexConvert.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <glm/gtc/packing.hpp>
+
+#include "PlatformDebug.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define VERTEX_CONVERT_SSE2 1
+#	include <emmintrin.h>
+#else
+#	define VERTEX_CONVERT_SSE2 0
+#endif
+
+namespace VertexConvert {
+
+	uint32_t GetFormatSize(Format aFormat) {
+		switch(aFormat) {
+			case Format::FLOAT:
+				return 4;
+			case Format::HALF:
+			case Format::UNORM16:
+			case Format::SNORM16:
+			case Format::UINT16:
+			case Format::SINT16:
+				return 2;
+			case Format::UNORM8:
+			case Format::SNORM8:
+			case Format::UINT8:
+			case Format::SINT8:
+				return 1;
+		}
+		ASSERT(false);
+		return 0;
+	}
+
+	static float DecodeComponent(const uint8_t* aElement, Format aFormat, uint32_t aIndex) {
+		switch(aFormat) {
+			case Format::FLOAT: {
+				float value;
+				memcpy(&value, aElement + aIndex * sizeof(float), sizeof(float));
+				return value;
+			}
+			case Format::HALF: {
+				uint16_t value;
+				memcpy(&value, aElement + aIndex * sizeof(uint16_t), sizeof(uint16_t));
+				return glm::unpackHalf1x16(value);
+			}
+			case Format::UNORM8:
+				return aElement[aIndex] * (1.0f / 255.0f);
+			case Format::UNORM16: {
+				uint16_t value;
+				memcpy(&value, aElement + aIndex * sizeof(uint16_t), sizeof(uint16_t));
+				return value * (1.0f / 65535.0f);
+			}
+			case Format::SNORM8:
+				return std::max((int8_t)aElement[aIndex] * (1.0f / 127.0f), -1.0f);
+			case Format::SNORM16: {
+				int16_t value;
+				memcpy(&value, aElement + aIndex * sizeof(int16_t), sizeof(int16_t));
+				return std::max(value * (1.0f / 32767.0f), -1.0f);
+			}
+			case Format::UINT8:
+				return (float)aElement[aIndex];
+			case Format::UINT16: {
+				uint16_t value;
+				memcpy(&value, aElement + aIndex * sizeof(uint16_t), sizeof(uint16_t));
+				return (float)value;
+			}
+			case Format::SINT8:
+				return (float)(int8_t)aElement[aIndex];
+			case Format::SINT16: {
+				int16_t value;
+				memcpy(&value, aElement + aIndex * sizeof(int16_t), sizeof(int16_t));
+				return (float)value;
+			}
+		}
+		ASSERT(false);
+		return 0.0f;
+	}
+
+	void ConvertToFloatScalar(const Stream& aSource, float* aDest, uint32_t aDestStride, uint32_t aDestComponents, size_t aCount, const glm::vec4& aDefault) {
+		ASSERT(aSource.mComponents >= 1 && aSource.mComponents <= 4 && aDestComponents >= 1 && aDestComponents <= 4);
+		const uint8_t* source = (const uint8_t*)aSource.mData;
+		uint8_t* dest = (uint8_t*)aDest;
+		const uint32_t numComponents = std::min(aSource.mComponents, aDestComponents);
+		for(size_t i = 0; i < aCount; i++) {
+			const uint8_t* element = source + i * aSource.mStride;
+			float values[4] = {aDefault.x, aDefault.y, aDefault.z, aDefault.w};
+			for(uint32_t c = 0; c < numComponents; c++) {
+				values[c] = DecodeComponent(element, aSource.mFormat, c);
+			}
+			memcpy(dest + i * aDestStride, values, aDestComponents * sizeof(float));
+		}
+	}
+
+#if VERTEX_CONVERT_SSE2
+	//bytes each Load reads, can be more than the element
+	static uint32_t GetLoadSize(Format aFormat) {
+		switch(GetFormatSize(aFormat)) {
+			case 4:
+				return 16;
+			case 2:
+				return 8;
+			default:
+				return 4;
+		}
+	}
+
+	static inline __m128i LoadInt32(const uint8_t* aSource) {
+		int32_t value;
+		memcpy(&value, aSource, sizeof(int32_t));
+		return _mm_cvtsi32_si128(value);
+	}
+
+	//https://gist.github.com/rygorous/2156668, half_to_float_fast4 done 4 wide
+	//denormal halves are rebuilt with a subtract of normal floats, multiplying them in as float denormals is very slow
+	static inline __m128 HalfToFloat(__m128i aHalf) {
+		const __m128i maskNoSign = _mm_set1_epi32(0x7fff);
+		const __m128i shiftedExp = _mm_set1_epi32(0x7c00 << 13);
+		const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+
+		const __m128i expMantissa = _mm_and_si128(aHalf, maskNoSign);
+		const __m128i sign = _mm_slli_epi32(_mm_xor_si128(aHalf, expMantissa), 16);
+		__m128i result = _mm_slli_epi32(expMantissa, 13);
+		const __m128i exponent = _mm_and_si128(result, shiftedExp);
+		result = _mm_add_epi32(result, _mm_set1_epi32((127 - 15) << 23));
+		//inf/nan keep the max exponent
+		const __m128i isInfNan = _mm_cmpeq_epi32(exponent, shiftedExp);
+		result = _mm_add_epi32(result, _mm_and_si128(isInfNan, _mm_set1_epi32((128 - 16) << 23)));
+		const __m128 isZeroDenormal = _mm_castsi128_ps(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()));
+		const __m128 denormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(result, _mm_set1_epi32(1 << 23))), magic);
+		const __m128 value = _mm_or_ps(_mm_and_ps(isZeroDenormal, denormal), _mm_andnot_ps(isZeroDenormal, _mm_castsi128_ps(result)));
+		return _mm_or_ps(value, _mm_castsi128_ps(sign));
+	}
+
+	//4 lanes, anything past the source's components is whatever came after it
+	template<Format F>
+	static inline __m128 Load(const uint8_t* aSource) {
+		const __m128i zero = _mm_setzero_si128();
+		if constexpr(F == Format::FLOAT) {
+			return _mm_loadu_ps((const float*)aSource);
+		} else if constexpr(F == Format::HALF) {
+			return HalfToFloat(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)aSource), zero));
+		} else if constexpr(F == Format::UNORM8 || F == Format::UINT8) {
+			const __m128i bytes = LoadInt32(aSource);
+			const __m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+			return F == Format::UNORM8 ? _mm_mul_ps(value, _mm_set1_ps(1.0f / 255.0f)) : value;
+		} else if constexpr(F == Format::UNORM16 || F == Format::UINT16) {
+			const __m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)aSource), zero));
+			return F == Format::UNORM16 ? _mm_mul_ps(value, _mm_set1_ps(1.0f / 65535.0f)) : value;
+		} else if constexpr(F == Format::SNORM8 || F == Format::SINT8) {
+			//duplicating each byte up to 32 bits then shifting back down sign extends it
+			const __m128i loaded = LoadInt32(aSource);
+			const __m128i bytes = _mm_unpacklo_epi8(loaded, loaded);
+			const __m128 value = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(bytes, bytes), 24));
+			return F == Format::SNORM8 ? _mm_max_ps(_mm_mul_ps(value, _mm_set1_ps(1.0f / 127.0f)), _mm_set1_ps(-1.0f)) : value;
+		} else {
+			const __m128i shorts = _mm_loadl_epi64((const __m128i*)aSource);
+			const __m128 value = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16));
+			return F == Format::SNORM16 ? _mm_max_ps(_mm_mul_ps(value, _mm_set1_ps(1.0f / 32767.0f)), _mm_set1_ps(-1.0f)) : value;
+		}
+	}
+
+	template<Format F>
+	static void ConvertToFloatSSE2(const uint8_t* aSource, uint32_t aStride, __m128 aKeepMask, __m128 aDefault, uint8_t* aDest, uint32_t aDestStride, uint32_t aDestComponents, size_t aCount) {
+		//switching on the store size per element is cheap next to the loads, and always predicted
+		for(size_t i = 0; i < aCount; i++) {
+			const __m128 loaded = Load<F>(aSource + i * aStride);
+			const __m128 value = _mm_or_ps(_mm_and_ps(aKeepMask, loaded), _mm_andnot_ps(aKeepMask, aDefault));
+			float* dest = (float*)(aDest + i * aDestStride);
+			switch(aDestComponents) {
+				case 4:
+					_mm_storeu_ps(dest, value);
+					break;
+				case 3:
+					_mm_storel_pi((__m64*)dest, value);
+					_mm_store_ss(dest + 2, _mm_movehl_ps(value, value));
+					break;
+				case 2:
+					_mm_storel_pi((__m64*)dest, value);
+					break;
+				default:
+					_mm_store_ss(dest, value);
+					break;
+			}
+		}
+	}
+#endif
+
+	void ConvertToFloat(const Stream& aSource, float* aDest, uint32_t aDestStride, uint32_t aDestComponents, size_t aCount, const glm::vec4& aDefault) {
+		ZoneScoped;
+		ASSERT(aSource.mComponents >= 1 && aSource.mComponents <= 4 && aDestComponents >= 1 && aDestComponents <= 4);
+		if(aCount == 0) {
+			return;
+		}
+		size_t numVector = 0;
+#if VERTEX_CONVERT_SSE2
+		//a vector load can read past the element, so only use it on elements where that stays inside the source
+		const size_t elementSize = (size_t)GetFormatSize(aSource.mFormat) * aSource.mComponents;
+		const size_t sourceEnd = (aCount - 1) * aSource.mStride + elementSize;
+		const size_t loadSize = GetLoadSize(aSource.mFormat);
+		if(sourceEnd >= loadSize) {
+			numVector = aSource.mStride == 0 ? aCount : std::min(aCount, (sourceEnd - loadSize) / aSource.mStride + 1);
+		}
+
+		const uint32_t numComponents = std::min(aSource.mComponents, aDestComponents);
+		const __m128 keepMask = _mm_castsi128_ps(
+			_mm_set_epi32(numComponents > 3 ? -1 : 0, numComponents > 2 ? -1 : 0, numComponents > 1 ? -1 : 0, numComponents > 0 ? -1 : 0));
+		const __m128 defaultValue = _mm_setr_ps(aDefault.x, aDefault.y, aDefault.z, aDefault.w);
+		const uint8_t* source = (const uint8_t*)aSource.mData;
+		uint8_t* dest = (uint8_t*)aDest;
+		switch(aSource.mFormat) {
+	#define CONVERT_CASE(format)                                                                                                   \
+		case format:                                                                                                               \
+			ConvertToFloatSSE2<format>(source, aSource.mStride, keepMask, defaultValue, dest, aDestStride, aDestComponents, numVector); \
+			break;
+			CONVERT_CASE(Format::FLOAT)
+			CONVERT_CASE(Format::HALF)
+			CONVERT_CASE(Format::UNORM8)
+			CONVERT_CASE(Format::UNORM16)
+			CONVERT_CASE(Format::SNORM8)
+			CONVERT_CASE(Format::SNORM16)
+			CONVERT_CASE(Format::UINT8)
+			CONVERT_CASE(Format::UINT16)
+			CONVERT_CASE(Format::SINT8)
+			CONVERT_CASE(Format::SINT16)
+	#undef CONVERT_CASE
+		}
+#endif
+		if(numVector < aCount) {
+			Stream tail = aSource;
+			tail.mData = (const uint8_t*)aSource.mData + numVector * aSource.mStride;
+			ConvertToFloatScalar(tail, (float*)((uint8_t*)aDest + numVector * aDestStride), aDestStride, aDestComponents, aCount - numVector, aDefault);
+		}
+	}
+
+	void ConvertIndices(const void* aData, uint32_t aStride, uint32_t aSize, uint32_t* aDest, size_t aCount) {
+		ZoneScoped;
+		ASSERT(aSize == 1 || aSize == 2 || aSize == 4);
+		const uint8_t* source = (const uint8_t*)aData;
+		size_t i = 0;
+		if(aStride == aSize) {
+			if(aSize == 4) {
+				memcpy(aDest, source, aCount * sizeof(uint32_t));
+				return;
+			}
+#if VERTEX_CONVERT_SSE2
+			//tightly packed, widen 16 at a time
+			const __m128i zero = _mm_setzero_si128();
+			const size_t perLoad = 16 / aSize;
+			for(; i + perLoad <= aCount; i += perLoad) {
+				const __m128i loaded = _mm_loadu_si128((const __m128i*)(source + i * aSize));
+				__m128i* dest = (__m128i*)(aDest + i);
+				if(aSize == 2) {
+					_mm_storeu_si128(dest, _mm_unpacklo_epi16(loaded, zero));
+					_mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(loaded, zero));
+				} else {
+					const __m128i low = _mm_unpacklo_epi8(loaded, zero);
+					const __m128i high = _mm_unpackhi_epi8(loaded, zero);
+					_mm_storeu_si128(dest, _mm_unpacklo_epi16(low, zero));
+					_mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(low, zero));
+					_mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(high, zero));
+					_mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(high, zero));
+				}
+			}
+#endif
+		}
+		for(; i < aCount; i++) {
+			const uint8_t* element = source + i * aStride;
+			switch(aSize) {
+				case 1:
+					aDest[i] = *element;
+					break;
+				case 2: {
+					uint16_t value;
+					memcpy(&value, element, sizeof(uint16_t));
+					aDest[i] = value;
+					break;
+				}
+				default:
+					memcpy(&aDest[i], element, sizeof(uint32_t));
+					break;
+			}
+		}
+	}
+}; // namespace VertexConvert
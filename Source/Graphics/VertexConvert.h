@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+//converts strided source attributes (gltf accessors, assimp arrays) into floats in our vertex layout
+//SSE2 when it's available, each element is loaded/converted as one vector then only the needed floats are stored
+//so neighbouring members of the destination vertex are never touched
+
+namespace VertexConvert {
+	enum class Format {
+		FLOAT,
+		HALF,
+		UNORM8,
+		UNORM16,
+		SNORM8,
+		SNORM16,
+		//integers read as is, KHR_mesh_quantization allows these for positions/uvs
+		UINT8,
+		UINT16,
+		SINT8,
+		SINT16,
+	};
+	uint32_t GetFormatSize(Format aFormat);
+
+	struct Stream {
+		const void* mData = nullptr;
+		//bytes between elements
+		uint32_t mStride = 0;
+		Format mFormat = Format::FLOAT;
+		//1-4
+		uint32_t mComponents = 0;
+	};
+
+	//writes aDestComponents floats for each of aCount elements, aDestStride bytes apart
+	//destination components past the source's are taken from aDefault
+	void ConvertToFloat(const Stream& aSource, float* aDest, uint32_t aDestStride, uint32_t aDestComponents, size_t aCount, const glm::vec4& aDefault = glm::vec4(0, 0, 0, 1));
+
+	//scalar version of ConvertToFloat, used for the last elements where a vector load would read past the source
+	void ConvertToFloatScalar(const Stream& aSource, float* aDest, uint32_t aDestStride, uint32_t aDestComponents, size_t aCount, const glm::vec4& aDefault = glm::vec4(0, 0, 0, 1));
+
+	//aSize is 1, 2 or 4 bytes per index
+	void ConvertIndices(const void* aData, uint32_t aStride, uint32_t aSize, uint32_t* aDest, size_t aCount);
+}; // namespace VertexConvert
@@ -1,20 +1,66 @@
 #include "PlatformDebug.h"
 #include "Graphics/Graphics.h"
 #include "Engine/Engine.h"
+#include "Engine/Job.h"
 
 #include "Game/StateTest.h"
+#include "Game/StateLoaderBenchmark.h"
+#include "Graphics/TextureCompress.h"
 
-int main() {
+#include <cstring>
+#include <algorithm>
+
+int main(int argc, char** argv) {
 	//vs code is annoying, doesnt clear the last output
 	LOGGER::Log("--------------------------------\n");
 
+	//-benchmark-loaders [-assets folder] [-csv file] [-cache], see StateLoaderBenchmark
+	bool benchmarkLoaders = false;
+	std::string benchmarkAssets = std::string(WORK_DIR_REL) + "/Assets";
+	std::string benchmarkCsv = "LoaderBenchmark.csv";
+	bool benchmarkCache = false;
+	//-compress-textures [-assets folder] [-force], see TextureCompress
+	bool compressTextures = false;
+	bool compressForce = false;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-benchmark-loaders") == 0) {
+			benchmarkLoaders = true;
+		} else if(strcmp(argv[i], "-compress-textures") == 0) {
+			compressTextures = true;
+		} else if(strcmp(argv[i], "-force") == 0) {
+			compressForce = true;
+		} else if(strcmp(argv[i], "-assets") == 0 && i + 1 < argc) {
+			benchmarkAssets = argv[++i];
+		} else if(strcmp(argv[i], "-csv") == 0 && i + 1 < argc) {
+			benchmarkCsv = argv[++i];
+		} else if(strcmp(argv[i], "-cache") == 0) {
+			benchmarkCache = true;
+		}
+	}
+
+	//cpu only, no window or device is created
+	if(compressTextures) {
+		WorkManager::Startup();
+		const std::vector<TextureCompress::ImportResult> results = TextureCompress::ImportFolder(benchmarkAssets, compressForce);
+		WorkManager::Shutdown();
+		const bool failed = std::any_of(results.begin(), results.end(), [](const TextureCompress::ImportResult& aResult) {
+			return aResult.mFailed;
+		});
+		return failed ? 1 : 0;
+	}
+
 	Graphics vulkanGraphics;
 
 	Engine gameEngine;
 	gameEngine.Startup(&vulkanGraphics);
 
 	StateTest stateTest;
-	gEngine->SetDesiredState(&stateTest);
+	StateLoaderBenchmark loaderBenchmark(benchmarkAssets, benchmarkCsv, benchmarkCache);
+	if(benchmarkLoaders) {
+		gEngine->SetDesiredState(&loaderBenchmark);
+	} else {
+		gEngine->SetDesiredState(&stateTest);
+	}
 
 	//while(!gEngine->GetWindow()->ShouldClose())
 	gEngine->GameLoop();